@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+Python binding for the C++ engine (libpir, src/c_api.h) through ctypes.
+
+Build the library first (from the repository root):
+    cmake -S . -B build && cmake --build build --target pir
+
+Then:
+    from pir_engine import Engine
+    engine = Engine(policy="optimal")               # or "threshold-13", "qre-20"; numeric="floating"
+    engine.win_probabilities()                      # array([0.308, 0.330, 0.362])
+    engine.query(player=3, p1=14, p2=10, spin=12)   # (spin probability, win probabilities of the 3 players)
+    engine.query_states(players, p1s, p2s, spins)   # the same for whole numpy arrays of states
+    engine.simulate(1_000_000, threads=4, seed=1)   # simulated win rates
+    engine.tables()                                 # the solved tables as numpy arrays
+
+Totals and spins are in wheel units (1 = 5 cents), 0 = bust. Results are written by the C++ code straight into
+numpy arrays; with numeric="floating" tables() even returns views of the engine's own memory (no copy).
+Override the library location with the PIR_LIBRARY environment variable.
+"""
+
+import ctypes
+import os
+from typing import Dict, Optional, Tuple
+
+import numpy as np
+
+API_VERSION = 2
+
+_REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+_LIBRARY_CANDIDATES = [
+    os.path.join(_REPO_ROOT, "build", "libpir.so"),
+    os.path.join(_REPO_ROOT, "build", "libpir.dylib"),
+]
+
+
+class _Config(ctypes.Structure):
+    _fields_ = [
+        ("segments", ctypes.c_int32),
+        ("numeric", ctypes.c_int32),
+        ("policy", ctypes.c_char_p),
+        ("cache_dir", ctypes.c_char_p),
+    ]
+
+
+class _Layout(ctypes.Structure):
+    _fields_ = [
+        ("scores", ctypes.c_int32),
+        ("numeric", ctypes.c_int32),
+        ("value_count", ctypes.c_uint64),
+        ("third_player_offset", ctypes.c_uint64),
+        ("third_player_policy_offset", ctypes.c_uint64),
+        ("second_player_offset", ctypes.c_uint64),
+        ("second_player_policy_offset", ctypes.c_uint64),
+        ("first_player_offset", ctypes.c_uint64),
+        ("first_player_policy_offset", ctypes.c_uint64),
+    ]
+
+
+_DOUBLES = np.ctypeslib.ndpointer(dtype=np.float64, flags="C_CONTIGUOUS")
+_INT32S = np.ctypeslib.ndpointer(dtype=np.int32, flags="C_CONTIGUOUS")
+_INT64S = np.ctypeslib.ndpointer(dtype=np.int64, flags="C_CONTIGUOUS")
+
+
+def _load_library(path: Optional[str] = None) -> ctypes.CDLL:
+    path = path or os.environ.get("PIR_LIBRARY")
+    if path is None:
+        path = next((p for p in _LIBRARY_CANDIDATES if os.path.exists(p)), None)
+        if path is None:
+            raise OSError("libpir not found; build the 'pir' target or set PIR_LIBRARY")
+    lib = ctypes.CDLL(path)
+
+    lib.pir_api_version.restype = ctypes.c_int
+    lib.pir_last_error.restype = ctypes.c_char_p
+    lib.pir_engine_create.argtypes = [ctypes.POINTER(_Config)]
+    lib.pir_engine_create.restype = ctypes.c_void_p
+    lib.pir_engine_destroy.argtypes = [ctypes.c_void_p]
+    lib.pir_engine_layout.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Layout)]
+    lib.pir_win_probabilities.argtypes = [ctypes.c_void_p, _DOUBLES]
+    lib.pir_query_states.argtypes = [ctypes.c_void_p, ctypes.c_size_t, _INT32S, _INT32S, _INT32S, _INT32S,
+                                     _DOUBLES, _DOUBLES]
+    lib.pir_simulate.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_int32, ctypes.c_uint64, _INT64S]
+    lib.pir_export_tables.argtypes = [ctypes.c_void_p, _DOUBLES, ctypes.c_size_t]
+    lib.pir_export_tables_exact.argtypes = [ctypes.c_void_p, _INT64S, _INT64S, ctypes.c_size_t]
+    lib.pir_table_data.argtypes = [ctypes.c_void_p]
+    lib.pir_table_data.restype = ctypes.POINTER(ctypes.c_double)
+
+    if lib.pir_api_version() != API_VERSION:
+        raise OSError(f"{path} implements API version {lib.pir_api_version()}, expected {API_VERSION}")
+    return lib
+
+
+class Engine:
+    """Solved tables of one configuration (rules + policy + number type)."""
+
+    def __init__(self, policy: str = "optimal", segments: int = 20, numeric: str = "exact",
+                 cache_dir: Optional[str] = None, library: Optional[str] = None):
+        self._lib = _load_library(library)
+        config = _Config(segments, 1 if numeric == "floating" else 0, policy.encode(),
+                         cache_dir.encode() if cache_dir else None)
+        self._handle = self._lib.pir_engine_create(ctypes.byref(config))
+        if not self._handle:
+            raise ValueError(self._lib.pir_last_error().decode())
+        self.policy = policy
+        self.layout = _Layout()
+        self._check(self._lib.pir_engine_layout(self._handle, ctypes.byref(self.layout)))
+        self.segments = self.layout.scores - 1
+        self.exact = self.layout.numeric == 0
+
+    def close(self):
+        if self._handle:
+            self._lib.pir_engine_destroy(self._handle)
+            self._handle = None
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _check(self, status: int):
+        if status != 0:
+            message = self._lib.pir_last_error().decode()
+            raise ValueError(message) if status == -1 else RuntimeError(message)
+
+    def win_probabilities(self) -> np.ndarray:
+        out = np.empty(3)
+        self._check(self._lib.pir_win_probabilities(self._handle, out))
+        return out
+
+    def query_states(self, player, p1, p2, spin) -> Tuple[np.ndarray, np.ndarray]:
+        """Spin-again probability (n,) and win probabilities (n, 3) of n states (array-likes, broadcast)."""
+        player, p1, p2, spin = (np.ascontiguousarray(a, dtype=np.int32)
+                                for a in np.broadcast_arrays(player, p1, p2, spin))
+        n = player.size
+        spin_probability = np.empty(n)
+        win_probability = np.empty((n, 3))
+        self._check(self._lib.pir_query_states(self._handle, n, player.ravel(), p1.ravel(), p2.ravel(),
+                                               spin.ravel(), spin_probability, win_probability))
+        return spin_probability, win_probability
+
+    def query(self, player: int, p1: int = 0, p2: int = 0, spin: int = 0) -> Tuple[float, np.ndarray]:
+        spin_probability, win_probability = self.query_states(player, p1, p2, spin)
+        return float(spin_probability[0]), win_probability[0]
+
+    def simulate(self, games: int, threads: int = 1, seed: int = 0) -> np.ndarray:
+        """Simulated win rates of the three players."""
+        wins = np.zeros(3, dtype=np.int64)
+        self._check(self._lib.pir_simulate(self._handle, games, threads, seed, wins))
+        return wins / games
+
+    def values(self) -> np.ndarray:
+        """The whole table block as doubles (a view of the engine's memory for floating engines)."""
+        count = self.layout.value_count
+        if not self.exact:
+            data = self._lib.pir_table_data(self._handle)
+            buffer = (ctypes.c_double * count).from_address(ctypes.addressof(data.contents))
+            buffer.engine = self  # the view keeps the engine (and so the tables) alive
+            view = np.frombuffer(buffer, dtype=np.float64)
+            view.flags.writeable = False
+            return view
+        out = np.empty(count)
+        self._check(self._lib.pir_export_tables(self._handle, out, count))
+        return out
+
+    def exact_values(self) -> Tuple[np.ndarray, np.ndarray]:
+        """Exact engines: numerators and denominators of the whole table block."""
+        count = self.layout.value_count
+        numerators = np.empty(count, dtype=np.int64)
+        denominators = np.empty(count, dtype=np.int64)
+        self._check(self._lib.pir_export_tables_exact(self._handle, numerators, denominators, count))
+        return numerators, denominators
+
+    def tables(self) -> Dict[str, np.ndarray]:
+        """The six solver tables, shaped as in src/dp_tables.h (the last axis is the player).
+
+        The engine stores the third player's options per (leading total, tied) class; "third_player" expands
+        them to the full [p1][p2][spin][spin again][player] array, "third_player_classes" is the stored form."""
+        values = self.values()
+        s = self.layout.scores
+        shapes = {
+            "third_player_classes": (self.layout.third_player_offset, (s, 2, s, 2, 3)),
+            "third_player_policy": (self.layout.third_player_policy_offset, (s, s, 3)),
+            "second_player": (self.layout.second_player_offset, (s, s, 2, 3)),
+            "second_player_policy": (self.layout.second_player_policy_offset, (s, 3)),
+            "first_player": (self.layout.first_player_offset, (s, 2, 3)),
+            "first_player_policy": (self.layout.first_player_policy_offset, (3,)),
+        }
+        tables = {name: values[offset:offset + int(np.prod(shape))].reshape(shape)
+                  for name, (offset, shape) in shapes.items()}
+        p1, p2 = np.meshgrid(np.arange(s), np.arange(s), indexing="ij")
+        third = tables["third_player_classes"][np.maximum(p1, p2), (p1 == p2).astype(int)]
+        third[p2 > p1] = third[p2 > p1][..., [1, 0, 2]]  # classes are stored with player 1 leading
+        tables["third_player"] = third
+        return tables
+
+
+if __name__ == "__main__":
+    with Engine() as engine:
+        print("win probabilities:", engine.win_probabilities())
+        print("simulated:        ", engine.simulate(1_000_000, seed=1))
+        spins = np.arange(1, engine.segments + 1)
+        spin_probability, _ = engine.query_states(1, 0, 0, spins)
+        print("first player spins again on:", [int(5 * s) for s in spins[spin_probability >= 0.5]], "cents")
@@ -0,0 +1,425 @@
+// Benchmarks for the Fraction type, the DP solver, the simulator, the table cache, dataset ingest and the
+// query daemon
+//
+// Usage: pir_benchmark [--filter TEXT] [--min-time SECONDS] [--threads N] [--out FILE.csv]
+//                  [--baseline FILE.csv] [--threshold PERCENT]
+//
+// Every benchmark prints one row and (with --out) writes one CSV line:
+//     name,iterations,ns_per_op,items_per_second
+// With --baseline the results are compared against a CSV written by an earlier run; any benchmark whose
+// ns_per_op grew by more than --threshold percent (default 10) is reported and the exit code is 1.
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+#include "dp_solver.h"
+#include "json.h"
+#include "modular_solver.h"
+#include "policies.h"
+#include "query_server.h"
+#include "replay.h"
+#include "simulator.h"
+#include "table_cache.h"
+#include "thread_pool.h"
+using namespace std;
+
+
+// -- Harness --
+// Keep the compiler from optimizing away a value we computed but never use
+template <class T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    string name;
+    long long iterations; // number of times the body was run
+    double ns_per_op; // nanoseconds per item (an item is one op / state / game, depending on the benchmark)
+    double items_per_second;
+};
+
+double min_time_seconds = 0.5; // minimum measured time for each benchmark
+
+// Run body (which processes items_per_call items) until at least min_time_seconds have passed
+BenchResult run_benchmark(const string& name, long long items_per_call, const function<void()>& body) {
+    using clock = chrono::steady_clock;
+    body(); // warm up (also fills caches / tables the body reads)
+
+    long long iterations = 1;
+    double elapsed = 0;
+    while (true) {
+        auto start = clock::now();
+        for (long long i = 0; i < iterations; i++)
+            body();
+        elapsed = chrono::duration<double>(clock::now() - start).count();
+        if (elapsed >= min_time_seconds)
+            break;
+        // grow towards the target time (at most 10x per round so one slow round doesn't overshoot badly)
+        double scale = (elapsed > 0) ? min_time_seconds * 1.2 / elapsed : 10.0;
+        iterations = max(iterations + 1, (long long)(iterations * min(scale, 10.0)));
+    }
+
+    double items = (double)iterations * items_per_call;
+    return {name, iterations, elapsed * 1e9 / items, items / elapsed};
+}
+
+
+// -- Benchmarks --
+// Fractions with small numerators / denominators like the ones the solver produces
+vector<Fraction> make_fractions(int count) {
+    mt19937_64 rng(12345);
+    uniform_int_distribution<long long> num(-400, 400), den(1, 400);
+    vector<Fraction> fractions;
+    for (int i = 0; i < count; i++)
+        fractions.emplace_back(num(rng), den(rng));
+    return fractions;
+}
+
+void add_fraction_benchmarks(vector<pair<string, function<BenchResult()>>>& benchmarks) {
+    static const vector<Fraction> fractions = make_fractions(1024);
+    const long long n = (long long)fractions.size() - 1;
+
+    benchmarks.push_back({"fraction_add", [n]() {
+        return run_benchmark("fraction_add", n, [n]() {
+            for (long long i = 0; i < n; i++)
+                do_not_optimize(fractions[i] + fractions[i + 1]);
+        });
+    }});
+    benchmarks.push_back({"fraction_mul", [n]() {
+        return run_benchmark("fraction_mul", n, [n]() {
+            for (long long i = 0; i < n; i++)
+                do_not_optimize(fractions[i] * fractions[i + 1]);
+        });
+    }});
+    benchmarks.push_back({"fraction_compare", [n]() {
+        return run_benchmark("fraction_compare", n, [n]() {
+            for (long long i = 0; i < n; i++)
+                do_not_optimize(fractions[i] < fractions[i + 1]);
+        });
+    }});
+}
+
+const GameRules standard_rules;
+
+void add_solver_benchmarks(vector<pair<string, function<BenchResult()>>>& benchmarks) {
+    const PolicySet<Fraction> policies = optimal_policies<Fraction>();
+    const long long scores = standard_rules.scores(), options = standard_rules.spins_per_turn;
+    // (p1, p2, spin, option) entries per (p1, p2) or, in the default class layout, per (leader, tied) class
+    auto third_states = [scores, options](const DpTables<Fraction>& t) {
+        return (t.third_player_by_class() ? 2 * scores : scores * scores) * scores * options;
+    };
+    const long long solve_states = 2 * scores * scores * options; // the optimal set is class-invariant: class layout
+
+    // Full solve (items = states in the 3rd player table, the dominant stage)
+    benchmarks.push_back({"initialize_dp_tables", [policies, solve_states]() {
+        return run_benchmark("initialize_dp_tables", solve_states, [policies]() {
+            DpTables<Fraction> tables = initialize_dp_tables(standard_rules, policies);
+            do_not_optimize(tables.first_player_policy_probability(0));
+        });
+    }});
+    benchmarks.push_back({"initialize_dp_tables/floating", [solve_states]() {
+        const PolicySet<double> floating_policies = optimal_policies<double>();
+        return run_benchmark("initialize_dp_tables/floating", solve_states, [floating_policies]() {
+            DpTables<double> tables = initialize_dp_tables(standard_rules, floating_policies);
+            do_not_optimize(tables.first_player_policy_probability(0));
+        });
+    }});
+    // The optimal set without its compiled counterpart: a std::function call and a mix per decision
+    benchmarks.push_back({"initialize_dp_tables/type_erased", [policies, solve_states]() {
+        PolicySet<Fraction> type_erased = policies;
+        type_erased.compiled_solve = nullptr;
+        return run_benchmark("initialize_dp_tables/type_erased", solve_states, [type_erased]() {
+            DpTables<Fraction> tables = initialize_dp_tables(standard_rules, type_erased);
+            do_not_optimize(tables.first_player_policy_probability(0));
+        });
+    }});
+
+    // Multi-modular exact solve (floating decision pass + one pass per prime, single thread)
+    benchmarks.push_back({"solve_exact_modular", [solve_states]() {
+        return run_benchmark("solve_exact_modular", solve_states, []() {
+            ModularSolveResult result = solve_exact_modular(standard_rules, "optimal");
+            do_not_optimize(result.primes);
+        });
+    }});
+
+    // Per-stage timings: every stage reads only the tables of the stages before it, so after one full solve
+    // each stage can be repeated on its own. Items = states the stage fills, counted in the solved tables' layout.
+    using Stage = function<void(DpTables<Fraction>&)>;
+    using Items = function<long long(const DpTables<Fraction>&)>;
+    auto fixed = [](long long items) { return Items([items](const DpTables<Fraction>&) { return items; }); };
+    const vector<tuple<string, Items, Stage>> stages = {
+        {"solve_stage/third_player_options", third_states, [policies](DpTables<Fraction>& t) { solve_third_player_options(t, standard_rules, policies); }},
+        {"solve_stage/third_player_policy", fixed(scores * scores), [policies](DpTables<Fraction>& t) { solve_third_player_policy(t, standard_rules, policies); }},
+        {"solve_stage/second_player_options", fixed(scores * scores * options), [policies](DpTables<Fraction>& t) { solve_second_player_options(t, standard_rules, policies); }},
+        {"solve_stage/second_player_policy", fixed(scores), [policies](DpTables<Fraction>& t) { solve_second_player_policy(t, standard_rules, policies); }},
+        {"solve_stage/first_player_options", fixed(scores * options), [policies](DpTables<Fraction>& t) { solve_first_player_options(t, standard_rules, policies); }},
+        {"solve_stage/first_player_policy", fixed(1), [policies](DpTables<Fraction>& t) { solve_first_player_policy(t, standard_rules, policies); }},
+    };
+    for (const auto& [name, states, stage] : stages)
+        benchmarks.push_back({name, [name, states, stage, policies]() {
+            DpTables<Fraction> tables = initialize_dp_tables(standard_rules, policies);
+            return run_benchmark(name, states(tables), [&]() { stage(tables); });
+        }});
+}
+
+void add_simulation_benchmarks(vector<pair<string, function<BenchResult()>>>& benchmarks, int max_threads) {
+    vector<int> thread_counts = {1};
+    if (max_threads > 1)
+        thread_counts.push_back(max_threads);
+
+    for (int threads : thread_counts) {
+        string name = "simulate_game/threads:" + to_string(threads);
+        benchmarks.push_back({name, [name, threads]() {
+            const PolicySet<Fraction> policies = optimal_policies<Fraction>();
+            DpTables<Fraction> tables = initialize_dp_tables(standard_rules, policies);
+            const long long games = 200'000;
+            return run_benchmark(name, games, [&]() {
+                do_not_optimize(simulate_game(standard_rules, tables, policies, games, threads, 42));
+            });
+        }});
+    }
+
+    // One stream, the policies type-erased and compiled (no draw per decision)
+    benchmarks.push_back({"simulate_batch/type_erased", []() {
+        const PolicySet<Fraction> policies = optimal_policies<Fraction>();
+        DpTables<Fraction> tables = initialize_dp_tables(standard_rules, policies);
+        const long long games = 200'000;
+        return run_benchmark("simulate_batch/type_erased", games, [&]() {
+            mt19937_64 rng(42);
+            long long wins[3] = {0, 0, 0};
+            simulate_batch(standard_rules, tables, policies, games, rng, wins);
+            do_not_optimize(wins[0]);
+        });
+    }});
+    benchmarks.push_back({"simulate_batch/compiled", []() {
+        const OptimalPolicies<Fraction> policies;
+        DpTables<Fraction> tables = initialize_dp_tables(standard_rules, policies);
+        const long long games = 200'000;
+        return run_benchmark("simulate_batch/compiled", games, [&]() {
+            mt19937_64 rng(42);
+            long long wins[3] = {0, 0, 0};
+            simulate_batch(standard_rules, tables, policies, games, rng, wins);
+            do_not_optimize(wins[0]);
+        });
+    }});
+}
+
+void add_cache_benchmarks(vector<pair<string, function<BenchResult()>>>& benchmarks) {
+    // A cache hit: open + map the solved tables and read the result
+    benchmarks.push_back({"table_cache/load", []() {
+        const PolicySet<Fraction> policies = optimal_policies<Fraction>();
+        string cache_dir = (filesystem::temp_directory_path() / ("pir_benchmark_cache." + to_string(getpid()))).string();
+        load_or_solve(cache_dir, standard_rules, policies); // make sure the file exists
+        BenchResult result = run_benchmark("table_cache/load", 1, [&]() {
+            DpTables<Fraction> tables = load_or_solve(cache_dir, standard_rules, policies);
+            do_not_optimize(tables.first_player_policy_probability(0));
+        });
+        filesystem::remove_all(cache_dir);
+        return result;
+    }});
+}
+
+// A showdown dataset in the scraped format (random spins, no extra fields)
+string make_dataset(int showdowns) {
+    mt19937_64 rng(12345);
+    ostringstream json;
+    json << "[";
+    for (int i = 0; i < showdowns; i++) {
+        json << (i ? "," : "") << "{\"contestants\": [";
+        for (int seat = 0; seat < 3; seat++) {
+            int first = random_spin(20, rng), second = (first < 14) ? random_spin(20, rng) : 0;
+            json << (seat ? "," : "") << "{\"name\": \"Contestant " << seat << "\", \"pre_wheel_winnings\": 1000, "
+                 << "\"initial_spins\": [{\"spin_index\": 1, \"value\": " << 5 * first << "}";
+            if (second)
+                json << ", {\"spin_index\": 2, \"value\": " << 5 * second << "}";
+            json << "]}";
+        }
+        json << "], \"winner_index\": 0}";
+    }
+    json << "]";
+    return json.str();
+}
+
+void add_dataset_benchmarks(vector<pair<string, function<BenchResult()>>>& benchmarks) {
+    // Parse + convert a dataset the size of tpir_structured_showdowns.json (about 10,000 showdowns)
+    benchmarks.push_back({"dataset/parse", []() {
+        const int showdowns = 10'000;
+        const string text = make_dataset(showdowns);
+        return run_benchmark("dataset/parse", showdowns, [&]() {
+            DatasetStats stats;
+            do_not_optimize(parse_showdowns(parse_json(text), stats).size());
+        });
+    }});
+}
+
+void add_thread_pool_benchmarks(vector<pair<string, function<BenchResult()>>>& benchmarks) {
+    // Task overhead: submit, run and wait for empty tasks, flat and nested two levels deep
+    benchmarks.push_back({"thread_pool/tasks", []() {
+        const int tasks = 1000;
+        return run_benchmark("thread_pool/tasks", tasks, [&]() {
+            atomic<int> done{0};
+            TaskGroup group;
+            for (int i = 0; i < tasks; i++)
+                group.run([&done]() { done++; });
+            group.wait();
+            do_not_optimize(done.load());
+        });
+    }});
+    benchmarks.push_back({"thread_pool/nested", []() {
+        const int outer = 32, inner = 32;
+        return run_benchmark("thread_pool/nested", outer * inner, [&]() {
+            atomic<int> done{0};
+            ThreadPool::shared().parallel_for(0, outer, [&](int) {
+                ThreadPool::shared().parallel_for(0, inner, [&](int) { done++; });
+            });
+            do_not_optimize(done.load());
+        });
+    }});
+}
+
+void add_daemon_benchmarks(vector<pair<string, function<BenchResult()>>>& benchmarks) {
+    // Round trips to a query server on this machine: one request per trip, and a pipelined batch of states
+    for (int batch : {1, 64}) {
+        string name = "daemon/roundtrip/batch:" + to_string(batch);
+        benchmarks.push_back({name, [name, batch]() {
+            // One socket per process (the server unlinks it when it goes away), so runs side by side don't
+            // take over each other's
+            string socket_path = (filesystem::temp_directory_path()
+                                  / ("pir_benchmark." + to_string(getpid()) + ".sock")).string();
+            QueryServer server(socket_path, [](const string& policy_name) {
+                PolicySet<Fraction> policies = policies_by_name<Fraction>(policy_name, standard_rules);
+                return make_query_tables(standard_rules, initialize_dp_tables(standard_rules, policies), policies);
+            }, "optimal");
+            thread server_thread([&server]() { server.run(); });
+
+            const int scores = standard_rules.scores(), segments = standard_rules.segments;
+            vector<query_protocol::Request> requests(batch);
+            for (int i = 0; i < batch; i++)
+                requests[i] = {(uint32_t)i, query_protocol::RequestKind::state, (uint8_t)(1 + i % 3),
+                               (uint8_t)(i % scores), (uint8_t)(i * 7 % scores), (uint8_t)(1 + i % segments), 0, 0};
+            BenchResult result;
+            {
+                QueryClient client(socket_path);
+                result = run_benchmark(name, batch, [&]() { do_not_optimize(client.exchange(requests).back()); });
+            }
+            server.stop();
+            server_thread.join();
+            return result;
+        }});
+    }
+}
+
+
+// -- Results --
+void write_results(const string& path, const vector<BenchResult>& results) {
+    ofstream out(path);
+    out << "name,iterations,ns_per_op,items_per_second\n";
+    out << setprecision(10);
+    for (const BenchResult& r : results)
+        out << r.name << "," << r.iterations << "," << r.ns_per_op << "," << r.items_per_second << "\n";
+}
+
+// Read name -> ns_per_op from a CSV written by write_results
+map<string, double> read_baseline(const string& path) {
+    ifstream in(path);
+    if (!in)
+        throw runtime_error("Cannot open baseline file " + path);
+    map<string, double> baseline;
+    string line;
+    getline(in, line); // header
+    while (getline(in, line)) {
+        stringstream fields(line);
+        string name, iterations, ns_per_op;
+        if (getline(fields, name, ',') && getline(fields, iterations, ',') && getline(fields, ns_per_op, ','))
+            baseline[name] = stod(ns_per_op);
+    }
+    return baseline;
+}
+
+// Print the change against the baseline, return the number of regressions above threshold_percent
+int compare_with_baseline(const vector<BenchResult>& results, const map<string, double>& baseline, double threshold_percent) {
+    int regressions = 0;
+    cout << endl << left << setw(40) << "benchmark" << right << setw(14) << "baseline ns" << setw(14) << "current ns"
+         << setw(10) << "change" << endl;
+    for (const BenchResult& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end()) {
+            cout << left << setw(40) << r.name << right << setw(14) << "-" << setw(14) << r.ns_per_op << setw(10) << "new" << endl;
+            continue;
+        }
+        double change = (r.ns_per_op - it->second) / it->second * 100;
+        bool regressed = change > threshold_percent;
+        regressions += regressed;
+        cout << left << setw(40) << r.name << right << setw(14) << it->second << setw(14) << r.ns_per_op
+             << setw(9) << fixed << setprecision(1) << change << "%" << defaultfloat << setprecision(6)
+             << (regressed ? "  REGRESSION" : "") << endl;
+    }
+    return regressions;
+}
+
+
+int main(int argc, char** argv) {
+    string filter, out_path, baseline_path;
+    double threshold_percent = 10;
+    int max_threads = (int)max(1u, thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto value = [&]() -> string {
+            if (i + 1 >= argc) {
+                cerr << "Missing value for " << arg << endl;
+                exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--filter") filter = value();
+        else if (arg == "--min-time") min_time_seconds = stod(value());
+        else if (arg == "--threads") max_threads = max(1, stoi(value()));
+        else if (arg == "--out") out_path = value();
+        else if (arg == "--baseline") baseline_path = value();
+        else if (arg == "--threshold") threshold_percent = stod(value());
+        else {
+            cerr << "Unknown argument " << arg << endl;
+            return 2;
+        }
+    }
+
+    vector<pair<string, function<BenchResult()>>> benchmarks;
+    add_fraction_benchmarks(benchmarks);
+    add_solver_benchmarks(benchmarks);
+    add_simulation_benchmarks(benchmarks, max_threads);
+    add_cache_benchmarks(benchmarks);
+    add_dataset_benchmarks(benchmarks);
+    add_thread_pool_benchmarks(benchmarks);
+    add_daemon_benchmarks(benchmarks);
+
+    vector<BenchResult> results;
+    cout << left << setw(40) << "benchmark" << right << setw(14) << "iterations" << setw(14) << "ns/item"
+         << setw(16) << "items/s" << endl;
+    for (const auto& [name, benchmark] : benchmarks) {
+        if (!filter.empty() && name.find(filter) == string::npos)
+            continue;
+        BenchResult r = benchmark();
+        cout << left << setw(40) << r.name << right << setw(14) << r.iterations << setw(14) << r.ns_per_op
+             << setw(16) << r.items_per_second << endl;
+        results.push_back(r);
+    }
+
+    if (!out_path.empty())
+        write_results(out_path, results);
+    if (!baseline_path.empty())
+        return compare_with_baseline(results, read_baseline(baseline_path), threshold_percent) > 0 ? 1 : 0;
+    return 0;
+}
@@ -1,414 +1,1003 @@
-#include <cassert>
+#include <array>
+#include <climits>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <vector>
-#include "fraction.cpp"
+#include "compact_tables.h"
+#include "continuous_limit.h"
+#include "dp_solver.h"
+#include "dual.h"
+#include "episode.h"
+#include "instrumentation.h"
+#include "markov_chain.h"
+#include "modular_solver.h"
+#include "policies.h"
+#include "query_server.h"
+#include "replay.h"
+#include "report.h"
+#include "score_distribution.h"
+#include "simulator.h"
+#include "sweep.h"
+#include "table_cache.h"
+#include "thread_pool.h"
+#include "validation.h"
+#include "wheel_design.h"
 using namespace std;
 
 
-// --- Arrays ---
-// NOTE: The "spin" values can only be 1-20, 0 means the player chose not to do the first spin which isn't allowed
-// Win probability: (1st player total) (2nd player total) (3rd player spin) (spin again [1] or not [0]) (player # - 1)
-Fraction third_player_probability[21][21][21][2][3];
-// Win probability: (1st player total) (2nd player total) (player # - 1)
-Fraction third_player_policy_probability[21][21][3];  // incorporate third player policy
-// Win probability: (1st player total) (2nd player spin) (spin again) (player # - 1)
-Fraction second_player_probability[21][21][2][3];
-// Win probability: (1st player total) (player # - 1)
-Fraction second_player_policy_probability[21][3]; // incorporate second player policy
-// Win probability: (1st player spin) (spin again) (player # - 1)
-Fraction first_player_probability[21][2][3];
-// Win probability: (player # - 1)
-Fraction first_player_policy_probability[3]; // incorporate first player policy (expected win rates)
-
-
-// ---- Policies -----
-// PROBLEM: We give C1 and C2 data in their policies that describe exactly what later contestants policies are
-//      something they don't have access to in a contest
-//      If you really want to simulate without this knowledge, don't use the DP values in the policy
-
-// Optimal 3rd player policy (for winning game): Spin again if less than max score
-Fraction third_player_optimal_policy(int player1_score, int player2_score, int spin1) {
-    Fraction win_prob_if_spin = third_player_probability[player1_score][player2_score][spin1][1][2];
-    Fraction win_prob_if_no_spin = third_player_probability[player1_score][player2_score][spin1][0][2];
-    return (win_prob_if_spin > win_prob_if_no_spin) ? Fraction(1, 1) : Fraction(0, 1);
+// -- Assumptions --
+// Uniform spin distribution from 1 to segments (20: 5 cents to a dollar)
+// There is an equal probability of anyone winning in the spinoff
+// No one is allowed to skip their first spin (including third player when both others bust)
+// You are not allowed to spin again if you get the top score in your first spin
+// Players plays according to their assigned policies (--policy)
+
+const char* usage =
+    "usage: price_is_right [command] [options]\n"
+    "commands:\n"
+    "  solve      win probabilities of the policy set\n"
+    "  simulate   solve, then simulate games and compare (--dataset: also by contestant, drawing their pre-wheel\n"
+    "             winnings from the dataset and seating them by winnings)\n"
+    "  replay     score the decisions of real showdowns (--dataset) against the policy set\n"
+    "  query      win probabilities of one decision state (--player, --p1, --p2, --spin)\n"
+    "  chain      solve the game as an absorbing Markov chain and cross-check it against the tables\n"
+    "  distribution  exact distributions of the final totals, the winning total, busts and spin-offs\n"
+    "  sensitivity  derivatives of the win probabilities with respect to each segment's probability\n"
+    "  design     segment probabilities that give the positions target win probabilities (--target)\n"
+    "  episode    two showdowns and the Showcase: each contestant's chances and expected winnings (--winnings,\n"
+    "             or every episode of --dataset)\n"
+    "  continuous  solve doubling wheels from --segments (floating), extrapolate to the continuous spin and compare\n"
+    "             with the direct continuous solve (--levels)\n"
+    "  memory     memory footprint of the solver tables and of the compact storage modes\n"
+    "  sweep      solve every rule variant of a spec (--spec) into a results file (--out), resuming it if it\n"
+    "             exists (--out alone: resume or show it)\n"
+    "  validate   check simulations against the tables (chi-square tests) for a suite of wheels and policies\n"
+    "  daemon     serve queries on a Unix socket (--socket) until SIGINT / SIGTERM; SIGHUP reloads the tables\n"
+    "  (none)     solve and simulate 1,000,000 games, as plain text\n"
+    "options:\n"
+    "  --policy NAME         optimal (default), threshold-K, qre-LAMBDA or rules:PATH (a policy rules file)\n"
+    "  --numeric KIND        exact (default) or floating tables (qre always uses floating); modular: exact\n"
+    "                        solve by modular arithmetic and rational reconstruction (solve only)\n"
+    "  --segments N          wheel segments (default 20)\n"
+    "  --spins N             spins allowed per turn (default 2)\n"
+    "  --wheel P1,...,PN     segment probabilities (default uniform; floating tables; design: the start)\n"
+    "  --target A,B,C        design: target win probabilities (default 1/3 each)\n"
+    "  --iterations N        design: most gradient steps (default 200)\n"
+    "  --levels N            continuous: wheel sizes, each twice the last (default 6: 20 to 640 segments)\n"
+    "  --format FORMAT       text (default), csv or json\n"
+    "  --cache-dir DIR       load / store solved tables here (default $PIR_CACHE_DIR)\n"
+    "  --games N             simulated games (default 1000000)\n"
+    "  --threads N           simulation streams (default 1; the same seed and streams give the same games)\n"
+    "  --workers N           thread pool size (default $PIR_WORKERS, else the hardware threads)\n"
+    "  --seed N              simulation seed (default: time; validate: fixed)\n"
+    "  --alpha P             validate: significance level of the tests (default 0.001)\n"
+    "  --dataset PATH        showdown dataset JSON for replay, episode and simulate\n"
+    "  --winnings A,...,F    episode: pre-wheel winnings of showdown 1's three contestants, then showdown 2's\n"
+    "  --showcase T,O,V      episode: Showcase win probability of the top winner and the other one, prize value\n"
+    "                        (default 0.5,0.4,30000)\n"
+    "  --player N            query: deciding player, 1-3\n"
+    "  --p1 N, --p2 N        query: totals of the players before (wheel units, 0 = bust)\n"
+    "  --spin N              query: the deciding player's first spin (wheel units)\n"
+    "  --socket PATH         daemon: socket path (default pir.sock)\n"
+    "  --storage KIND        daemon: serve from compact tables, float64, float32, float16 or rational32\n"
+    "                        (memory: list that mode's sections)\n"
+    "  --spec PATH           sweep: the rule options to combine (src/sweep.h)\n"
+    "  --out PATH            sweep: results file\n"
+    "  --trace PATH          instrumentation and thread pool report on stderr + Chrome trace (default $PIR_TRACE)\n";
+
+struct Options {
+    string command;
+    string policy = "optimal";
+    NumericKind numeric = NumericKind::exact;
+    GameRules rules;
+    OutputFormat format = OutputFormat::text;
+    string cache_dir;
+    long long games = 1'000'000;
+    int threads = 1;
+    int workers = 0; // 0: the thread pool's default
+    unsigned long long seed = time(0);
+    bool seed_set = false;
+    double alpha = 0.001;
+    string dataset;
+    int player = 0;
+    int p1 = 0;
+    int p2 = 0;
+    int spin = 0;
+    string socket_path = "pir.sock";
+    string storage; // empty: the solver's tables
+    string trace_path;
+    string spec_path;
+    string out_path;
+    array<double, 3> target = {1.0 / 3, 1.0 / 3, 1.0 / 3};
+    int iterations = 200;
+    int levels = 6;
+    vector<double> winnings;
+    ShowcaseModel showcase;
+};
+
+// the whole value must be the number: "12x" and "1.5" are usage errors, not 12 and 1
+long long parse_whole(const string& value, const string& option) {
+    size_t used = 0;
+    long long number = 0;
+    try {
+        number = stoll(value, &used);
+    } catch (const exception&) {
+    }
+    if (value.empty() || used != value.size())
+        throw invalid_argument(option + " takes a whole number, not '" + value + "'");
+    return number;
 }
 
-// Optimal 2nd player policy (for winning game) -- ASSUMING 3RD PLAYER ACTS ACCORDING TO THEIR POLICY
-Fraction second_player_optimal_policy(int player1_score, int spin1) {
-    Fraction win_prob_if_spin = second_player_probability[player1_score][spin1][1][1];
-    Fraction win_prob_if_no_spin = second_player_probability[player1_score][spin1][0][1];
-    return (win_prob_if_spin > win_prob_if_no_spin) ? Fraction(1, 1) : Fraction(0, 1);
+int parse_int(const string& value, const string& option) {
+    const long long number = parse_whole(value, option);
+    if (number < INT_MIN || number > INT_MAX)
+        throw invalid_argument(option + " is out of range: " + value);
+    return (int)number;
 }
 
-// Optimal 1st player policy (for winning game) -- ASSUMING 2ND & 3RD PLAYER ACTS ACCORDING TO THEIR POLICY
-Fraction first_player_optimal_policy(int spin1) {
-    Fraction win_prob_if_spin = first_player_probability[spin1][1][0];
-    Fraction win_prob_if_no_spin = first_player_probability[spin1][0][0];
-    return (win_prob_if_spin > win_prob_if_no_spin) ? Fraction(1, 1) : Fraction(0, 1);
+double parse_number(const string& value, const string& option) {
+    size_t used = 0;
+    double number = 0;
+    try {
+        number = stod(value, &used);
+    } catch (const exception&) {
+    }
+    if (value.empty() || used != value.size())
+        throw invalid_argument(option + " takes a number, not '" + value + "'");
+    return number;
 }
 
+// "0.1,0.2,0.7" -> {0.1, 0.2, 0.7}
+vector<double> parse_numbers(const string& value, const string& option) {
+    vector<double> numbers;
+    stringstream list(value);
+    for (string item; getline(list, item, ',');) {
+        size_t used = 0;
+        try {
+            numbers.push_back(stod(item, &used));
+        } catch (const exception&) {
+        }
+        if (used == 0 || used != item.size())
+            throw invalid_argument(option + " takes a comma separated list of numbers");
+    }
+    return numbers;
+}
 
-// -- Initialize DP tables --
-void initialize_dp_tables(Fraction (*third_player_policy)(int p1, int p2, int spin),
-                          Fraction (*second_player_policy)(int p1, int spin),
-                          Fraction (*first_player_policy)(int spin))
-{
-    // Calculate the 3rd player's options
-    for (int p1 = 0; p1 <= 20; p1++) // player 1 total score
-        for (int p2 = 0; p2 <= 20; p2++) // player 2 total score
-            for (int spin1 = 0; spin1 <= 20; spin1++) // player 3 spin (NOTE: 0 means they choose not to spin)
-                for (int spinAgain = 0; spinAgain <= 1; spinAgain++) // spin again [1] or not [0]
-                {
-                    // Skip invalid states 
-                    if (spin1 == 0 || (spin1 == 20 && spinAgain)) // skiped first spin or spin again on 20
-                    {
-                        third_player_probability[p1][p2][spin1][spinAgain][0] = Fraction(-1, 1);
-                        third_player_probability[p1][p2][spin1][spinAgain][1] = Fraction(-1, 1);
-                        third_player_probability[p1][p2][spin1][spinAgain][2] = Fraction(-1, 1);
-                        continue;
-                    }
-                    
-                    // Initialize the win probabilities & other variables
-                    Fraction player1_win(0, 1);
-                    Fraction player2_win(0, 1);
-                    Fraction player3_win(0, 1);
-                    int max_score = max(p1, p2);
-                    
-                    // Calculate win probabilities
-                    if (spinAgain == 0) { // Don't spin again
-                        if (spin1 > max_score) {
-                            player3_win = Fraction(1, 1); // wins outright (everything else 0)
-                        } else if (spin1 < max_score) { // p3 looses
-                            if (p1 == p2) // 2-way tie
-                                player1_win = player2_win = Fraction(1, 2);
-                            else // no tie
-                                (p1 > p2 ? player1_win : player2_win) = Fraction(1, 1);
-                        } else { // tie with winning player
-                            if (p1 == p2) { // three-way tie
-                                player1_win = player2_win = player3_win = Fraction(1, 3);
-                            } else { // two-way tie
-                                (p1 > p2 ? player1_win : player2_win) = Fraction(1, 2);
-                                player3_win = Fraction(1, 2);
-                            }
-                        }
-                    } else { // Spin again
-                        Fraction prob_new_spin(1, 20); // Uniform probability for each spin
-                        for (int spin2 = 1; spin2 <= 20; spin2++) {
-                            // NOTE: If you spin 0 when spin again, its like spinning once
-                            // NOTE: if you bust but everyone else busts, there is a spinoff of one spin
-                            int total_score = (spin1 + spin2 > 20) ? 0 : spin1 + spin2;
-                            if (total_score > max_score) {
-                                player3_win += prob_new_spin * Fraction(1, 1); // wins outright (everything else 0)
-                            } else if (total_score < max_score) { // p3 looses
-                                if (p1 == p2) { // 2-way tie
-                                    player1_win += prob_new_spin * Fraction(1, 2);
-                                    player2_win += prob_new_spin * Fraction(1, 2);
-                                } else // no tie
-                                    (p1 > p2 ? player1_win : player2_win) += prob_new_spin * Fraction(1, 1);
-                            } else { // tie with winning player
-                                if (p1 == p2) { // three-way tie
-                                    player1_win += prob_new_spin * Fraction(1, 3);
-                                    player2_win += prob_new_spin * Fraction(1, 3);
-                                    player3_win += prob_new_spin * Fraction(1, 3);
-                                } else { // two-way tie
-                                    (p1 > p2 ? player1_win : player2_win) += prob_new_spin * Fraction(1, 2);
-                                    player3_win += prob_new_spin * Fraction(1, 2);
-                                }
-                            }
-                        }
-                    }
-                    assert((player1_win + player2_win + player3_win) == Fraction(1, 1)); // Ensure probabilities sum to 1
-
-                    // Store the calculated probability
-                    third_player_probability[p1][p2][spin1][spinAgain][0] = player1_win;
-                    third_player_probability[p1][p2][spin1][spinAgain][1] = player2_win;
-                    third_player_probability[p1][p2][spin1][spinAgain][2] = player3_win;
-                }
-
-    // Calculate third person win rate based on their policy
-    for (int p1 = 0; p1 <= 20; p1++) // player 1 total score
-        for (int p2 = 0; p2 <= 20; p2++) // player 2 total score
-        {
-            // Set all values to zero (for non first spin part)
-            Fraction player1_win(0, 1);
-            Fraction player2_win(0, 1);
-            Fraction player3_win(0, 1);
-
-            // Run all spins (must do a first spin, spin!=0) for player 3
-            Fraction spin_probability(1, 20); // uniform probability for each spin
-            for (int spin = 1; spin <= 20; spin++)
-            {
-                Fraction policy = third_player_policy(p1, p2, spin); // probability of spinning again
-                if (third_player_probability[p1][p2][spin][1][0] == Fraction(-1, 1)) // invalid state check
-                    policy = Fraction(0, 1); // can't spin again if invalid state
-                if (third_player_probability[p1][p2][spin][0][0] == Fraction(-1, 1)) // invalid state check
-                    policy = Fraction(1, 1); // must spin again if invalid state
-                player1_win += spin_probability * (policy * third_player_probability[p1][p2][spin][1][0]
-                                    + (Fraction(1, 1) - policy) * third_player_probability[p1][p2][spin][0][0]);
-                player2_win += spin_probability * (policy * third_player_probability[p1][p2][spin][1][1]
-                                    + (Fraction(1, 1) - policy) * third_player_probability[p1][p2][spin][0][1]);
-                player3_win += spin_probability * (policy * third_player_probability[p1][p2][spin][1][2]
-                                    + (Fraction(1, 1) - policy) * third_player_probability[p1][p2][spin][0][2]);
-            }
-            assert((player1_win + player2_win + player3_win) == Fraction(1, 1)); // Ensure probabilities sum to 1
-
-            // Set all array values
-            third_player_policy_probability[p1][p2][0] += player1_win;
-            third_player_policy_probability[p1][p2][1] += player2_win;
-            third_player_policy_probability[p1][p2][2] += player3_win;
+Options parse_options(int argc, char** argv) {
+    Options options;
+    if (const char* cache_dir = getenv("PIR_CACHE_DIR"))
+        options.cache_dir = cache_dir;
+    if (const char* trace_path = getenv("PIR_TRACE")) // e.g. PIR_TRACE=trace.json
+        options.trace_path = trace_path;
+
+    int i = 1;
+    if (i < argc && argv[i][0] != '-')
+        options.command = argv[i++];
+    for (; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            cout << usage;
+            exit(0);
+        }
+        if (i + 1 >= argc)
+            throw invalid_argument("Missing value for " + arg);
+        string value = argv[++i];
+        if (arg == "--policy") options.policy = value;
+        else if (arg == "--numeric") {
+            if (value != "exact" && value != "floating" && value != "modular")
+                throw invalid_argument("--numeric must be exact, floating or modular");
+            options.numeric = (value == "exact") ? NumericKind::exact
+                              : (value == "floating") ? NumericKind::floating : NumericKind::modular;
+        }
+        else if (arg == "--segments") options.rules.segments = parse_int(value, arg);
+        else if (arg == "--spins") options.rules.spins_per_turn = parse_int(value, arg);
+        else if (arg == "--wheel") options.rules.segment_probabilities = parse_numbers(value, arg);
+        else if (arg == "--target") {
+            vector<double> target = parse_numbers(value, arg);
+            if (target.size() != 3)
+                throw invalid_argument("--target needs three win probabilities");
+            copy(target.begin(), target.end(), options.target.begin());
+        }
+        else if (arg == "--iterations") options.iterations = parse_int(value, arg);
+        else if (arg == "--levels") options.levels = parse_int(value, arg);
+        else if (arg == "--winnings") {
+            options.winnings = parse_numbers(value, arg);
+            if (options.winnings.size() != 6)
+                throw invalid_argument("--winnings needs six amounts (two showdowns of three)");
+        }
+        else if (arg == "--showcase") {
+            vector<double> model = parse_numbers(value, arg);
+            if (model.size() != 3)
+                throw invalid_argument("--showcase needs two win probabilities and a prize value");
+            options.showcase = {model[0], model[1], model[2]};
         }
+        else if (arg == "--format") options.format = parse_output_format(value);
+        else if (arg == "--cache-dir") options.cache_dir = value;
+        else if (arg == "--games") options.games = parse_whole(value, arg);
+        else if (arg == "--threads") options.threads = parse_int(value, arg);
+        else if (arg == "--workers") options.workers = parse_int(value, arg);
+        else if (arg == "--seed") {
+            if (value.find_first_not_of("0123456789") != string::npos || value.empty())
+                throw invalid_argument("--seed takes a whole number, not '" + value + "'");
+            options.seed = stoull(value);
+            options.seed_set = true;
+        }
+        else if (arg == "--alpha") options.alpha = parse_number(value, arg);
+        else if (arg == "--dataset") options.dataset = value;
+        else if (arg == "--player") options.player = parse_int(value, arg);
+        else if (arg == "--p1") options.p1 = parse_int(value, arg);
+        else if (arg == "--p2") options.p2 = parse_int(value, arg);
+        else if (arg == "--spin") options.spin = parse_int(value, arg);
+        else if (arg == "--socket") options.socket_path = value;
+        else if (arg == "--storage") {
+            parse_table_storage(value); // validate
+            options.storage = value;
+        }
+        else if (arg == "--trace") options.trace_path = value;
+        else if (arg == "--spec") options.spec_path = value;
+        else if (arg == "--out") options.out_path = value;
+        else throw invalid_argument("Unknown option " + arg);
+    }
+    if (options.rules.segments < 1)
+        throw invalid_argument("--segments must be at least 1");
+    if (options.rules.spins_per_turn < 2)
+        throw invalid_argument("--spins must be at least 2");
+    if (!options.rules.uniform_wheel()) {
+        vector<double>& wheel = options.rules.segment_probabilities;
+        if ((int)wheel.size() != options.rules.segments)
+            throw invalid_argument("--wheel needs one probability per segment");
+        double sum = 0;
+        for (double probability : wheel) {
+            if (!(probability >= 0))
+                throw invalid_argument("--wheel probabilities can't be negative");
+            sum += probability;
+        }
+        if (abs(sum - 1) > 1e-6)
+            throw invalid_argument("--wheel probabilities must add up to 1");
+        for (double& probability : wheel)
+            probability /= sum;
+        if (options.numeric == NumericKind::exact)
+            options.numeric = NumericKind::floating;
+    }
+    if (options.games < 1)
+        throw invalid_argument("--games must be at least 1");
+    if (options.threads < 1)
+        throw invalid_argument("--threads must be at least 1");
+    if (options.workers < 0)
+        throw invalid_argument("--workers can't be negative (0 picks the default)");
+    if (policy_needs_floating(options.policy) && options.numeric != NumericKind::modular)
+        options.numeric = NumericKind::floating;
+    return options;
+}
 
-    // Calculate the 2nd player's options
-    for (int p1 = 0; p1 <= 20; p1++)
-        for (int spin1 = 0; spin1 <= 20; spin1++) // player 2 spin (NOTE: 0 means they choose not to spin)
-            for (int spinAgain = 0; spinAgain <= 1; spinAgain++) // spin again [1] or not [0]
-            {
-                // Skip invalid states 
-                if (spin1 == 0 || (spin1 == 20 && spinAgain)) // skiped first spin or spin again on 20
-                {
-                    second_player_probability[p1][spin1][spinAgain][0] = Fraction(-1, 1);
-                    second_player_probability[p1][spin1][spinAgain][1] = Fraction(-1, 1);
-                    second_player_probability[p1][spin1][spinAgain][2] = Fraction(-1, 1);
-                    continue;
-                }
-                
-                // Calculate the win probabilities for player 2 based on the decision
-                if (spinAgain == 0) { // Don't spin again
-                    second_player_probability[p1][spin1][spinAgain][0] = third_player_policy_probability[p1][spin1][0];
-                    second_player_probability[p1][spin1][spinAgain][1] = third_player_policy_probability[p1][spin1][1];
-                    second_player_probability[p1][spin1][spinAgain][2] = third_player_policy_probability[p1][spin1][2];
-                } else { // Spin again
-                    // Initialize win probabilities
-                    second_player_probability[p1][spin1][spinAgain][0] = Fraction(0, 1);
-                    second_player_probability[p1][spin1][spinAgain][1] = Fraction(0, 1);
-                    second_player_probability[p1][spin1][spinAgain][2] = Fraction(0, 1);
-                    
-                    // Run 20 possible new spins
-                    Fraction prob_new_spin(1, 20); // Uniform probability for each spin
-                    for (int new_spin = 1; new_spin <= 20; new_spin++) {
-                        int p2total = (spin1 + new_spin > 20) ? 0 : spin1 + new_spin;
-                        second_player_probability[p1][spin1][spinAgain][0] += prob_new_spin * third_player_policy_probability[p1][p2total][0];
-                        second_player_probability[p1][spin1][spinAgain][1] += prob_new_spin * third_player_policy_probability[p1][p2total][1];
-                        second_player_probability[p1][spin1][spinAgain][2] += prob_new_spin * third_player_policy_probability[p1][p2total][2];
-                    }
+// exact value as written in reports: "num/denom" for fractions, the decimal otherwise
+string exact_text(const Fraction& value) {
+    ostringstream text;
+    text << value;
+    return text.str();
+}
+string exact_text(double value) { return format_number(value); }
+
+const char* player_names[3] = {"first", "second", "third"};
+const int winnings_classes = 5; // per-contestant results: pre-wheel winnings quintiles
+
+// Every contestant's pre-wheel winnings in the showdowns
+vector<long long> winnings_pool(const vector<ShowdownRecord>& showdowns) {
+    vector<long long> pool;
+    for (const ShowdownRecord& showdown : showdowns)
+        for (const ShowdownRecord::Contestant& contestant : showdown.contestants)
+            pool.push_back(contestant.pre_wheel_winnings);
+    return pool;
+}
 
-                    assert((second_player_probability[p1][spin1][spinAgain][0]
-                            + second_player_probability[p1][spin1][spinAgain][1]
-                            + second_player_probability[p1][spin1][spinAgain][2]) == Fraction(1, 1)); // Ensure probabilities sum to 1
-                }
-            }
-    
-    // Calculate the second person win rate based on their policy
-    for (int p1 = 0; p1 <= 20; p1++) // player 1 total score
-    {
-        // Set all values to zero (for non first spin part)
-        Fraction player1_win(0, 1);
-        Fraction player2_win(0, 1);
-        Fraction player3_win(0, 1);
-
-        // Run all spins (must do a first spin, spin!=0) for player 3
-        Fraction spin_probability(1, 20); // uniform probability for each spin
-        for (int spin = 1; spin <= 20; spin++)
-        {
-            Fraction policy = second_player_policy(p1, spin); // probability of spinning again
-            if (second_player_probability[p1][spin][1][0] == Fraction(-1, 1)) // invalid state check
-                policy = Fraction(0, 1); // can't spin again if invalid state
-            if (second_player_probability[p1][spin][0][0] == Fraction(-1, 1)) // invalid state check
-                policy = Fraction(1, 1); // must spin again if invalid state
-            player1_win += spin_probability * (policy * second_player_probability[p1][spin][1][0]
-                                + (Fraction(1, 1) - policy) * second_player_probability[p1][spin][0][0]);
-            player2_win += spin_probability * (policy * second_player_probability[p1][spin][1][1]
-                                + (Fraction(1, 1) - policy) * second_player_probability[p1][spin][0][1]);
-            player3_win += spin_probability * (policy * second_player_probability[p1][spin][1][2]
-                                + (Fraction(1, 1) - policy) * second_player_probability[p1][spin][0][2]);
-        }
-        assert((player1_win + player2_win + player3_win) == Fraction(1, 1)); // Ensure probabilities sum to 1
-
-        // Set all array values
-        second_player_policy_probability[p1][0] += player1_win;
-        second_player_policy_probability[p1][1] += player2_win;
-        second_player_policy_probability[p1][2] += player3_win;
-    }
-
-    // Calculate the 1st player's options
-    for (int spin1 = 0; spin1 <= 20; spin1++) // player 1 spin (NOTE: 0 means they choose not to spin)
-        for (int spinAgain = 0; spinAgain <= 1; spinAgain++) // spin again [1] or not [0]
-        {
-            // Skip invalid states 
-            if (spin1 == 0 || (spin1 == 20 && spinAgain)) // skiped first spin or spin again on 20
-            {
-                first_player_probability[spin1][spinAgain][0] = Fraction(-1, 1);
-                first_player_probability[spin1][spinAgain][1] = Fraction(-1, 1);
-                first_player_probability[spin1][spinAgain][2] = Fraction(-1, 1);
+
+// -- Commands --
+template <class Num>
+vector<ResultTable> solve_command(const Options&, const DpTables<Num>& tables) {
+    ResultTable result{"win_probability", {"player", "probability", "exact"}, {}};
+    for (int player = 0; player < 3; player++) {
+        const Num& probability = tables.first_player_policy_probability(player);
+        result.add_row({player_names[player], format_number(NumericTraits<Num>::to_double(probability)),
+                        exact_text(probability)});
+    }
+    return {result};
+}
+
+template <class Num>
+vector<ResultTable> simulate_command(const Options& options, const DpTables<Num>& tables,
+                                     const PolicySet<Num>& policies) {
+    vector<Fraction> simulated = simulate_game(options.rules, tables, policies, options.games, options.threads,
+                                               options.seed);
+    ResultTable result{"simulation", {"player", "probability", "simulated", "difference"}, {}};
+    for (int player = 0; player < 3; player++) {
+        double probability = NumericTraits<Num>::to_double(tables.first_player_policy_probability(player));
+        double rate = simulated[player].value();
+        result.add_row({player_names[player], format_number(probability), format_number(rate),
+                        format_number(rate - probability)});
+    }
+    ResultTable setup{"setup", {"games", "threads", "seed"}, {}};
+    setup.add_row({to_string(options.games), to_string(options.threads), to_string(options.seed)});
+    if (options.dataset.empty())
+        return {setup, result};
+
+    // By contestant: contestants drawn from the dataset, seated by spin_order, credited per winnings class; and
+    // how far apart the contestants of a class are (their expected win rates differ by the seats they get)
+    DatasetStats stats;
+    const vector<long long> pool = winnings_pool(load_showdowns(options.dataset, stats));
+    const vector<long long> bounds = winnings_class_bounds(pool, winnings_classes);
+    const ContestantCounts counts = simulate_contestants(options.rules, tables, policies, pool, bounds, options.games,
+                                                         options.threads, options.seed);
+    ResultTable contestants{"contestants", {"winnings", "contestants", "first", "second", "third", "simulated",
+                                            "expected", "difference"}, {}};
+    for (size_t type = 0; type < counts.contestants.size(); type++) {
+        const double n = max<long long>(counts.contestants[type], 1);
+        const double rate = counts.wins[type] / n, expected = counts.expected_wins[type] / n;
+        contestants.add_row({winnings_class_name(type, bounds), to_string(counts.contestants[type]),
+                             format_number(counts.seated[0][type] / n), format_number(counts.seated[1][type] / n),
+                             format_number(counts.seated[2][type] / n), format_number(rate), format_number(expected),
+                             format_number(rate - expected)});
+    }
+    ResultTable identities{"contestant_identities", {"winnings", "drawn", "expected_min", "expected_max"}, {}};
+    for (size_t type = 0; type < counts.contestants.size(); type++) {
+        long long drawn = 0;
+        double low = 1, high = 0;
+        for (size_t i = 0; i < pool.size(); i++) {
+            if (winnings_class(pool[i], bounds) != (int)type || counts.games_by_contestant[i] == 0)
                 continue;
-            }
-            
-            // Calculate the win probabilities for player 1 based on the decision
-            if (spinAgain == 0) { // Don't spin again
-                first_player_probability[spin1][spinAgain][0] = second_player_policy_probability[spin1][0];
-                first_player_probability[spin1][spinAgain][1] = second_player_policy_probability[spin1][1];
-                first_player_probability[spin1][spinAgain][2] = second_player_policy_probability[spin1][2];
-            } else { // Spin again
-                // Initialize win probabilities
-                first_player_probability[spin1][spinAgain][0] = Fraction(0, 1);
-                first_player_probability[spin1][spinAgain][1] = Fraction(0, 1);
-                first_player_probability[spin1][spinAgain][2] = Fraction(0, 1);
-                
-                // Run 20 possible new spins
-                Fraction prob_new_spin(1, 20); // Uniform probability for each spin
-                for (int spin2 = 1; spin2 <= 20; spin2++) {
-                    int p1total = (spin1 + spin2 > 20) ? 0 : spin1 + spin2;
-                    first_player_probability[spin1][spinAgain][0] += prob_new_spin * second_player_policy_probability[p1total][0];
-                    first_player_probability[spin1][spinAgain][1] += prob_new_spin * second_player_policy_probability[p1total][1];
-                    first_player_probability[spin1][spinAgain][2] += prob_new_spin * second_player_policy_probability[p1total][2];
-                }
-
-                assert((first_player_probability[spin1][spinAgain][0]
-                        + first_player_probability[spin1][spinAgain][1]
-                        + first_player_probability[spin1][spinAgain][2]) == Fraction(1, 1)); // Ensure probabilities sum to 1
-            }
+            const double expected = counts.expected_by_contestant[i] / counts.games_by_contestant[i];
+            drawn++;
+            low = min(low, expected);
+            high = max(high, expected);
         }
+        identities.add_row({winnings_class_name(type, bounds), to_string(drawn), format_number(drawn ? low : 0),
+                            format_number(drawn ? high : 0)});
+    }
+    return {setup, result, contestants, identities};
+}
+
+template <class Num>
+vector<ResultTable> replay_command(const Options& options, const DpTables<Num>& tables,
+                                   const PolicySet<Num>& policies) {
+    if (options.dataset.empty())
+        throw invalid_argument("replay needs --dataset");
+    DatasetStats stats;
+    vector<ShowdownRecord> showdowns = load_showdowns(options.dataset, stats);
+    array<SeatReplay, 3> seats = replay_showdowns(options.rules, tables, policies, showdowns);
+
+    ResultTable dataset{"dataset", {"showdowns", "skipped", "replayed"}, {}};
+    dataset.add_row({to_string(stats.showdowns_read), to_string(stats.showdowns_skipped), to_string(showdowns.size())});
+    ResultTable result{"replay", {"player", "decisions", "agreement", "win_probability_lost", "log_likelihood",
+                                  "wins", "expected_wins"}, {}};
+    for (int player = 0; player < 3; player++) {
+        const SeatReplay& seat = seats[player];
+        result.add_row({player_names[player], to_string(seat.decisions),
+                        format_number(seat.decisions ? (double)seat.agreed / seat.decisions : 0),
+                        format_number(seat.win_probability_lost), format_number(seat.log_likelihood),
+                        to_string(seat.wins), format_number(seat.expected_wins)});
+    }
 
-    // Calculate the first person win rate based on their policy
-    {
-        // Set all values to zero (for non first spin part)
-        Fraction player1_win(0, 1);
-        Fraction player2_win(0, 1);
-        Fraction player3_win(0, 1);
-
-        // Run all spins (must do a first spin, spin!=0) for player 3
-        Fraction spin_probability(1, 20); // uniform probability for each spin
-        for (int spin = 1; spin <= 20; spin++)
-        {
-            Fraction policy = first_player_policy(spin); // probability of spinning again
-            if (first_player_probability[spin][1][0] == Fraction(-1, 1)) // invalid state check
-                policy = Fraction(0, 1); // can't spin again if invalid state
-            if (first_player_probability[spin][0][0] == Fraction(-1, 1)) // invalid state check
-                policy = Fraction(1, 1); // must spin again if invalid state
-            player1_win += spin_probability * (policy * first_player_probability[spin][1][0]
-                                + (Fraction(1, 1) - policy) * first_player_probability[spin][0][0]);
-            player2_win += spin_probability * (policy * first_player_probability[spin][1][1]
-                                + (Fraction(1, 1) - policy) * first_player_probability[spin][0][1]);
-            player3_win += spin_probability * (policy * first_player_probability[spin][1][2]
-                                + (Fraction(1, 1) - policy) * first_player_probability[spin][0][2]);
+    // By contestant, grouped by pre-wheel winnings; and how often the recorded order is the order by winnings
+    const vector<long long> bounds = winnings_class_bounds(winnings_pool(showdowns), winnings_classes);
+    struct ClassTotals {
+        long long contestants = 0, decisions = 0, agreed = 0, known = 0, wins = 0;
+        double win_probability_lost = 0, expected_wins = 0;
+    };
+    vector<ClassTotals> classes(bounds.size() + 1);
+    long long seated_by_winnings = 0;
+    for (const ContestantReplay& contestant : replay_contestants(options.rules, tables, policies, showdowns)) {
+        ClassTotals& totals = classes[winnings_class(contestant.pre_wheel_winnings, bounds)];
+        totals.contestants++;
+        totals.decisions += contestant.decided;
+        totals.agreed += contestant.agreed;
+        totals.win_probability_lost += contestant.win_probability_lost;
+        if (contestant.won >= 0) {
+            totals.known++;
+            totals.wins += contestant.won;
+            totals.expected_wins += contestant.win_probability;
         }
-        assert((player1_win + player2_win + player3_win) == Fraction(1, 1)); // Ensure probabilities sum to 1
+        seated_by_winnings += (contestant.seat == contestant.winnings_seat);
+    }
+    ResultTable contestants{"contestants", {"winnings", "contestants", "decisions", "agreement",
+                                            "win_probability_lost", "wins", "expected_wins"}, {}};
+    for (size_t type = 0; type < classes.size(); type++) {
+        const ClassTotals& totals = classes[type];
+        contestants.add_row({winnings_class_name(type, bounds), to_string(totals.contestants),
+                             to_string(totals.decisions),
+                             format_number(totals.decisions ? (double)totals.agreed / totals.decisions : 0),
+                             format_number(totals.win_probability_lost), to_string(totals.wins),
+                             format_number(totals.expected_wins)});
+    }
+    ResultTable order{"spin_order", {"contestants", "seated_by_winnings"}, {}};
+    order.add_row({to_string(3 * showdowns.size()), to_string(seated_by_winnings)});
+    return {dataset, result, contestants, order};
+}
 
-        // Set all array values
-        first_player_policy_probability[0] += player1_win;
-        first_player_policy_probability[1] += player2_win;
-        first_player_policy_probability[2] += player3_win;
+template <class Num>
+vector<ResultTable> query_command(const Options& options, const DpTables<Num>& tables,
+                                  const PolicySet<Num>& policies) {
+    const int segments = options.rules.segments;
+    if (options.player < 1 || options.player > 3)
+        throw invalid_argument("query needs --player 1, 2 or 3");
+    if (options.spin < 1 || options.spin > segments)
+        throw invalid_argument("query needs --spin between 1 and " + to_string(segments));
+    if (options.p1 < 0 || options.p1 > segments || options.p2 < 0 || options.p2 > segments)
+        throw invalid_argument("--p1 and --p2 must be between 0 and " + to_string(segments));
+
+    const int p1 = options.p1, p2 = options.p2, spin = options.spin;
+    // the win probabilities of all three players after each choice, and the policy's spin probability
+    ResultTable result{"query", {"player", "choice", "first", "second", "third"}, {}};
+    for (int again = 1; again >= 0; again--) {
+        if (again && spin == segments)
+            continue; // no second spin on the top score
+        vector<string> row = {player_names[options.player - 1], again ? "spin" : "stay"};
+        for (int player = 0; player < 3; player++) {
+            const Num& probability =
+                (options.player == 1) ? tables.first_player_probability(spin, again, player)
+                : (options.player == 2) ? tables.second_player_probability(p1, spin, again, player)
+                : tables.third_player_probability(p1, p2, spin, again, player);
+            row.push_back(format_number(NumericTraits<Num>::to_double(probability)));
+        }
+        result.add_row(row);
+    }
+    Num spin_probability = (spin == segments) ? NumericTraits<Num>::ratio(0, 1)
+                       : (options.player == 1) ? policies.first_player(tables, spin, 1)
+                       : (options.player == 2) ? policies.second_player(tables, p1, spin, 1)
+                       : policies.third_player(tables, p1, p2, spin, 1);
+    ResultTable policy{"policy", {"policy", "spin_probability"}, {}};
+    policy.add_row({policies.name, format_number(NumericTraits<Num>::to_double(spin_probability))});
+    return {result, policy};
+}
+
+// Bytes per table of the solver's tables, and of the compact tables in each storage mode with their largest
+// error against the exact (folded) values
+template <class Num>
+vector<ResultTable> memory_command(const Options& options, const DpTables<Num>& tables,
+                                   const PolicySet<Num>& policies) {
+    const size_t s = options.rules.scores(), k = tables.options();
+    const size_t third_states = tables.third_player_by_class() ? 2 * s : s * s; // classes or (p1, p2) (dp_tables.h)
+    const pair<const char*, size_t> solver_tables[] = {
+        {"third_player_probability", third_states * s * k * 3}, {"third_player_policy_probability", s * s * 3},
+        {"second_player_probability", s * s * k * 3},     {"second_player_policy_probability", s * 3},
+        {"first_player_probability", s * k * 3},          {"first_player_policy_probability", 3}};
+    ResultTable solver{"solver_tables", {"table", "entries", "entry_bytes", "bytes"}, {}};
+    size_t solver_bytes = 0;
+    for (const auto& [name, entries] : solver_tables) {
+        solver.add_row({name, to_string(entries), to_string(sizeof(Num)), to_string(entries * sizeof(Num))});
+        solver_bytes += entries * sizeof(Num);
+    }
+    solver.add_row({"total", to_string(tables.size()), to_string(sizeof(Num)), to_string(solver_bytes)});
+
+    ResultTable compact{"compact_tables", {"storage", "entries", "bytes", "reduction", "max_error", "note"}, {}};
+    CompactTables reference = CompactTables::build(options.rules, tables, policies, TableStorage::float64);
+    ResultTable sections{"compact_sections", {"section", "entries", "bytes", "denominator"}, {}};
+    for (TableStorage storage : {TableStorage::float64, TableStorage::float32, TableStorage::float16,
+                                 TableStorage::rational32}) {
+        CompactTables tables_compact;
+        try {
+            tables_compact = CompactTables::build(options.rules, tables, policies, storage);
+        } catch (const exception& e) {
+            compact.add_row({table_storage_name(storage), "-", "-", "-", "-", e.what()});
+            continue;
+        }
+        double max_error = 0;
+        const int segments = options.rules.segments;
+        for (int player = 1; player <= 3; player++)
+            for (int p1 = 0; p1 <= (player >= 2 ? segments : 0); p1++)
+                for (int p2 = 0; p2 <= (player == 3 ? segments : 0); p2++)
+                    for (int spin = 0; spin <= segments; spin++) {
+                        for (int k = 0; k < 3; k++)
+                            max_error = max(max_error, abs(tables_compact.win_probability(player, p1, p2, spin, k)
+                                                           - reference.win_probability(player, p1, p2, spin, k)));
+                        max_error = max(max_error, abs(tables_compact.spin_probability(player, p1, p2, spin)
+                                                       - reference.spin_probability(player, p1, p2, spin)));
+                    }
+        size_t entries = 0;
+        for (const CompactTables::Section& section : tables_compact.sections()) {
+            entries += section.entries;
+            if (options.storage == table_storage_name(storage))
+                sections.add_row({section.name, to_string(section.entries), to_string(section.bytes),
+                                  to_string(section.denominator)});
+        }
+        compact.add_row({table_storage_name(storage), to_string(entries), to_string(tables_compact.bytes()),
+                         format_number((double)solver_bytes / tables_compact.bytes()), format_number(max_error),
+                         tables_compact.third_player_by_class() ? "third player by class" : ""});
     }
+    if (sections.rows.empty())
+        return {solver, compact};
+    return {solver, compact, sections};
 }
 
+// The game as an absorbing Markov chain (src/markov_chain.h): its solve(s) against the backward induction tables
+template <class Num>
+vector<ResultTable> chain_command(const Options& options, const DpTables<Num>& tables,
+                                  const PolicySet<Num>& policies) {
+    const bool exact = NumericTraits<Num>::kind == NumericKind::exact;
+    const double tolerance = exact ? 0 : 1e-9;
+    MarkovChain<Num> chain = build_markov_chain(options.rules, tables, policies);
+
+    ChainSolveStats stats;
+    vector<array<Num, 3>> values = solve_absorption_exact(chain, &stats);
+    ResultTable graph{"markov_chain", {"states", "transitions", "components", "cyclic_components",
+                                       "largest_component"}, {}};
+    graph.add_row({to_string(chain.states()), to_string(chain.transitions()), to_string(stats.components),
+                   to_string(stats.cyclic_components), to_string(stats.largest_component)});
+
+    ResultTable solve{"chain_solve", {"method", "sweeps", "residual", "states", "mismatches", "max_difference",
+                                      "worst_state", "result"}, {}};
+    auto add = [&](const string& method, const ChainSolveStats& method_stats, const ChainCheck& check) {
+        solve.add_row({method, to_string(method_stats.sweeps), format_number(method_stats.residual),
+                       to_string(check.states), to_string(check.mismatches), format_number(check.max_difference),
+                       check.worst_state, check.mismatches == 0 ? "pass" : "FAIL"});
+    };
+    add("block_elimination", stats,
+        compare_chain_with_tables(chain, values, options.rules, tables, policies, tolerance));
+    if constexpr (is_same_v<Num, double>) {
+        ChainSolveStats sweep_stats;
+        vector<array<double, 3>> swept = solve_absorption_gauss_seidel(chain, 1e-15, 10'000, &sweep_stats);
+        add("gauss_seidel", sweep_stats,
+            compare_chain_with_tables(chain, swept, options.rules, tables, policies, tolerance));
+    }
 
-// -- Simulate Game --
-// probabilistic decision: return true with probability prob
-bool random_decision(Fraction prob) {
-    long long rand_num = rand() % prob.getDenominator();
-    return rand_num < prob.getNumerator();
+    const size_t start = chain.first_player_start();
+    ResultTable result{"win_probability", {"player", "chain", "tables", "exact"}, {}};
+    for (int player = 0; player < 3; player++)
+        result.add_row({player_names[player], format_number(NumericTraits<Num>::to_double(values[start][player])),
+                        format_number(NumericTraits<Num>::to_double(tables.first_player_policy_probability(player))),
+                        exact_text(values[start][player])});
+    return {graph, solve, result};
 }
-// simulation function that returns 3 fraction values Fraction[3]
-vector<Fraction> simulate_game(
-    Fraction (*third_player_policy)(int p1, int p2, int spin),
-    Fraction (*second_player_policy)(int p1, int spin),
-    Fraction (*first_player_policy)(int spin),
-    long long num_simulations)
-{
-    // Assuming DP tables have been initialized
-
-    // initialize score variables
-    long long p1_wins = 0;
-    long long p2_wins = 0;
-    long long p3_wins = 0;
-    srand(time(0)); // seed random number generator
-
-    // Loop many times
-    for (long long sim = 0; sim < num_simulations; sim++) {
-        
-        // Player 1's turn
-        int p1_total = rand() % 20 + 1; // first spin
-        Fraction policy1 = first_player_policy(p1_total); // Probability of spinning again
-        if (random_decision(policy1)) { // spin again
-            p1_total += rand() % 20 + 1;
-            if (p1_total > 20) // bust
-                p1_total = 0;
-        }
 
-        // Player 2's turn
-        int p2_total = rand() % 20 + 1; // first spin
-        Fraction policy2 = second_player_policy(p1_total, p2_total); // Probability of spinning again
-        if (random_decision(policy2)) { // spin again
-            p2_total += rand() % 20 + 1;
-            if (p2_total > 20) // bust
-                p2_total = 0;
-        }
+// Exact final-score distributions under the policies (src/score_distribution.h)
+template <class Num>
+vector<ResultTable> distribution_command(const Options& options, const DpTables<Num>& tables,
+                                         const PolicySet<Num>& policies) {
+    using Traits = NumericTraits<Num>;
+    ScoreDistribution<Num> distribution = score_distribution(options.rules, tables, policies);
+    ResultTable totals{"final_total", {"total", "first", "second", "third", "winning"}, {}};
+    for (int total = 0; total <= options.rules.segments; total++)
+        totals.add_row({to_string(total), format_number(Traits::to_double(distribution.final_total[0][total])),
+                        format_number(Traits::to_double(distribution.final_total[1][total])),
+                        format_number(Traits::to_double(distribution.final_total[2][total])),
+                        format_number(Traits::to_double(distribution.winning_total[total]))});
+
+    ResultTable outcomes{"outcome", {"outcome", "probability", "exact"}, {}};
+    auto add = [&](const string& outcome, const Num& probability) {
+        outcomes.add_row({outcome, format_number(Traits::to_double(probability)), exact_text(probability)});
+    };
+    for (int player = 0; player < 3; player++)
+        add(string(player_names[player]) + "_busts", distribution.bust[player]);
+    add("two_way_spin_off", distribution.two_way_spin_off);
+    add("three_way_spin_off", distribution.three_way_spin_off);
+    for (int player = 0; player < 3; player++) {
+        // spin-offs as uniform draws: the same win probabilities as the tables (exactly with Fraction)
+        const Num difference = distribution.win_probability[player] - tables.first_player_policy_probability(player);
+        if (abs(Traits::to_double(difference)) > (Traits::kind == NumericKind::exact ? 0 : 1e-9))
+            throw runtime_error("the final-score distribution disagrees with the tables");
+        add(string(player_names[player]) + "_wins", distribution.win_probability[player]);
+    }
+    return {totals, outcomes};
+}
 
-        // Player 3's turn
-        int p3_total = rand() % 20 + 1; // first spin
-        Fraction policy3 = third_player_policy(p1_total, p2_total, p3_total); // Probability of spinning again
-        if (random_decision(policy3)) { // spin again
-            p3_total += rand() % 20 + 1;
-            if (p3_total > 20) // bust
-                p3_total = 0;   
+// Episode model (src/episode.h) on the solved seats: one episode (--winnings) or every episode of --dataset
+template <class Num>
+vector<ResultTable> episode_command(const Options& options, const DpTables<Num>& tables) {
+    array<double, 3> seats;
+    for (int seat = 0; seat < 3; seat++)
+        seats[seat] = NumericTraits<Num>::to_double(tables.first_player_policy_probability(seat));
+    const EpisodeModel model(seats, options.showcase);
+
+    if (options.dataset.empty()) {
+        if (options.winnings.empty())
+            throw invalid_argument("episode needs --winnings or --dataset");
+        EpisodeRecord episode;
+        for (int i = 0; i < 6; i++) {
+            auto& contestant = episode.showdowns[i / 3].contestants[i % 3];
+            contestant.name = "contestant " + to_string(i + 1);
+            contestant.pre_wheel_winnings = llround(options.winnings[i]);
         }
+        ResultTable result{"episode", {"contestant", "showdown", "seat", "winnings", "showcase_probability",
+                                       "win_probability", "expected_showcase", "expected_total"}, {}};
+        for (const ContestantOutlook& contestant : model.solve(episode))
+            result.add_row({contestant.name, to_string(contestant.showdown + 1), player_names[contestant.seat],
+                            to_string(contestant.pre_wheel_winnings), format_number(contestant.showcase_probability),
+                            format_number(contestant.win_probability), format_number(contestant.expected_showcase),
+                            format_number(contestant.expected_total)});
+        return {result};
+    }
 
-        // Determine winner
-        int max_score = max(p1_total, max(p2_total, p3_total));
-        int num_winners = (p1_total == max_score) + (p2_total == max_score) + (p3_total == max_score);
-        int selected_winner = rand() % num_winners; // select among winners uniformly (ASSUME SPIN OFF IS UNIFORM)
-        if (p1_total == max_score) {
-            if (selected_winner == 0) {
-                p1_wins++;
-                continue;
-            }
-            selected_winner--;
-        }
-        if (p2_total == max_score) {
-            if (selected_winner == 0) {
-                p2_wins++;
-                continue;
+    // Every episode: per seat, the expected and recorded trips to the Showcase and the expected winnings
+    DatasetStats stats;
+    const vector<EpisodeRecord> episodes = load_episodes(options.dataset, stats);
+    struct SeatTotals {
+        long long contestants = 0, showcases = 0, known = 0;
+        double expected_showcases = 0, win_probability = 0, expected_total = 0;
+    };
+    array<SeatTotals, 3> totals;
+    for (const EpisodeRecord& episode : episodes) {
+        const array<ContestantOutlook, 6> contestants = model.solve(episode);
+        for (int i = 0; i < 6; i++) {
+            const ContestantOutlook& contestant = contestants[i];
+            SeatTotals& seat = totals[contestant.seat];
+            seat.contestants++;
+            seat.win_probability += contestant.win_probability;
+            seat.expected_total += contestant.expected_total;
+            if (int winner = episode.showdowns[i / 3].winner_index; winner >= 0) {
+                seat.known++;
+                seat.expected_showcases += contestant.showcase_probability;
+                seat.showcases += (winner == i % 3);
             }
-            selected_winner--;
-        }
-        if (p3_total == max_score) {
-            p3_wins++;
-            continue;
         }
     }
+    ResultTable dataset{"dataset", {"episodes", "episodes_skipped", "showdowns_read", "showdowns_skipped"}, {}};
+    dataset.add_row({to_string(episodes.size()), to_string(stats.episodes_skipped), to_string(stats.showdowns_read),
+                     to_string(stats.showdowns_skipped)});
+    ResultTable result{"episode_seats", {"seat", "contestants", "showcases", "expected_showcases",
+                                         "mean_win_probability", "mean_expected_total"}, {}};
+    for (int seat = 0; seat < 3; seat++) {
+        const SeatTotals& seat_totals = totals[seat];
+        const double n = max<long long>(seat_totals.contestants, 1);
+        result.add_row({player_names[seat], to_string(seat_totals.contestants), to_string(seat_totals.showcases),
+                        format_number(seat_totals.expected_showcases), format_number(seat_totals.win_probability / n),
+                        format_number(seat_totals.expected_total / n)});
+    }
+    return {dataset, result};
+}
+
+// Original output: exact win probabilities and a 1,000,000 game simulation
+template <class Num>
+void default_command(const Options& options, const DpTables<Num>& tables, const PolicySet<Num>& policies) {
+    // -- Output win probabilities --
+    for (int player = 0; player < 3; player++) {
+        string name = player_names[player];
+        name[0] = toupper(name[0]);
+        cout << name << " player's win probability: " << exact_text(tables.first_player_policy_probability(player))
+             << " (" << NumericTraits<Num>::to_double(tables.first_player_policy_probability(player)) << ")" << endl;
+    }
+    cout << endl;
 
-    // Return win probabilities
-    return {Fraction(p1_wins, num_simulations), Fraction(p2_wins, num_simulations), Fraction(p3_wins, num_simulations)};
+    // -- Run simulation based on policies --
+    vector<Fraction> simulated_win_rates = simulate_game(options.rules, tables, policies, options.games,
+                                                         options.threads, options.seed);
+    for (int player = 0; player < 3; player++) {
+        string name = player_names[player];
+        name[0] = toupper(name[0]);
+        cout << name << " player simulated wins: " << simulated_win_rates[player] << " ("
+             << simulated_win_rates[player].value() << ")" << endl;
+    }
+    cout << endl;
 }
 
+// Exact win probabilities from the multi-modular solve (--numeric modular)
+vector<ResultTable> modular_solve_command(const Options& options) {
+    if (!options.command.empty() && options.command != "solve")
+        throw invalid_argument("--numeric modular only works with solve");
+    ModularSolveOptions modular_options;
+    modular_options.threads = options.threads;
+    ModularSolveResult solve = solve_exact_modular(options.rules, options.policy, modular_options);
+
+    ResultTable result{"win_probability", {"player", "probability", "exact"}, {}};
+    for (int player = 0; player < 3; player++)
+        result.add_row({player_names[player], format_number(solve.win_probability[player].value()),
+                        solve.win_probability[player].to_string()});
+    ResultTable details{"modular", {"primes", "rounds", "decisions", "near_ties", "flipped", "fell_back"}, {}};
+    details.add_row({to_string(solve.primes), to_string(solve.rounds), to_string(solve.decisions),
+                     to_string(solve.near_ties), to_string(solve.flipped), solve.fell_back ? "yes" : "no"});
+    return {result, details};
+}
 
+// Win probabilities and their gradient with respect to the segment probabilities, from one solve over dual
+// numbers (src/dual.h)
+vector<ResultTable> sensitivity_command(const Options& options) {
+    if (policy_needs_floating(options.policy))
+        throw invalid_argument("sensitivity works with the optimal and threshold-K policies");
+    if (options.rules.segments > Dual::gradient_size)
+        throw invalid_argument("sensitivity needs --segments " + to_string(Dual::gradient_size) + " or less");
+    PolicySet<Dual> policies = policies_by_name<Dual>(options.policy, options.rules);
+    DpTables<Dual> tables = initialize_dp_tables(options.rules, policies);
+
+    ResultTable result{"win_probability", {"player", "probability"}, {}};
+    for (int player = 0; player < 3; player++)
+        result.add_row({player_names[player], format_number(tables.first_player_policy_probability(player).value)});
+    ResultTable gradient{"sensitivity", {"segment", "first", "second", "third"}, {}};
+    for (int segment = 1; segment <= options.rules.segments; segment++) {
+        vector<string> row = {to_string(segment)};
+        for (int player = 0; player < 3; player++)
+            row.push_back(format_number(tables.first_player_policy_probability(player).gradient[segment - 1]));
+        gradient.add_row(row);
+    }
+    return {result, gradient};
+}
 
-int main(void) {
+// Inverse design (src/wheel_design.h): a wheel for --target, starting from --wheel
+vector<ResultTable> design_command(const Options& options) {
+    WheelDesignOptions design_options;
+    design_options.target = options.target;
+    design_options.max_iterations = options.iterations;
+    GameRules rules = options.rules;
+    if (!rules.uniform_wheel())
+        design_options.start = rules.segment_probabilities;
+    WheelDesign design = design_wheel(rules, options.policy, design_options);
+
+    ResultTable summary{"design", {"iterations", "solves", "loss", "max_error", "converged"}, {}};
+    summary.add_row({to_string(design.iterations), to_string(design.solves), format_number(design.loss),
+                     format_number(design.max_error), design.converged ? "yes" : "no"});
+    ResultTable result{"win_probability", {"player", "target", "probability"}, {}};
+    for (int player = 0; player < 3; player++)
+        result.add_row({player_names[player], format_number(options.target[player]),
+                        format_number(design.win_probability[player])});
+    ResultTable wheel{"wheel", {"segment", "probability"}, {}};
+    string wheel_option;
+    for (int segment = 1; segment <= rules.segments; segment++) {
+        wheel.add_row({to_string(segment), format_number(design.probabilities[segment - 1])});
+        if (segment > 1)
+            wheel_option += ",";
+        wheel_option += format_number(design.probabilities[segment - 1]);
+    }
+    ResultTable progress{"progress", {"iteration", "loss", "max_error", "step"}, {}};
+    for (const WheelDesignStep& step : design.history)
+        progress.add_row({to_string(step.iteration), format_number(step.loss), format_number(step.max_error),
+                          format_number(step.step)});
+    ResultTable reuse{"wheel_option", {"wheel"}, {}}; // to solve / warm start with it
+    reuse.add_row({wheel_option});
+    return {summary, result, wheel, progress, reuse};
+}
 
-    // -- Assumptions --
-    // Uniform spin distribution from 1 to 20
-    // There is an equal probability of anyone winning in the spinoff
-    // No one is allowed to skip their first spin (including third player when both others bust)
-    // You are not allowed to spin again if you get 20 in your first spin
-    // Players plays according to their assigned policies: 
-    auto third_player_policy = third_player_optimal_policy;
-    auto second_player_policy = second_player_optimal_policy;
-    auto first_player_policy = first_player_optimal_policy;
+// -- Validation suite --
+// Every wheel / policy pair: the overall win rates and each stage's per-state win rates must fit the tables
+// (the seed is fixed unless given, so a failure reproduces)
+template <class Num>
+bool validate_configuration(const Options& options, const GameRules& rules, const string& policy_name,
+                            ResultTable& result) {
+    PolicySet<Num> policies = policies_by_name<Num>(policy_name, rules);
+    DpTables<Num> tables = options.cache_dir.empty() ? initialize_dp_tables(rules, policies)
+                                                     : load_or_solve(options.cache_dir, rules, policies);
+    const unsigned long long seed = options.seed_set ? options.seed : 20240601 + rules.segments;
+    ValidationResult validation =
+        validate_against_simulation(rules, tables, policies, options.games, options.threads, seed);
+
+    bool passed = true;
+    auto add = [&](const string& check, const GoodnessOfFit& fit, const string& tested, const string& worst,
+                   double worst_p) {
+        bool ok = fit.p_value >= options.alpha && worst_p >= options.alpha;
+        passed = passed && ok;
+        result.add_row({to_string(rules.segments), policy_name, check, format_number(fit.statistic),
+                        to_string(fit.degrees_of_freedom), format_number(fit.p_value), tested, worst,
+                        format_number(worst_p), ok ? "pass" : "FAIL"});
+    };
+    add("win_rates", validation.overall, "1", "", 1);
+    for (int player = 0; player < 3; player++) {
+        const StageFit& stage = validation.stages[player];
+        add(string(player_names[player]) + "_states", stage.combined,
+            to_string(stage.states_tested) + "/" + to_string(stage.states_tested + stage.states_skipped),
+            stage.worst_state, stage.bonferroni_p_value);
+    }
+    return passed;
+}
 
-    
-    // -- Run DP to fill tables --
-    initialize_dp_tables(third_player_policy, second_player_policy, first_player_policy);
-    // -- Output win probabilities --
-    std::cout << "First player's win probability: " << first_player_policy_probability[0] << " (" << first_player_policy_probability[0].value() << ")" << std::endl
-                << "Second player's win probability: " << first_player_policy_probability[1] << " (" << first_player_policy_probability[1].value() << ")" << std::endl
-                << "Third player's win probability: " << first_player_policy_probability[2] << " (" << first_player_policy_probability[2].value() << ")" << std::endl << std::endl;
+bool validate_command(const Options& options) {
+    ResultTable setup{"setup", {"games", "threads", "alpha"}, {}};
+    setup.add_row({to_string(options.games), to_string(options.threads), format_number(options.alpha)});
+    ResultTable result{"validation", {"segments", "policy", "check", "chi_square", "df", "p_value", "states",
+                                      "worst_state", "worst_p_bonferroni", "result"}, {}};
+    vector<pair<GameRules, string>> configurations;
+    for (int segments : {6, 10, 20}) {
+        GameRules rules = options.rules;
+        rules.segments = segments;
+        const string threshold = "threshold-" + to_string((int)lround(0.65 * segments));
+        for (const string& policy_name : {string("optimal"), threshold, string("qre-10")})
+            configurations.push_back({rules, policy_name});
+    }
 
+    // The configurations run as tasks on the thread pool (their solves and simulations split into tasks of their
+    // own); each fills its own rows, reported in the order above
+    vector<ResultTable> rows(configurations.size(), result);
+    vector<char> configuration_passed(configurations.size());
+    TaskGroup sweep;
+    for (size_t i = 0; i < configurations.size(); i++)
+        sweep.run([&, i]() {
+            const auto& [rules, policy_name] = configurations[i];
+            if (options.numeric == NumericKind::exact && !policy_needs_floating(policy_name))
+                configuration_passed[i] = validate_configuration<Fraction>(options, rules, policy_name, rows[i]);
+            else
+                configuration_passed[i] = validate_configuration<double>(options, rules, policy_name, rows[i]);
+        });
+    sweep.wait();
+
+    bool passed = true;
+    for (size_t i = 0; i < configurations.size(); i++) {
+        result.rows.insert(result.rows.end(), rows[i].rows.begin(), rows[i].rows.end());
+        passed = passed && configuration_passed[i];
+    }
+    write_report(cout, options.format, {setup, result});
+    return passed;
+}
 
-    // -- Run simulation based on policies --
-    vector<Fraction> simulated_win_rates = simulate_game(third_player_policy, second_player_policy, first_player_policy, 1'000'000);
-    std::cout << "First player simulated wins: " << simulated_win_rates[0] << " (" << simulated_win_rates[0].value() << ")" << std::endl
-                << "Second player simulated wins: " << simulated_win_rates[1] << " (" << simulated_win_rates[1].value() << ")" << std::endl
-                << "Third player simulated wins: " << simulated_win_rates[2] << " (" << simulated_win_rates[2].value() << ")" << std::endl << std::endl;
+// -- Continuous-wheel limit --
+vector<ResultTable> continuous_command(const Options& options) {
+    if (options.policy != "optimal")
+        throw invalid_argument("continuous extrapolates optimal play only");
+    const ContinuousLimit limit = solve_continuous_limit(options.rules, options.rules.segments, options.levels);
+
+    ResultTable resolutions{"resolutions", {"segments", "player1_win", "player2_win", "player3_win",
+                                            "player1_threshold", "player2_threshold"}, {}};
+    for (const WheelResolution& resolution : limit.resolutions)
+        resolutions.add_row({to_string(resolution.segments), format_number(resolution.win_probability[0]),
+                             format_number(resolution.win_probability[1]), format_number(resolution.win_probability[2]),
+                             format_number(resolution.threshold[0]), format_number(resolution.threshold[1])});
+    ResultTable estimates{"limit", {"quantity", "finest", "richardson1", "richardson2", "observed_order", "continuous",
+                                    "difference"}, {}};
+    for (const LimitEstimate& estimate : limit.estimates)
+        estimates.add_row({estimate.quantity, format_number(estimate.values.back()),
+                           format_number(estimate.richardson1), format_number(estimate.richardson2),
+                           format_number(estimate.observed_order),
+                           limit.has_continuous ? format_number(estimate.continuous) : "",
+                           limit.has_continuous ? format_number(estimate.richardson2 - estimate.continuous) : ""});
+    // Each wheel's error against the limit (the direct solve, else the extrapolation); the ratio of successive
+    // errors is 2 while it converges like 1/W
+    ResultTable convergence{"convergence", {"quantity", "segments", "error", "ratio"}, {}};
+    for (const LimitEstimate& estimate : limit.estimates) {
+        const double target = limit.has_continuous ? estimate.continuous : estimate.richardson2;
+        for (size_t level = 0; level < estimate.values.size(); level++) {
+            const double error = estimate.values[level] - target;
+            convergence.add_row({estimate.quantity, to_string(limit.resolutions[level].segments), format_number(error),
+                                 level > 0 ? format_number((estimate.values[level - 1] - target) / error) : ""});
+        }
+    }
+    return {resolutions, estimates, convergence};
+}
 
-    return 0;
-}
\ No newline at end of file
+// -- Rule-variant sweep --
+// false if a variant failed (it is solved again when the sweep is resumed)
+bool sweep_command(const Options& options) {
+    if (options.out_path.empty())
+        throw invalid_argument("sweep needs a results file (--out)");
+    SweepSpec spec;
+    if (!options.spec_path.empty())
+        spec = load_sweep_spec(options.spec_path);
+    else if (filesystem::exists(options.out_path))
+        spec = load_sweep_results(options.out_path).spec; // resume with the spec stored in the file
+    else
+        throw invalid_argument("sweep needs a spec (--spec) to start " + options.out_path);
+    SweepResults results = run_sweep(spec, options.out_path, {options.cache_dir});
+
+    ResultTable summary{"sweep", {"variants", "resumed", "solved", "failed", "results"}, {}};
+    summary.add_row({to_string(results.records.size()), to_string(results.resumed), to_string(results.solved),
+                     to_string(results.failures.size()), options.out_path});
+    ResultTable variants{"variants", {"variant", "segments", "spins", "policy", "numeric", "player1", "player2",
+                                      "player3", "player1_stays_from", "player2_stays_from"}, {}};
+    for (const SweepRecord& record : results.records) {
+        const SweepVariant variant = spec.variant(record.variant);
+        vector<string> row = {to_string(record.variant), to_string(variant.segments),
+                              to_string(variant.spins_per_turn), variant.policy};
+        if (record.status == (uint8_t)SweepStatus::solved) {
+            row.push_back(record.numeric == (uint8_t)NumericKind::exact ? "exact" : "floating");
+            for (double probability : record.win_probability)
+                row.push_back(format_number(probability));
+            row.push_back(to_string(record.stays_from[0]));
+            row.push_back(to_string(record.stays_from[1]));
+        } else {
+            row.push_back("failed");
+            row.resize(variants.columns.size());
+        }
+        variants.add_row(row);
+    }
+    vector<ResultTable> tables = {summary, variants};
+    if (!results.failures.empty()) {
+        ResultTable failures{"failures", {"variant", "error"}, {}};
+        for (const auto& [variant, error] : results.failures)
+            failures.add_row({to_string(variant), error});
+        tables.push_back(failures);
+    }
+    write_report(cout, options.format, tables);
+    return results.failures.empty();
+}
+
+// -- Run DP to fill tables (or load them from the table cache) --
+template <class Num>
+DpTables<Num> solve_tables(const Options& options, const PolicySet<Num>& policies) {
+    return options.cache_dir.empty() ? initialize_dp_tables(options.rules, policies)
+                                     : load_or_solve(options.cache_dir, options.rules, policies);
+}
+
+// Table set for the daemon (initial load and every swap): the solver's tables, or compact tables (--storage)
+template <class Num>
+shared_ptr<const QueryTables> load_query_tables(const Options& options, const string& policy_name) {
+    PolicySet<Num> policies = policies_by_name<Num>(policy_name, options.rules);
+    DpTables<Num> tables = solve_tables(options, policies);
+    if (options.storage.empty())
+        return make_query_tables(options.rules, tables, policies);
+    return make_query_tables(
+        CompactTables::build(options.rules, tables, policies, parse_table_storage(options.storage)), policy_name);
+}
+
+shared_ptr<const QueryTables> load_query_tables(const Options& options, const string& policy_name) {
+    if (options.numeric == NumericKind::floating || policy_needs_floating(policy_name))
+        return load_query_tables<double>(options, policy_name);
+    return load_query_tables<Fraction>(options, policy_name);
+}
+
+void daemon_command(const Options& options) {
+    QueryServer::block_signals(); // before the first solve starts any thread
+    QueryServer server(options.socket_path,
+                       [&options](const string& policy_name) { return load_query_tables(options, policy_name); },
+                       options.policy);
+    cerr << "query server: listening on " << options.socket_path << endl;
+    server.run(true);
+    QueryServer::Stats stats = server.stats();
+    cerr << "query server: " << stats.requests << " requests in " << stats.batches << " batches from "
+         << stats.connections << " connections" << endl;
+}
+
+template <class Num>
+void run(const Options& options) {
+    PolicySet<Num> policies = policies_by_name<Num>(options.policy, options.rules);
+    DpTables<Num> tables = solve_tables(options, policies);
+
+    vector<ResultTable> results;
+    if (options.command.empty()) {
+        default_command(options, tables, policies);
+        return;
+    } else if (options.command == "solve") {
+        results = solve_command(options, tables);
+    } else if (options.command == "simulate") {
+        results = simulate_command(options, tables, policies);
+    } else if (options.command == "replay") {
+        results = replay_command(options, tables, policies);
+    } else if (options.command == "query") {
+        results = query_command(options, tables, policies);
+    } else if (options.command == "chain") {
+        results = chain_command(options, tables, policies);
+    } else if (options.command == "distribution") {
+        results = distribution_command(options, tables, policies);
+    } else if (options.command == "episode") {
+        results = episode_command(options, tables);
+    } else if (options.command == "memory") {
+        results = memory_command(options, tables, policies);
+    } else {
+        throw invalid_argument("Unknown command '" + options.command + "'");
+    }
+    write_report(cout, options.format, results);
+}
+
+
+int main(int argc, char** argv) {
+    int status = 0;
+    try {
+        Options options = parse_options(argc, argv);
+        if (options.workers > 0)
+            ThreadPool::set_shared_threads(options.workers);
+        if (options.command == "daemon")
+            daemon_command(options);
+        else if (options.command == "design")
+            write_report(cout, options.format, design_command(options));
+        else if (options.command == "sensitivity")
+            write_report(cout, options.format, sensitivity_command(options));
+        else if (options.command == "continuous")
+            write_report(cout, options.format, continuous_command(options));
+        else if (options.command == "sweep")
+            status = sweep_command(options) ? 0 : 1;
+        else if (options.command == "validate")
+            status = validate_command(options) ? 0 : 1;
+        else if (options.numeric == NumericKind::modular)
+            write_report(cout, options.format, modular_solve_command(options));
+        else if (options.numeric == NumericKind::exact)
+            run<Fraction>(options);
+        else
+            run<double>(options);
+
+        // -- Instrumentation (counters / timers are only recorded in PIR_INSTRUMENT builds) --
+        if (!options.trace_path.empty()) {
+            instrumentation::print_report(cerr);
+            ThreadPool::shared().print_stats(cerr);
+            instrumentation::write_chrome_trace(options.trace_path);
+        }
+    } catch (const exception& e) {
+        cerr << "price_is_right: " << e.what() << endl << endl << usage;
+        return 1;
+    }
+    return status;
+}
@@ -0,0 +1,36 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dp_solver.h"
+#include "instrumentation.h"
+#include "simulator.h"
+using namespace std;
+
+
+// Usage: pir_simulate [games] [threads] [seed]
+// Solves the DP tables for the optimal policies, then simulates games with those policies
+int main(int argc, char** argv) {
+    long long num_simulations = (argc > 1) ? stoll(argv[1]) : 1'000'000;
+    int num_threads = (argc > 2) ? stoi(argv[2]) : (int)max(1u, thread::hardware_concurrency());
+    unsigned long long seed = (argc > 3) ? stoull(argv[3]) : time(0);
+
+    // The optimal policies read the DP tables, so they have to be filled first
+    GameRules rules;
+    PolicySet<Fraction> policies = optimal_policies<Fraction>();
+    DpTables<Fraction> tables = initialize_dp_tables(rules, policies);
+
+    vector<Fraction> simulated_win_rates = simulate_game(rules, tables, policies, num_simulations, num_threads, seed);
+    cout << "Simulated " << num_simulations << " games on " << num_threads << " thread(s), seed " << seed << endl
+         << "First player simulated wins: " << simulated_win_rates[0] << " (" << simulated_win_rates[0].value() << ")" << endl
+         << "Second player simulated wins: " << simulated_win_rates[1] << " (" << simulated_win_rates[1].value() << ")" << endl
+         << "Third player simulated wins: " << simulated_win_rates[2] << " (" << simulated_win_rates[2].value() << ")" << endl;
+    // -- Instrumentation (counters / timers are only recorded in PIR_INSTRUMENT builds) --
+    if (const char* trace_path = getenv("PIR_TRACE")) { // e.g. PIR_TRACE=trace.json
+        instrumentation::print_report(cerr);
+        instrumentation::write_chrome_trace(trace_path);
+    }
+
+    return 0;
+}
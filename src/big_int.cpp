@@ -0,0 +1,276 @@
+#include "big_int.h"
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+
+using Limbs = vector<uint32_t>;
+
+strong_ordering compare_magnitude(const Limbs& a, const Limbs& b) {
+    if (a.size() != b.size())
+        return a.size() <=> b.size();
+    for (size_t i = a.size(); i-- > 0;)
+        if (a[i] != b[i])
+            return a[i] <=> b[i];
+    return strong_ordering::equal;
+}
+
+Limbs add_magnitude(const Limbs& a, const Limbs& b) {
+    const Limbs& longer = a.size() >= b.size() ? a : b;
+    const Limbs& shorter = a.size() >= b.size() ? b : a;
+    Limbs sum(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); i++) {
+        carry += (uint64_t)longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        sum[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    sum.back() = (uint32_t)carry;
+    return sum;
+}
+
+// a - b, requires |a| >= |b|
+Limbs subtract_magnitude(const Limbs& a, const Limbs& b) {
+    Limbs difference(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        int64_t value = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = value < 0;
+        difference[i] = (uint32_t)(value + (borrow << 32));
+    }
+    return difference;
+}
+
+Limbs multiply_magnitude(const Limbs& a, const Limbs& b) {
+    if (a.empty() || b.empty())
+        return {};
+    Limbs product(a.size() + b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.size(); j++) {
+            carry += (uint64_t)a[i] * b[j] + product[i + j];
+            product[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        product[i + b.size()] = (uint32_t)carry;
+    }
+    return product;
+}
+
+void trim_limbs(Limbs& limbs) {
+    while (!limbs.empty() && limbs.back() == 0)
+        limbs.pop_back();
+}
+
+// Long division of magnitudes
+void divide_magnitude(const Limbs& a, const Limbs& b, Limbs& quotient, Limbs& remainder) {
+    quotient.assign(a.size(), 0);
+    if (b.size() <= 2) { // divisor fits in 64 bits: short division with a 128 bit running remainder
+        const uint64_t divisor = (b.size() == 2) ? ((uint64_t)b[1] << 32) | b[0] : b[0];
+        unsigned __int128 rest = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            rest = (rest << 32) | a[i];
+            quotient[i] = (uint32_t)(rest / divisor);
+            rest %= divisor;
+        }
+        remainder = {(uint32_t)rest, (uint32_t)(rest >> 32)};
+        trim_limbs(remainder);
+        trim_limbs(quotient);
+        return;
+    }
+    if (compare_magnitude(a, b) < 0) {
+        quotient.clear();
+        remainder = a;
+        return;
+    }
+
+    // Knuth, TAOCP 4.3.1 algorithm D: normalize so the divisor's top limb has its high bit set, then estimate
+    // each quotient limb from the top two limbs and correct it at most twice
+    const size_t n = b.size(), m = a.size() - n;
+    const int shift = __builtin_clz(b.back());
+    Limbs divisor(n), rest(a.size() + 1);
+    for (size_t i = n; i-- > 0;)
+        divisor[i] = (b[i] << shift) | (shift && i ? b[i - 1] >> (32 - shift) : 0);
+    rest[a.size()] = shift ? a.back() >> (32 - shift) : 0;
+    for (size_t i = a.size(); i-- > 0;)
+        rest[i] = (a[i] << shift) | (shift && i ? a[i - 1] >> (32 - shift) : 0);
+
+    const uint64_t base = 1ull << 32;
+    for (size_t j = m + 1; j-- > 0;) {
+        uint64_t top = ((uint64_t)rest[j + n] << 32) | rest[j + n - 1];
+        uint64_t estimate = top / divisor[n - 1];
+        uint64_t estimate_rest = top % divisor[n - 1];
+        while (estimate >= base || estimate * divisor[n - 2] > ((estimate_rest << 32) | rest[j + n - 2])) {
+            estimate--;
+            estimate_rest += divisor[n - 1];
+            if (estimate_rest >= base)
+                break;
+        }
+        // rest[j .. j + n] -= estimate * divisor
+        int64_t borrow = 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t product = estimate * divisor[i] + carry;
+            carry = product >> 32;
+            int64_t value = (int64_t)rest[i + j] - borrow - (int64_t)(product & 0xffffffffu);
+            rest[i + j] = (uint32_t)value;
+            borrow = value < 0;
+        }
+        int64_t value = (int64_t)rest[j + n] - borrow - (int64_t)carry;
+        rest[j + n] = (uint32_t)value;
+        if (value < 0) { // estimate was one too large: add the divisor back
+            estimate--;
+            carry = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t sum = (uint64_t)rest[i + j] + divisor[i] + carry;
+                rest[i + j] = (uint32_t)sum;
+                carry = sum >> 32;
+            }
+            rest[j + n] += (uint32_t)carry;
+        }
+        quotient[j] = (uint32_t)estimate;
+    }
+    remainder.assign(n, 0);
+    for (size_t i = 0; i < n; i++)
+        remainder[i] = (rest[i] >> shift) | (shift ? rest[i + 1] << (32 - shift) : 0);
+    trim_limbs(remainder);
+    trim_limbs(quotient);
+}
+
+} // namespace
+
+
+BigInt::BigInt(long long value) {
+    negative = value < 0;
+    unsigned long long magnitude = negative ? 0ull - (unsigned long long)value : (unsigned long long)value;
+    while (magnitude) {
+        limbs.push_back((uint32_t)magnitude);
+        magnitude >>= 32;
+    }
+}
+
+void BigInt::trim() {
+    trim_limbs(limbs);
+    if (limbs.empty())
+        negative = false;
+}
+
+BigInt BigInt::abs() const {
+    BigInt result = *this;
+    result.negative = false;
+    return result;
+}
+
+bool BigInt::fits_long_long() const {
+    if (limbs.size() <= 1)
+        return true;
+    if (limbs.size() > 2)
+        return false;
+    uint64_t magnitude = ((uint64_t)limbs[1] << 32) | limbs[0];
+    return magnitude <= (negative ? (1ull << 63) : (1ull << 63) - 1);
+}
+
+long long BigInt::to_long_long() const {
+    uint64_t magnitude = 0;
+    for (size_t i = 0; i < min<size_t>(limbs.size(), 2); i++)
+        magnitude |= (uint64_t)limbs[i] << (32 * i);
+    return (long long)(negative ? 0ull - magnitude : magnitude);
+}
+
+string BigInt::to_string() const {
+    if (is_zero())
+        return "0";
+    string digits;
+    Limbs rest = limbs, quotient, remainder;
+    while (!rest.empty()) {
+        divide_magnitude(rest, {1'000'000'000u}, quotient, remainder);
+        uint32_t chunk = remainder.empty() ? 0 : remainder[0];
+        for (int i = 0; i < 9 && (chunk || !quotient.empty() || i == 0); i++) {
+            digits.push_back(char('0' + chunk % 10));
+            chunk /= 10;
+        }
+        rest = quotient;
+    }
+    if (negative)
+        digits.push_back('-');
+    reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+BigInt BigInt::operator-() const {
+    BigInt result = *this;
+    result.negative = !negative && !is_zero();
+    return result;
+}
+
+BigInt operator+(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    if (a.negative == b.negative) {
+        result.limbs = add_magnitude(a.limbs, b.limbs);
+        result.negative = a.negative;
+    } else if (compare_magnitude(a.limbs, b.limbs) >= 0) {
+        result.limbs = subtract_magnitude(a.limbs, b.limbs);
+        result.negative = a.negative;
+    } else {
+        result.limbs = subtract_magnitude(b.limbs, a.limbs);
+        result.negative = b.negative;
+    }
+    result.trim();
+    return result;
+}
+
+BigInt operator-(const BigInt& a, const BigInt& b) {
+    return a + (-b);
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    result.limbs = multiply_magnitude(a.limbs, b.limbs);
+    result.negative = a.negative != b.negative;
+    result.trim();
+    return result;
+}
+
+void BigInt::divide(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder) {
+    if (b.is_zero())
+        throw domain_error("BigInt division by zero");
+    Limbs q, r;
+    divide_magnitude(a.limbs, b.limbs, q, r);
+    quotient.limbs = std::move(q);
+    quotient.negative = a.negative != b.negative;
+    quotient.trim();
+    remainder.limbs = std::move(r);
+    remainder.negative = a.negative;
+    remainder.trim();
+}
+
+BigInt operator/(const BigInt& a, const BigInt& b) {
+    BigInt quotient, remainder;
+    BigInt::divide(a, b, quotient, remainder);
+    return quotient;
+}
+
+BigInt operator%(const BigInt& a, const BigInt& b) {
+    BigInt quotient, remainder;
+    BigInt::divide(a, b, quotient, remainder);
+    return remainder;
+}
+
+strong_ordering operator<=>(const BigInt& a, const BigInt& b) {
+    if (a.sign() != b.sign())
+        return a.sign() <=> b.sign();
+    strong_ordering magnitude = compare_magnitude(a.limbs, b.limbs);
+    return a.negative ? 0 <=> magnitude : magnitude;
+}
+
+BigInt BigInt::gcd(BigInt a, BigInt b) {
+    a = a.abs();
+    b = b.abs();
+    while (!b.is_zero()) {
+        BigInt rest = a % b;
+        a = std::move(b);
+        b = std::move(rest);
+    }
+    return a;
+}
@@ -0,0 +1,51 @@
+#ifndef BIG_INT_H
+#define BIG_INT_H
+
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// --- Big integers ---
+// Arbitrary precision signed integers, simple rather than fast: the reference arithmetic that the fixed-width
+// types are checked against (tools/fraction_check.cpp), not something to run in the solver's inner loops.
+class BigInt {
+public:
+    BigInt() = default; // 0
+    BigInt(long long value);
+
+    bool is_zero() const { return limbs.empty(); }
+    int sign() const { return is_zero() ? 0 : (negative ? -1 : 1); }
+    BigInt abs() const;
+
+    // true if the value is representable as a long long
+    bool fits_long_long() const;
+    long long to_long_long() const; // value modulo 2^64 (as two's complement) if it doesn't fit
+
+    std::string to_string() const;
+
+    BigInt operator-() const;
+    friend BigInt operator+(const BigInt& a, const BigInt& b);
+    friend BigInt operator-(const BigInt& a, const BigInt& b);
+    friend BigInt operator*(const BigInt& a, const BigInt& b);
+    // Truncating division (like the built-in integers): a == (a / b) * b + a % b, |a % b| < |b|
+    // (throws std::domain_error when b is zero)
+    friend BigInt operator/(const BigInt& a, const BigInt& b);
+    friend BigInt operator%(const BigInt& a, const BigInt& b);
+    static void divide(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder);
+
+    friend bool operator==(const BigInt& a, const BigInt& b) = default;
+    friend std::strong_ordering operator<=>(const BigInt& a, const BigInt& b);
+
+    // Greatest common divisor (non-negative, gcd(0, 0) == 0)
+    static BigInt gcd(BigInt a, BigInt b);
+
+private:
+    bool negative = false;       // never set for 0
+    std::vector<uint32_t> limbs; // magnitude, least significant first, no leading zero limbs
+
+    void trim();
+};
+
+#endif // BIG_INT_H
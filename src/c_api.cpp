@@ -0,0 +1,230 @@
+#include "c_api.h"
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "policies.h"
+#include "query_server.h"
+#include "simulator.h"
+#include "table_cache.h"
+using namespace std;
+
+namespace {
+
+thread_local string last_error;
+
+// Engine behind the opaque handle: one implementation per number type
+class Engine {
+public:
+    virtual ~Engine() = default;
+    virtual const QueryTables& query_tables() const = 0;
+    virtual pir_table_layout layout() const = 0;
+    virtual void win_probabilities(double* out) const = 0;
+    virtual void simulate(int64_t games, int threads, uint64_t seed, int64_t* wins) const = 0;
+    virtual void export_tables(double* out) const = 0;
+    virtual void export_tables_exact(int64_t* numerators, int64_t* denominators) const = 0;
+    virtual const double* table_data() const = 0;
+};
+
+template <class Num>
+class EngineImpl : public Engine {
+public:
+    EngineImpl(const GameRules& rules, const pir_config& config) : rules(rules) {
+        policies = policies_by_name<Num>(config.policy ? config.policy : "optimal", rules);
+        tables = config.cache_dir ? load_or_solve(config.cache_dir, rules, policies) : initialize_dp_tables(rules, policies);
+        queries = make_query_tables(rules, tables, policies);
+    }
+
+    const QueryTables& query_tables() const override { return *queries; }
+
+    // The C API's games have two spins per turn, so the 3rd player's options are always stored by class
+    pir_table_layout layout() const override {
+        const Num* base = tables.values();
+        auto offset = [base](const Num& value) { return (uint64_t)(&value - base); };
+        return {
+            rules.scores(),
+            (int32_t)NumericTraits<Num>::kind,
+            tables.size(),
+            offset(tables.third_player_class_probability(0, 0, 0, 0, 0)),
+            offset(tables.third_player_policy_probability(0, 0, 0)),
+            offset(tables.second_player_probability(0, 0, 0, 0)),
+            offset(tables.second_player_policy_probability(0, 0)),
+            offset(tables.first_player_probability(0, 0, 0)),
+            offset(tables.first_player_policy_probability(0)),
+        };
+    }
+
+    void win_probabilities(double* out) const override {
+        for (int player = 0; player < 3; player++)
+            out[player] = NumericTraits<Num>::to_double(tables.first_player_policy_probability(player));
+    }
+
+    void simulate(int64_t games, int threads, uint64_t seed, int64_t* wins) const override {
+        vector<Fraction> rates = simulate_game(rules, tables, policies, games, threads, seed);
+        for (int player = 0; player < 3; player++) // rates are wins / games, simplified
+            wins[player] = rates[player].getNumerator() * (games / rates[player].getDenominator());
+    }
+
+    void export_tables(double* out) const override {
+        const Num* values = tables.values();
+        for (size_t i = 0; i < tables.size(); i++)
+            out[i] = NumericTraits<Num>::to_double(values[i]);
+    }
+
+    void export_tables_exact(int64_t* numerators, int64_t* denominators) const override {
+        if constexpr (NumericTraits<Num>::kind == NumericKind::exact) {
+            const Num* values = tables.values();
+            for (size_t i = 0; i < tables.size(); i++) {
+                numerators[i] = values[i].getNumerator();
+                denominators[i] = values[i].getDenominator();
+            }
+        } else {
+            throw invalid_argument("Exact export needs an exact engine");
+        }
+    }
+
+    const double* table_data() const override {
+        if constexpr (NumericTraits<Num>::kind == NumericKind::floating)
+            return tables.values();
+        else
+            return nullptr;
+    }
+
+private:
+    GameRules rules;
+    PolicySet<Num> policies;
+    DpTables<Num> tables;
+    shared_ptr<const QueryTables> queries;
+};
+
+const Engine& engine_of(const pir_engine* engine) {
+    if (engine == nullptr)
+        throw invalid_argument("engine is NULL");
+    return *reinterpret_cast<const Engine*>(engine);
+}
+
+void require(bool condition, const char* message) {
+    if (!condition)
+        throw invalid_argument(message);
+}
+
+// Run body, turning exceptions into error codes + pir_last_error
+template <class Body>
+int guarded(Body body) {
+    try {
+        body();
+        return PIR_OK;
+    } catch (const invalid_argument& e) {
+        last_error = e.what();
+        return PIR_ERROR_INVALID_ARGUMENT;
+    } catch (const exception& e) {
+        last_error = e.what();
+        return PIR_ERROR_FAILED;
+    }
+}
+
+} // namespace
+
+
+extern "C" {
+
+int pir_api_version(void) {
+    return PIR_API_VERSION;
+}
+
+const char* pir_last_error(void) {
+    return last_error.c_str();
+}
+
+pir_engine* pir_engine_create(const pir_config* config) {
+    Engine* engine = nullptr;
+    int status = guarded([&]() {
+        require(config != nullptr, "config is NULL");
+        GameRules rules;
+        if (config->segments != 0)
+            rules.segments = config->segments;
+        require(rules.segments >= 1 && rules.segments <= 255, "segments must be between 1 and 255");
+        require(config->numeric == PIR_NUMERIC_EXACT || config->numeric == PIR_NUMERIC_FLOATING, "unknown numeric kind");
+        if (config->numeric == PIR_NUMERIC_FLOATING || (config->policy && policy_needs_floating(config->policy)))
+            engine = new EngineImpl<double>(rules, *config);
+        else
+            engine = new EngineImpl<Fraction>(rules, *config);
+    });
+    return status == PIR_OK ? reinterpret_cast<pir_engine*>(engine) : nullptr;
+}
+
+void pir_engine_destroy(pir_engine* engine) {
+    delete reinterpret_cast<Engine*>(engine);
+}
+
+int pir_engine_layout(const pir_engine* engine, pir_table_layout* layout) {
+    return guarded([&]() {
+        require(layout != nullptr, "layout is NULL");
+        *layout = engine_of(engine).layout();
+    });
+}
+
+int pir_win_probabilities(const pir_engine* engine, double* out) {
+    return guarded([&]() {
+        require(out != nullptr, "out is NULL");
+        engine_of(engine).win_probabilities(out);
+    });
+}
+
+int pir_query_states(const pir_engine* engine, size_t n, const int32_t* player, const int32_t* p1, const int32_t* p2,
+                     const int32_t* spin, double* spin_probability, double* win_probability) {
+    return guarded([&]() {
+        const QueryTables& tables = engine_of(engine).query_tables();
+        require(n == 0 || (player && p1 && p2 && spin && win_probability), "state or output array is NULL");
+        for (size_t i = 0; i < n; i++) {
+            require(p1[i] >= 0 && p2[i] >= 0 && spin[i] >= 0 && p1[i] <= tables.segments()
+                    && p2[i] <= tables.segments() && spin[i] <= tables.segments(), "state outside the tables");
+            query_protocol::Request request{};
+            request.kind = query_protocol::RequestKind::state;
+            request.player = (uint8_t)max(0, min(player[i], 255));
+            request.p1 = (uint8_t)p1[i];
+            request.p2 = (uint8_t)p2[i];
+            request.spin = (uint8_t)spin[i];
+            query_protocol::Response response{};
+            tables.answer(request, response);
+            require(response.status == query_protocol::Status::ok, "player must be 1, 2 or 3");
+            if (spin_probability)
+                spin_probability[i] = response.spin_probability;
+            for (int k = 0; k < 3; k++)
+                win_probability[3 * i + k] = response.win_probability[k];
+        }
+    });
+}
+
+int pir_simulate(const pir_engine* engine, int64_t games, int32_t threads, uint64_t seed, int64_t* wins) {
+    return guarded([&]() {
+        require(wins != nullptr, "wins is NULL");
+        require(games > 0 && threads > 0, "games and threads must be positive");
+        engine_of(engine).simulate(games, threads, seed, wins);
+    });
+}
+
+int pir_export_tables(const pir_engine* engine, double* out, size_t count) {
+    return guarded([&]() {
+        require(out != nullptr && count == engine_of(engine).layout().value_count, "out must hold value_count values");
+        engine_of(engine).export_tables(out);
+    });
+}
+
+int pir_export_tables_exact(const pir_engine* engine, int64_t* numerators, int64_t* denominators, size_t count) {
+    return guarded([&]() {
+        require(numerators && denominators && count == engine_of(engine).layout().value_count,
+                "numerators / denominators must hold value_count values");
+        engine_of(engine).export_tables_exact(numerators, denominators);
+    });
+}
+
+const double* pir_table_data(const pir_engine* engine) {
+    const double* data = nullptr;
+    guarded([&]() {
+        data = engine_of(engine).table_data();
+        require(data != nullptr, "only floating engines share their tables");
+    });
+    return data;
+}
+
+} // extern "C"
@@ -0,0 +1,100 @@
+#ifndef PIR_C_API_H
+#define PIR_C_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * --- C API (libpir) ---
+ * A stable C interface to the solver, simulator and table lookups for other languages (Python ctypes / numpy,
+ * see PyCharmMiscProject/pir_engine.py). Plain structs and caller-owned buffers only: every function that
+ * returns arrays writes them into memory the caller passes in, so numpy arrays can be filled in place.
+ *
+ * Functions returning int return PIR_OK or a negative PIR_ERROR_*; pir_last_error() then describes the
+ * failure (per thread). An engine is immutable after pir_engine_create and may be used from several threads.
+ * Totals and spins are in wheel units (1 = 5 cents on the standard wheel), 0 = bust.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define PIR_API __declspec(dllexport)
+#else
+#define PIR_API __attribute__((visibility("default")))
+#endif
+
+#define PIR_API_VERSION 2 /* bumped on any incompatible change */
+
+enum {
+    PIR_OK = 0,
+    PIR_ERROR_INVALID_ARGUMENT = -1, /* bad pointer, size, state or configuration */
+    PIR_ERROR_FAILED = -2            /* the engine threw (out of memory, unreadable cache, ...) */
+};
+
+enum {
+    PIR_NUMERIC_EXACT = 0,   /* Fraction tables */
+    PIR_NUMERIC_FLOATING = 1 /* double tables (needed by qre-LAMBDA) */
+};
+
+typedef struct pir_engine pir_engine;
+
+typedef struct {
+    int32_t segments;      /* wheel segments, 0 = standard (20) */
+    int32_t numeric;       /* PIR_NUMERIC_*; qre policies always use floating */
+    const char* policy;    /* "optimal", "threshold-K", "qre-LAMBDA"; NULL = optimal */
+    const char* cache_dir; /* table cache directory, NULL = always solve */
+} pir_config;
+
+/* Offsets (in values) and sizes of the six tables in the table block; see src/dp_tables.h for the index order.
+ * The block holds value_count values, the table dimensions are all scores = segments + 1. */
+typedef struct {
+    int32_t scores;
+    int32_t numeric;
+    uint64_t value_count;
+    uint64_t third_player_offset;         /* [scores][2][scores][2][3]: per (leading total, tied) class */
+    uint64_t third_player_policy_offset;  /* [scores][scores][3] */
+    uint64_t second_player_offset;        /* [scores][scores][2][3] */
+    uint64_t second_player_policy_offset; /* [scores][3] */
+    uint64_t first_player_offset;         /* [scores][2][3] */
+    uint64_t first_player_policy_offset;  /* [3] */
+} pir_table_layout;
+
+PIR_API int pir_api_version(void);
+PIR_API const char* pir_last_error(void);
+
+/* Solve (or load from the cache) the tables of a configuration. NULL on failure. */
+PIR_API pir_engine* pir_engine_create(const pir_config* config);
+PIR_API void pir_engine_destroy(pir_engine* engine);
+
+PIR_API int pir_engine_layout(const pir_engine* engine, pir_table_layout* layout);
+
+/* Each player's win probability before the game (out[3]) */
+PIR_API int pir_win_probabilities(const pir_engine* engine, double* out);
+
+/* n decision states in parallel arrays: player (1-3), the earlier players' totals p1 / p2 and the player's first
+ * spin (0 = before spinning). Writes the policy's spin-again probability (spin_probability[n], 0 before the first
+ * spin; may be NULL) and each player's win probability from the state on (win_probability[n][3], row-major). */
+PIR_API int pir_query_states(const pir_engine* engine, size_t n, const int32_t* player, const int32_t* p1,
+                             const int32_t* p2, const int32_t* spin, double* spin_probability,
+                             double* win_probability);
+
+/* Simulate games under the engine's policies; wins[3] = games each player won.
+ * The same (seed, threads) always gives the same result. */
+PIR_API int pir_simulate(const pir_engine* engine, int64_t games, int32_t threads, uint64_t seed, int64_t* wins);
+
+/* Copy all tables into out[count] as doubles (count must be layout.value_count) */
+PIR_API int pir_export_tables(const pir_engine* engine, double* out, size_t count);
+
+/* Exact engines: copy the tables as numerator / denominator pairs (each array count values) */
+PIR_API int pir_export_tables_exact(const pir_engine* engine, int64_t* numerators, int64_t* denominators,
+                                    size_t count);
+
+/* Floating engines: the engine's own table block, no copy (read-only, valid until pir_engine_destroy) */
+PIR_API const double* pir_table_data(const pir_engine* engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIR_C_API_H */
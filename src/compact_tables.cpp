@@ -0,0 +1,240 @@
+#include "compact_tables.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include "instrumentation.h"
+using namespace std;
+
+
+TableStorage parse_table_storage(const string& name) {
+    if (name == "float64") return TableStorage::float64;
+    if (name == "float32") return TableStorage::float32;
+    if (name == "float16") return TableStorage::float16;
+    if (name == "rational32") return TableStorage::rational32;
+    throw invalid_argument("Unknown table storage '" + name + "' (float64, float32, float16 or rational32)");
+}
+
+const char* table_storage_name(TableStorage storage) {
+    switch (storage) {
+    case TableStorage::float64: return "float64";
+    case TableStorage::float32: return "float32";
+    case TableStorage::float16: return "float16";
+    case TableStorage::rational32: return "rational32";
+    }
+    return "?";
+}
+
+
+// -- Half precision --
+uint16_t float_to_half(float value) {
+    const uint32_t bits = bit_cast<uint32_t>(value);
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    const int exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent == 0xff) // inf / nan
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    const int half_exponent = exponent - 127 + 15;
+    if (half_exponent >= 31) // too large: inf
+        return sign | 0x7c00;
+    if (half_exponent <= 0) { // subnormal (or zero)
+        if (half_exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        const int shift = 14 - half_exponent;
+        uint32_t half_mantissa = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half_mantissa & 1)))
+            half_mantissa++;
+        return sign | (uint16_t)half_mantissa;
+    }
+    uint16_t half = sign | (uint16_t)(half_exponent << 10) | (uint16_t)(mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++; // a carry into the exponent is still the right rounding
+    return half;
+}
+
+float half_to_float(uint16_t half) {
+    const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    const int exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+    if (exponent == 0) { // zero / subnormal: mantissa * 2^-24
+        float magnitude = ldexp((float)mantissa, -24);
+        return sign ? -magnitude : magnitude;
+    }
+    if (exponent == 31)
+        return bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+    return bit_cast<float>(sign | (uint32_t)(exponent - 15 + 127) << 23 | (mantissa << 13));
+}
+
+
+// -- Compact tables --
+size_t CompactTables::section_entries(int section) const {
+    const int player = section % 3 + 1;
+    size_t states = (player == 1) ? 1 : (player == 2) ? scores() : third_player_classes ? (size_t)scores() * 2
+                                                                                       : (size_t)scores() * scores();
+    return states * scores() * (section < 3 ? 3 : 1);
+}
+
+template <class Num>
+CompactTables CompactTables::build(const GameRules& rules, const DpTables<Num>& tables,
+                                   const PolicySet<Num>& policies, TableStorage storage)
+{
+    PIR_SCOPED_TIMER("compact_tables_build");
+    using Traits = NumericTraits<Num>;
+    if (storage == TableStorage::rational32 && Traits::kind != NumericKind::exact)
+        throw invalid_argument("rational32 storage needs exact tables");
+
+    CompactTables compact;
+    compact.num_segments = rules.segments;
+    compact.storage_kind = storage;
+    size_t total = 0;
+    for (int section = 0; section < 6; section++) {
+        compact.offsets[section] = total;
+        total += compact.section_entries(section);
+    }
+
+    // Fold the policy into the option values (in the tables' own number type)
+    const int segments = rules.segments, scores = rules.scores();
+    vector<Num> values(total, Traits::ratio(0, 1));
+    for (int player = 1; player <= 3; player++) {
+        const int p1_end = (player >= 2) ? scores : 1, p2_end = (player == 3) ? scores : 1;
+        for (int p1 = 0; p1 < p1_end; p1++) {
+            for (int p2 = 0; p2 < p2_end; p2++) {
+                const size_t state = compact.state_index(player, p1, p2);
+                for (int spin = 0; spin <= segments; spin++) {
+                    Num* win = &values[compact.offsets[win_section(player)] + (state * scores + spin) * 3];
+                    for (int k = 0; k < 3; k++)
+                        win[k] = policy_state_probability(tables, rules, policies, player, p1, p2, spin, k);
+                    if (spin > 0 && spin < segments)
+                        values[compact.offsets[spin_section(player)] + state * scores + spin] =
+                            (player == 1) ? policies.first_player(tables, spin, 1)
+                            : (player == 2) ? policies.second_player(tables, p1, spin, 1)
+                            : policies.third_player(tables, p1, p2, spin, 1);
+                }
+            }
+        }
+    }
+
+    // Detect the third player's classes: every (p1, p2) must match its class's first member, (leader, leader)
+    // when tied and (leader, 0) otherwise, with players 1 and 2 swapped when p2 leads
+    const size_t third_win = compact.offsets[win_section(3)], third_spin = compact.offsets[spin_section(3)];
+    auto member = [&](int p1, int p2) { return (size_t)p1 * scores + p2; };
+    bool by_class = true;
+    for (int p1 = 0; p1 < scores && by_class; p1++) {
+        for (int p2 = 0; p2 < scores && by_class; p2++) {
+            const int leader = max(p1, p2);
+            const size_t first = (p1 == p2) ? member(leader, leader) : member(leader, 0);
+            for (int spin = 0; spin <= segments && by_class; spin++) {
+                by_class = values[third_spin + member(p1, p2) * scores + spin] == values[third_spin + first * scores + spin];
+                for (int k = 0; k < 3 && by_class; k++) {
+                    const int stored = (p2 > p1 && k < 2) ? 1 - k : k;
+                    by_class = values[third_win + (member(p1, p2) * scores + spin) * 3 + k]
+                               == values[third_win + (first * scores + spin) * 3 + stored];
+                }
+            }
+        }
+    }
+    if (by_class) { // keep the class members only
+        CompactTables classes = compact;
+        classes.third_player_classes = true;
+        size_t class_total = 0;
+        for (int section = 0; section < 6; section++) {
+            classes.offsets[section] = class_total;
+            class_total += classes.section_entries(section);
+        }
+        vector<Num> class_values(class_total, Traits::ratio(0, 1));
+        for (int section = 0; section < 6; section++) {
+            if (section % 3 != 2) {
+                copy_n(values.begin() + compact.offsets[section], compact.section_entries(section),
+                       class_values.begin() + classes.offsets[section]);
+                continue;
+            }
+            const size_t width = (section < 3 ? 3 : 1) * (size_t)scores; // one state's entries
+            for (int leader = 0; leader < scores; leader++)
+                for (int tied = 0; tied <= 1; tied++) {
+                    if (!tied && leader == 0)
+                        continue; // no such class
+                    const size_t first = tied ? member(leader, leader) : member(leader, 0);
+                    copy_n(values.begin() + compact.offsets[section] + first * width, width,
+                           class_values.begin() + classes.offsets[section] + ((size_t)leader * 2 + tied) * width);
+                }
+        }
+        compact = std::move(classes);
+        values = std::move(class_values);
+        total = class_total;
+    }
+
+    // Encode
+    switch (storage) {
+    case TableStorage::float64:
+        compact.doubles.resize(total);
+        for (size_t i = 0; i < total; i++)
+            compact.doubles[i] = Traits::to_double(values[i]);
+        break;
+    case TableStorage::float32:
+        compact.floats.resize(total);
+        for (size_t i = 0; i < total; i++)
+            compact.floats[i] = (float)Traits::to_double(values[i]);
+        break;
+    case TableStorage::float16:
+        compact.halves.resize(total);
+        for (size_t i = 0; i < total; i++)
+            compact.halves[i] = float_to_half((float)Traits::to_double(values[i]));
+        break;
+    case TableStorage::rational32:
+        if constexpr (Traits::kind == NumericKind::exact) {
+            compact.numerators.resize(total);
+            for (int section = 0; section < 6; section++) {
+                const size_t begin = compact.offsets[section], end = begin + compact.section_entries(section);
+                uint64_t denominator = 1; // least common multiple of the section's denominators
+                for (size_t i = begin; i < end; i++) {
+                    uint64_t d = (uint64_t)values[i].getDenominator();
+                    denominator = denominator / gcd(denominator, d) * d;
+                    if (denominator > UINT32_MAX)
+                        throw overflow_error("rational32 storage: the denominators of the " + to_string(segments) +
+                                             " segment tables don't fit 32 bits (use float32)");
+                }
+                for (size_t i = begin; i < end; i++) {
+                    if (values[i].getNumerator() < 0)
+                        throw overflow_error("rational32 storage: negative table value");
+                    compact.numerators[i] =
+                        (uint32_t)(values[i].getNumerator() * (long long)(denominator / values[i].getDenominator()));
+                }
+                compact.denominators[section] = denominator;
+            }
+        }
+        break;
+    }
+    return compact;
+}
+
+vector<CompactTables::Section> CompactTables::sections() const {
+    static const char* names[6] = {"first_player_win", "second_player_win", "third_player_win",
+                                   "first_player_spin", "second_player_spin", "third_player_spin"};
+    const size_t value_bytes = (storage_kind == TableStorage::float64) ? 8
+                               : (storage_kind == TableStorage::float16) ? 2 : 4;
+    vector<Section> result;
+    for (int section = 0; section < 6; section++) {
+        size_t entries = section_entries(section);
+        result.push_back({names[section], entries, entries * value_bytes,
+                          storage_kind == TableStorage::rational32 ? denominators[section] : 0});
+    }
+    return result;
+}
+
+size_t CompactTables::bytes() const {
+    size_t total = 0;
+    for (const Section& section : sections())
+        total += section.bytes;
+    return total;
+}
+
+
+// -- Instantiations --
+template CompactTables CompactTables::build<Fraction>(const GameRules&, const DpTables<Fraction>&,
+                                                      const PolicySet<Fraction>&, TableStorage);
+template CompactTables CompactTables::build<double>(const GameRules&, const DpTables<double>&,
+                                                    const PolicySet<double>&, TableStorage);
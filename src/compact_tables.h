@@ -0,0 +1,99 @@
+#ifndef COMPACT_TABLES_H
+#define COMPACT_TABLES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dp_solver.h"
+
+
+// --- Compact tables ---
+// Once the policy set is fixed, lookups only need each decision state's win probabilities (the spin-again and
+// stay options weighted by the policy) and the policy's spin probability, so the spin-again dimension and the
+// separate policy tables fold away. Per player the compact tables hold
+//   win probabilities:  [p1 total][p2 total][spin 0..S][winner]   (spin 0: before the first spin)
+//   spin probabilities: [p1 total][p2 total][spin 0..S]           (0 for spin 0 and S)
+// where the first player has no totals before them and the second player only p1. When the policy set treats the
+// third player's states alike within each (leading total, tied) class -- detected while building; the built-in
+// policies do -- their sections hold one entry per class instead of per (p1, p2), as in dp_tables.h. Stored as:
+//   float64:    doubles (only the folding)
+//   float32:    floats
+//   float16:    IEEE half precision (about 3 significant digits)
+//   rational32: exact, 32-bit numerators over one shared denominator per section (exact tables only; throws
+//               std::overflow_error when the denominators' least common multiple doesn't fit 32 bits)
+enum class TableStorage { float64, float32, float16, rational32 };
+
+// "float64", "float32", "float16" or "rational32" (throws std::invalid_argument otherwise)
+TableStorage parse_table_storage(const std::string& name);
+const char* table_storage_name(TableStorage storage);
+
+// IEEE 754 binary16 conversions (round to nearest even)
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+
+class CompactTables {
+public:
+    CompactTables() = default;
+
+    template <class Num>
+    static CompactTables build(const GameRules& rules, const DpTables<Num>& tables, const PolicySet<Num>& policies,
+                               TableStorage storage);
+
+    int segments() const { return num_segments; }
+    TableStorage storage() const { return storage_kind; }
+    bool third_player_by_class() const { return third_player_classes; }
+
+    // player 1-3, totals 0..S, spin 0..S, winner 0-2 (same meaning as policy_state_probability)
+    double win_probability(int player, int p1, int p2, int spin, int winner) const {
+        if (player == 3 && third_player_classes && p2 > p1 && winner < 2) // classes are stored with player 1 leading
+            winner = 1 - winner;
+        return value(win_section(player), (state_index(player, p1, p2) * scores() + spin) * 3 + winner);
+    }
+    double spin_probability(int player, int p1, int p2, int spin) const {
+        return value(spin_section(player), state_index(player, p1, p2) * scores() + spin);
+    }
+
+    // Memory use, one entry per section
+    struct Section {
+        std::string name;
+        size_t entries = 0;
+        size_t bytes = 0;
+        uint64_t denominator = 0; // rational32 only
+    };
+    std::vector<Section> sections() const;
+    size_t bytes() const;
+
+private:
+    static int win_section(int player) { return player - 1; }
+    static int spin_section(int player) { return 2 + player; }
+    int scores() const { return num_segments + 1; }
+    size_t state_index(int player, int p1, int p2) const {
+        if (player == 3 && third_player_classes)
+            return (size_t)(p1 > p2 ? p1 : p2) * 2 + (p1 == p2);
+        return (player == 1) ? 0 : (player == 2) ? (size_t)p1 : (size_t)p1 * scores() + p2;
+    }
+    size_t section_entries(int section) const;
+    double value(int section, size_t index) const {
+        index += offsets[section];
+        switch (storage_kind) {
+        case TableStorage::float64: return doubles[index];
+        case TableStorage::float32: return floats[index];
+        case TableStorage::float16: return half_to_float(halves[index]);
+        case TableStorage::rational32: return (double)numerators[index] / (double)denominators[section];
+        }
+        return 0;
+    }
+
+    int num_segments = 0;
+    TableStorage storage_kind = TableStorage::float64;
+    bool third_player_classes = false;
+    size_t offsets[6] = {};     // sections: win probabilities of players 1-3, then spin probabilities of players 1-3
+    uint64_t denominators[6] = {};
+    std::vector<double> doubles; // only the vector of the storage kind is used
+    std::vector<float> floats;
+    std::vector<uint16_t> halves;
+    std::vector<uint32_t> numerators;
+};
+
+#endif // COMPACT_TABLES_H
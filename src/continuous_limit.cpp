@@ -0,0 +1,173 @@
+#include "continuous_limit.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "dp_solver.h"
+#include "instrumentation.h"
+#include "thread_pool.h"
+using namespace std;
+
+namespace {
+
+// -- Quadrature --
+// 5-point Gauss-Legendre on each piece between the breakpoints: exact for the polynomials (degree <= 9) here
+template <class F>
+double integrate(F f, double from, double to, vector<double> breakpoints = {}) {
+    static const double nodes[5] = {-0.9061798459386640, -0.5384693101056831, 0, 0.5384693101056831,
+                                    0.9061798459386640};
+    static const double weights[5] = {0.2369268850561891, 0.4786286704993665, 0.5688888888888889,
+                                      0.4786286704993665, 0.2369268850561891};
+    breakpoints.erase(remove_if(breakpoints.begin(), breakpoints.end(),
+                                [&](double x) { return x <= from || x >= to; }),
+                      breakpoints.end());
+    breakpoints.push_back(from);
+    breakpoints.push_back(to);
+    sort(breakpoints.begin(), breakpoints.end());
+    double sum = 0;
+    for (size_t i = 0; i + 1 < breakpoints.size(); i++) {
+        const double half = (breakpoints[i + 1] - breakpoints[i]) / 2, mid = (breakpoints[i + 1] + breakpoints[i]) / 2;
+        for (int k = 0; k < 5; k++)
+            sum += half * weights[k] * f(mid + half * nodes[k]);
+    }
+    return sum;
+}
+
+// The root of an increasing function on [0, 1]
+template <class F>
+double bisect(F f) {
+    double low = 0, high = 1;
+    for (int i = 0; i < 100; i++)
+        (f((low + high) / 2) < 0 ? low : high) = (low + high) / 2;
+    return (low + high) / 2;
+}
+
+// -- Continuous game --
+// Player 3 ends at or below the leading total z with probability z^2: a first spin below z (probability z), then
+// spinning again lands at most z or busts with probability z. Above z they stay and win.
+double third_loses(double z) {
+    return z * z;
+}
+
+// Player 1 wins standing at a if player 2 and then player 3 end below a. Player 2 does so from a first spin below
+// a with probability a (landing short or busting), and from one between a and their threshold only by busting.
+double first_wins_standing(double a, double second_threshold) {
+    const double s = max(a, second_threshold);
+    return third_loses(a) * (a * a + (s * s - a * a) / 2);
+}
+
+// Player 2 wins facing player 1's total a
+double second_wins(double a, double second_threshold) {
+    const double s = max(a, second_threshold);
+    const double below = a * (1 - pow(a, 3)) / 3;                // first spin below a: spin again, win above a
+    const double short_of = ((s - a) - (pow(s, 4) - pow(a, 4)) / 4) / 3; // between a and s: spin again
+    const double stay = (1 - pow(s, 3)) / 3;                       // from s: stay
+    return below + short_of + stay;
+}
+
+// -- Wheels --
+// Where advantage(total) (spinning again minus staying) turns from positive to not, interpolated; the top total
+// can't spin again
+template <class Advantage>
+double crossing(int segments, Advantage advantage) {
+    for (int total = segments - 1; total >= 1; total--) {
+        const double here = advantage(total);
+        if (here <= 0)
+            continue;
+        if (total + 1 == segments)
+            return segments;
+        const double next = advantage(total + 1);
+        return total + here / (here - next);
+    }
+    return 0;
+}
+
+WheelResolution solve_resolution(GameRules rules, int segments) {
+    rules.segments = segments;
+    const DpTables<double> tables = initialize_dp_tables(rules, OptimalPolicies<double>{});
+    WheelResolution resolution;
+    resolution.segments = segments;
+    for (int player = 0; player < 3; player++)
+        resolution.win_probability[player] = tables.first_player_policy_probability(player);
+    resolution.threshold[0] = crossing(segments, [&](int total) {
+        return tables.first_player_probability(total, 1, 0) - tables.first_player_probability(total, 0, 0);
+    }) / segments;
+    resolution.threshold[1] = crossing(segments, [&](int total) {
+        return tables.second_player_probability(0, total, 1, 1) - tables.second_player_probability(0, total, 0, 1);
+    }) / segments;
+    return resolution;
+}
+
+} // namespace
+
+
+// -- Continuous game --
+ContinuousThresholds continuous_optimal_thresholds() {
+    ContinuousThresholds thresholds;
+    // Player 2 ahead at y: staying wins with probability y^2, spinning again with the integral of z^2 over (y, 1]
+    thresholds.second = bisect([](double y) { return 3 * y * y + y * y * y - 1; });
+    const double s = thresholds.second;
+    auto stay = [s](double a) { return first_wins_standing(a, s); };
+    thresholds.first = bisect([&](double t) { return stay(t) - integrate(stay, t, 1, {s}); });
+    return thresholds;
+}
+
+array<double, 3> continuous_win_probabilities(const ContinuousThresholds& thresholds) {
+    const double t = thresholds.first, s = thresholds.second;
+    // Player 1's final total: below t they spin again (density min(z, t) over (0, 1], a bust with t^2 / 2), from t
+    // they stay (density 1 more)
+    auto density = [t](double z) { return min(z, t) + (z >= t ? 1 : 0); };
+    const double bust = t * t / 2;
+    array<double, 3> win;
+    win[0] = integrate([&](double a) { return density(a) * first_wins_standing(a, s); }, 0, 1, {t, s});
+    win[1] = bust * second_wins(0, s)
+             + integrate([&](double a) { return density(a) * second_wins(a, s); }, 0, 1, {t, s});
+    win[2] = 1 - win[0] - win[1]; // no ties in the continuous game, and player 3 wins when both others bust
+    return win;
+}
+
+
+// -- Multi-resolution solves --
+ContinuousLimit solve_continuous_limit(const GameRules& rules, int first_segments, int levels) {
+    PIR_SCOPED_TIMER("solve_continuous_limit");
+    if (!rules.uniform_wheel())
+        throw invalid_argument("The continuous limit refines the uniform wheel");
+    if (levels < 3)
+        throw invalid_argument("The continuous limit needs at least 3 wheel sizes");
+    if (levels > 16 || first_segments < 2 || ((long long)first_segments << (levels - 1)) > 65536)
+        throw invalid_argument("The continuous limit's wheels must have 2 to 65536 segments");
+
+    ContinuousLimit limit;
+    limit.resolutions.resize(levels);
+    TaskGroup solves;
+    for (int level = 0; level < levels; level++)
+        solves.run([&, level]() { limit.resolutions[level] = solve_resolution(rules, first_segments << level); });
+    solves.wait();
+
+    limit.has_continuous = rules.spins_per_turn == 2;
+    array<double, 5> continuous{};
+    if (limit.has_continuous) {
+        limit.continuous_thresholds = continuous_optimal_thresholds();
+        const array<double, 3> win = continuous_win_probabilities(limit.continuous_thresholds);
+        continuous = {win[0], win[1], win[2], limit.continuous_thresholds.first, limit.continuous_thresholds.second};
+    }
+
+    const char* quantities[5] = {"player1_win", "player2_win", "player3_win", "player1_threshold",
+                                 "player2_threshold"};
+    for (int q = 0; q < 5; q++) {
+        LimitEstimate estimate;
+        estimate.quantity = quantities[q];
+        for (const WheelResolution& resolution : limit.resolutions)
+            estimate.values.push_back(q < 3 ? resolution.win_probability[q] : resolution.threshold[q - 3]);
+        // W doubles each level: with q(W) = q + c / W + d / W^2 + ..., 2 q(2W) - q(W) drops c, and the same
+        // over those drops d (with a factor 4)
+        const vector<double>& v = estimate.values;
+        const double a = v[levels - 3], b = v[levels - 2], c = v[levels - 1];
+        const double first_coarse = 2 * b - a;
+        estimate.richardson1 = 2 * c - b;
+        estimate.richardson2 = (4 * estimate.richardson1 - first_coarse) / 3;
+        estimate.observed_order = log2(fabs(a - b) / fabs(b - c));
+        estimate.continuous = continuous[q];
+        limit.estimates.push_back(estimate);
+    }
+    return limit;
+}
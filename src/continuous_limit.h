@@ -0,0 +1,62 @@
+#ifndef CONTINUOUS_LIMIT_H
+#define CONTINUOUS_LIMIT_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include "game_rules.h"
+
+
+// --- Continuous-wheel limit ---
+// The W segment wheel is a discretization of the classic game where each spin is uniform on (0, 1] and a total
+// above 1 busts (the Tenorio paper in the readme). Solving the wheel at W, 2W, 4W, ... (floating tables, optimal
+// play) gives a sequence that converges like 1/W: ties have probability O(1/W) and the totals are rounded to 1/W.
+// Richardson extrapolation removes the 1/W and 1/W^2 terms.
+//
+// The continuous game with two spins per turn is also solved directly. Player 3 spins again exactly when behind.
+// Player 2 stays from max(player 1's total, s2), and player 1 stays from t1. With t1 and s2 fixed, each player's
+// win probability is an integral of piecewise polynomials, which Gauss-Legendre quadrature split at t1 and s2
+// computes exactly. The optimal thresholds are the totals where staying and spinning again are worth the same:
+// 3 s2^2 + s2^3 = 1 (staying at y wins with probability y^2, spinning with (1 - y^3) / 3) and the root of player 1's
+// indifference equation.
+
+// -- Continuous game (two spins per turn) --
+struct ContinuousThresholds {
+    double first = 0;  // player 1 stays from this total
+    double second = 0; // player 2 stays from this total when ahead of player 1 (and spins when behind)
+};
+
+ContinuousThresholds continuous_optimal_thresholds();
+std::array<double, 3> continuous_win_probabilities(const ContinuousThresholds& thresholds);
+
+// -- Multi-resolution solves --
+// A threshold of a wheel is where the player's first-spin advantage of spinning again changes sign, interpolated
+// linearly between the two totals around it and divided by W. For player 2 it is taken with player 1 bust.
+struct WheelResolution {
+    int segments = 0;
+    std::array<double, 3> win_probability{};
+    std::array<double, 2> threshold{}; // players 1 and 2
+};
+
+// One quantity (a win probability or a threshold) across the resolutions
+struct LimitEstimate {
+    std::string quantity;
+    std::vector<double> values;  // per resolution
+    double richardson1 = 0;      // from the two finest resolutions, removing the 1/W term
+    double richardson2 = 0;      // from the three finest, removing 1/W and 1/W^2
+    double observed_order = 0;   // log2 of the ratio of the last two differences (1: converges like 1/W)
+    double continuous = 0;       // the direct solve's value (if there is one)
+};
+
+struct ContinuousLimit {
+    std::vector<WheelResolution> resolutions; // W = first_segments * 2^i
+    std::vector<LimitEstimate> estimates;     // player 1..3 win probability, player 1..2 threshold
+    bool has_continuous = false;              // the direct solve covers these rules (two spins per turn)
+    ContinuousThresholds continuous_thresholds;
+};
+
+// Solve levels (at least 3) doubling wheels from first_segments, with the spins per turn of rules (the wheel
+// must be uniform). The solves run in parallel on the shared thread pool.
+ContinuousLimit solve_continuous_limit(const GameRules& rules, int first_segments, int levels);
+
+#endif // CONTINUOUS_LIMIT_H
@@ -0,0 +1,622 @@
+#include "dp_solver.h"
+#include "dual.h"
+#include "modular.h"
+#include "policies.h"
+#include "policy_language.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+namespace {
+template <class Num>
+Num number(long long num, long long denom) { return NumericTraits<Num>::ratio(num, denom); }
+template <class Num>
+bool is_one(const Num& value) { return NumericTraits<Num>::is_one(value); }
+
+template <class Choice>
+Choice fixed_choice(bool spin) {
+    if constexpr (is_same_v<Choice, bool>)
+        return spin;
+    else
+        return number<Choice>(spin ? 1 : 0, 1);
+}
+
+// The win probability after a choice: policy * if_spin + (1 - policy) * if_stay, a select for a bool
+template <class Num>
+Num mix(bool spin, const Num& if_spin, const Num& if_stay) { return spin ? if_spin : if_stay; }
+template <class Num>
+Num mix(const Num& policy, const Num& if_spin, const Num& if_stay) {
+    return policy * if_spin + (number<Num>(1, 1) - policy) * if_stay;
+}
+
+// A uniform wheel's spins are counted rather than summed over their values. Weighted wheels
+// (GameRules::segment_probabilities) and Dual numbers (dual.h, every segment its own derivative) need the sums.
+template <class Num>
+bool counted_wheel(const GameRules& rules) {
+    return NumericTraits<Num>::kind != NumericKind::dual && rules.uniform_wheel();
+}
+
+// Probability of spinning value (1..segments), and of spinning a value in first..last
+template <class Num>
+Num segment_probability(const GameRules& rules, int value) {
+    if constexpr (NumericTraits<Num>::kind == NumericKind::dual)
+        return NumericTraits<Num>::segment_variable(value, rules.segment_probability(value));
+    else if constexpr (NumericTraits<Num>::kind == NumericKind::floating)
+        return rules.segment_probability(value);
+    else
+        return number<Num>(1, rules.segments); // (uniform only, see solve_dp_tables)
+}
+template <class Num>
+Num segment_range_probability(const GameRules& rules, int first, int last) {
+    if (counted_wheel<Num>(rules))
+        return number<Num>(max(last - first + 1, 0), rules.segments);
+    Num probability = number<Num>(0, 1);
+    for (int value = max(first, 1); value <= last; value++)
+        probability += segment_probability<Num>(rules, value);
+    return probability;
+}
+
+// Running sums of a next-stage policy table over the total: prefix[t * 3 + player] = sum of value(u, player) for
+// totals u = 1..t, so a spin again is one range sum plus the bust term instead of a loop over the second spin
+// (unless the wheel is counted: the values themselves, spin_again_probability weighs them)
+template <class Num, class Value>
+void fill_prefix_sums(vector<Num>& prefix, const GameRules& rules, Value value) {
+    const int segments = rules.segments;
+    const bool counted = counted_wheel<Num>(rules);
+    prefix.assign((size_t)(segments + 1) * 3, number<Num>(0, 1));
+    for (int total = 1; total <= segments; total++)
+        for (int player = 0; player < 3; player++)
+            prefix[total * 3 + player] = counted ? prefix[(total - 1) * 3 + player] + value(total, player)
+                                                 : value(total, player);
+}
+
+// Win probability after spinning again from spin1: the second spin makes the totals spin1+1..segments (one value
+// each) or busts to 0 (the other spin1 values)
+template <class Num>
+Num spin_again_probability(const vector<Num>& prefix, const GameRules& rules, int spin1, const Num& bust, int player) {
+    const int segments = rules.segments;
+    if (counted_wheel<Num>(rules))
+        return (prefix[segments * 3 + player] - prefix[spin1 * 3 + player] + number<Num>(spin1, 1) * bust)
+               * number<Num>(1, segments);
+    Num probability = bust * segment_range_probability<Num>(rules, segments - spin1 + 1, segments);
+    for (int value = 1; spin1 + value <= segments; value++)
+        probability += segment_probability<Num>(rules, value) * prefix[(spin1 + value) * 3 + player];
+    return probability;
+}
+
+// 3rd player's outcome when they stay on total (0 = bust) against players 1 and 2's totals
+template <class Num>
+array<Num, 3> third_player_stay(int p1, int p2, int total) {
+    array<Num, 3> win = {number<Num>(0, 1), number<Num>(0, 1), number<Num>(0, 1)};
+    int max_score = max(p1, p2);
+    if (total > max_score) {
+        win[2] = number<Num>(1, 1); // wins outright (everything else 0)
+    } else if (total < max_score) { // p3 looses
+        if (p1 == p2) // 2-way tie
+            win[0] = win[1] = number<Num>(1, 2);
+        else // no tie
+            win[p1 > p2 ? 0 : 1] = number<Num>(1, 1);
+    } else { // tie with winning player
+        if (p1 == p2) { // three-way tie
+            win[0] = win[1] = win[2] = number<Num>(1, 3);
+        } else { // two-way tie
+            win[p1 > p2 ? 0 : 1] = number<Num>(1, 2);
+            win[2] = number<Num>(1, 2);
+        }
+    }
+    return win;
+}
+
+// With more than two spins per turn: options 1..K-2 (spin again after that many spins, another choice follows),
+// last one first. The next spin makes the totals total+1..segments, each worth the policy's mix of staying and
+// spinning again (the next option), or busts to the stay outcome of total 0.
+//   option(total, option, player): the table entry, policy(total, spins): the spin-again choice (PolicyChoice),
+//   bust(player): the stay outcome of total 0
+template <class Num, class Choice, class Option, class Policy, class Bust>
+void solve_later_options(const GameRules& rules, int options, Option option, Policy policy, Bust bust) {
+    const int segments = rules.segments;
+    vector<Choice> spin_policy(segments + 1);
+    vector<Num> prefix;
+    for (int again = options - 2; again >= 1; again--) {
+        for (int total = 1; total < segments; total++) // no spin again on the top score
+            spin_policy[total] = policy(total, again + 1);
+        spin_policy[segments] = fixed_choice<Choice>(false);
+        fill_prefix_sums(prefix, rules, [&](int total, int player) {
+            return mix<Num>(spin_policy[total], option(total, again + 1, player), option(total, 0, player));
+        });
+        for (int total = 0; total <= segments; total++)
+            for (int player = 0; player < 3; player++)
+                option(total, again, player) = (total == 0 || total == segments) // skipped first spin or top score
+                    ? number<Num>(-1, 1) : spin_again_probability(prefix, rules, total, bust(player), player);
+    }
+}
+
+// body(0) .. body(count - 1) as tasks on the shared thread pool. A stage is split into slices (a third player class,
+// a p1) that write disjoint parts of the tables and only read earlier stages and their own slice. A modular solve
+// stays on its thread: its residues belong to that thread's ModularField.
+template <class Num, class Body>
+void for_each_slice(int count, Body body) {
+    if constexpr (NumericTraits<Num>::kind == NumericKind::modular) {
+        for (int i = 0; i < count; i++)
+            body(i);
+    } else {
+        ThreadPool::shared().parallel_for(0, count, body);
+    }
+}
+
+// Whether the class tables hold the 3rd player's options for every (p1, p2). With two spins per turn the options
+// don't use the policy; with more, each member's choices after the later spins must match those of its class's
+// first member, (leader, leader) when tied and (leader, 0) otherwise -- the members the compact tables compare
+// (compact_tables.cpp). The choices after K - 1 spins only see policy-free options, so asked on the class tables
+// they are the members' own, and so are those after fewer spins as long as the later ones agree.
+template <class Num, class Policies>
+bool third_player_policy_by_class(const DpTables<Num>& tables, const GameRules& rules, const Policies& policies) {
+    const int segments = rules.segments;
+    for (int spins = tables.options() - 1; spins >= 2; spins--)
+        for (int p1 = 0; p1 <= segments; p1++)
+            for (int p2 = 0; p2 <= segments; p2++) {
+                const int leader = max(p1, p2), first_p2 = (p1 == p2) ? leader : 0;
+                if (p1 == leader && p2 == first_p2)
+                    continue;
+                for (int spin = 1; spin < segments; spin++) // no spin again on the top score
+                    if (!(policies.third_player(tables, p1, p2, spin, spins)
+                          == policies.third_player(tables, leader, first_p2, spin, spins)))
+                        return false;
+            }
+    return true;
+}
+} // namespace
+
+
+// ---- Policies -----
+// Optimal 3rd player policy (for winning game): Spin again if less than max score
+template <class Num>
+Num third_player_optimal_policy(const DpTables<Num>& tables, int player1_score, int player2_score, int spin1, int spins) {
+    Num win_prob_if_spin = tables.third_player_probability(player1_score, player2_score, spin1, spins, 2);
+    Num win_prob_if_no_spin = tables.third_player_probability(player1_score, player2_score, spin1, 0, 2);
+    return (win_prob_if_spin > win_prob_if_no_spin) ? number<Num>(1, 1) : number<Num>(0, 1);
+}
+
+// Optimal 2nd player policy (for winning game) -- ASSUMING 3RD PLAYER ACTS ACCORDING TO THEIR POLICY
+template <class Num>
+Num second_player_optimal_policy(const DpTables<Num>& tables, int player1_score, int spin1, int spins) {
+    Num win_prob_if_spin = tables.second_player_probability(player1_score, spin1, spins, 1);
+    Num win_prob_if_no_spin = tables.second_player_probability(player1_score, spin1, 0, 1);
+    return (win_prob_if_spin > win_prob_if_no_spin) ? number<Num>(1, 1) : number<Num>(0, 1);
+}
+
+// Optimal 1st player policy (for winning game) -- ASSUMING 2ND & 3RD PLAYER ACTS ACCORDING TO THEIR POLICY
+template <class Num>
+Num first_player_optimal_policy(const DpTables<Num>& tables, int spin1, int spins) {
+    Num win_prob_if_spin = tables.first_player_probability(spin1, spins, 0);
+    Num win_prob_if_no_spin = tables.first_player_probability(spin1, 0, 0);
+    return (win_prob_if_spin > win_prob_if_no_spin) ? number<Num>(1, 1) : number<Num>(0, 1);
+}
+
+
+// -- Initialize DP tables --
+// Stage 1: win probabilities for each of the 3rd player's options
+template <class Num, class Policies>
+void solve_third_player_options(DpTables<Num>& tables, const GameRules& rules, const Policies& policies)
+{
+    PIR_SCOPED_TIMER("solve_third_player_options");
+    const int segments = rules.segments;
+    const int last = tables.options() - 1; // spin again for the last time
+    // The options against totals p1 / p2 (p2 = -1: a total below every score), entry(spin, option, player) being the
+    // table entry and policy_p2 the total the policy is asked with
+    auto solve_state = [&](int p1, int p2, int policy_p2, auto entry) {
+        for (int spin1 = 0; spin1 <= segments; spin1++) // player 3 spin (NOTE: 0 means they choose not to spin)
+            for (int spinAgain = 0; spinAgain <= 1; spinAgain++) // spin again (for the last time) [1] or not [0]
+            {
+                const int option = spinAgain ? last : 0;
+                PIR_COUNT(third_options_states);
+                // Skip invalid states 
+                if (spin1 == 0 || (spin1 == segments && spinAgain)) // skiped first spin or spin again on top score
+                {
+                    entry(spin1, option, 0) = number<Num>(-1, 1);
+                    entry(spin1, option, 1) = number<Num>(-1, 1);
+                    entry(spin1, option, 2) = number<Num>(-1, 1);
+                    continue;
+                }
+                
+                // Initialize the win probabilities & other variables
+                Num player1_win = number<Num>(0, 1);
+                Num player2_win = number<Num>(0, 1);
+                Num player3_win = number<Num>(0, 1);
+                int max_score = max(p1, p2);
+                
+                // Calculate win probabilities
+                if (spinAgain == 0) { // Don't spin again
+                    array<Num, 3> win = third_player_stay<Num>(p1, p2, spin1);
+                    player1_win = win[0];
+                    player2_win = win[1];
+                    player3_win = win[2];
+                } else { // Spin again
+                    // The second spin's outcomes are the totals spin1+1..segments once each, and a bust (total 0)
+                    // for the other spin1 values -- so count how many beat, tie and lose to max_score
+                    // instead of going through them
+                    // NOTE: if you bust but everyone else busts, there is a spinoff of one spin
+                    if (counted_wheel<Num>(rules)) {
+                        int above = segments - max(spin1, max_score);
+                        int equal = (max_score > spin1 ? 1 : 0) + (max_score == 0 ? spin1 : 0);
+                        int below = segments - above - equal;
+                        if (p1 == p2) { // 2-way tie when p3 looses, three-way tie when they tie
+                            player1_win = player2_win = number<Num>(below, 2 * segments) + number<Num>(equal, 3 * segments);
+                            player3_win = number<Num>(above, segments) + number<Num>(equal, 3 * segments);
+                        } else { // no tie when p3 looses, two-way tie when they tie
+                            (p1 > p2 ? player1_win : player2_win) = number<Num>(below, segments) + number<Num>(equal, 2 * segments);
+                            player3_win = number<Num>(above, segments) + number<Num>(equal, 2 * segments);
+                        }
+                    } else { // the same with the probabilities of the values that beat, tie and lose
+                        const Num zero = number<Num>(0, 1);
+                        Num bust = segment_range_probability<Num>(rules, segments - spin1 + 1, segments);
+                        Num above = segment_range_probability<Num>(rules, max(spin1, max_score) - spin1 + 1, segments - spin1);
+                        Num equal = (max_score > spin1 ? segment_probability<Num>(rules, max_score - spin1) : zero)
+                                    + (max_score == 0 ? bust : zero);
+                        Num below = segment_range_probability<Num>(rules, 1, max_score - spin1 - 1)
+                                    + (max_score > 0 ? bust : zero);
+                        const Num share = (p1 == p2) ? number<Num>(1, 3) : number<Num>(1, 2);
+                        if (p1 == p2)
+                            player1_win = player2_win = below * number<Num>(1, 2) + equal * share;
+                        else
+                            (p1 > p2 ? player1_win : player2_win) = below + equal * share;
+                        player3_win = above + equal * share;
+                    }
+                }
+                assert(is_one<Num>(player1_win + player2_win + player3_win)); // Ensure probabilities sum to 1
+
+                // Store the calculated probability
+                entry(spin1, option, 0) = player1_win;
+                entry(spin1, option, 1) = player2_win;
+                entry(spin1, option, 2) = player3_win;
+            }
+
+        // Spinning again with more spins to come
+        const array<Num, 3> bust = third_player_stay<Num>(p1, p2, 0);
+        solve_later_options<Num, PolicyChoice<Num, Policies>>(
+            rules, tables.options(), entry,
+            [&](int spin, int spins) -> PolicyChoice<Num, Policies> {
+                return policies.third_player(tables, p1, policy_p2, spin, spins);
+            },
+            [&](int player) { return bust[player]; });
+    };
+
+    if (tables.third_player_by_class()) {
+        // One class per leading total and tie (see dp_tables.h), solved as if player 1 leads: p2 is the leading
+        // total when they tie and a total below every score otherwise (the policy is asked with 0, as the compact
+        // tables' class members are)
+        for_each_slice<Num>(2 * (segments + 1), [&](int slice) {
+            const int leader = slice / 2; // leading total of players 1 and 2
+            const int tied = slice % 2;   // players 1 and 2 tied [1] or player 1 ahead [0]
+            if (!tied && leader == 0) // nobody is behind a bust
+                return;
+            solve_state(leader, tied ? leader : -1, tied ? leader : 0, [&](int spin, int option, int player) -> Num& {
+                return tables.third_player_class_probability(leader, tied, spin, option, player);
+            });
+        });
+        if (third_player_policy_by_class(tables, rules, policies))
+            return;
+        // The policy tells class members apart: solve every (p1, p2) into tables of the full layout
+        tables = DpTables<Num>::allocate(tables.scores(), tables.options(), false);
+    }
+    for_each_slice<Num>(segments + 1, [&](int p1) {
+        for (int p2 = 0; p2 <= segments; p2++)
+            solve_state(p1, p2, p2, [&](int spin, int option, int player) -> Num& {
+                return tables.third_player_probability(p1, p2, spin, option, player);
+            });
+    });
+}
+
+// Stage 2: 3rd player's win probabilities under their policy
+template <class Num, class Policies>
+void solve_third_player_policy(DpTables<Num>& tables, const GameRules& rules, const Policies& policies)
+{
+    PIR_SCOPED_TIMER("solve_third_player_policy");
+    const int segments = rules.segments;
+    for_each_slice<Num>(segments + 1, [&](int p1) { // player 1 total score
+        for (int p2 = 0; p2 <= segments; p2++) // player 2 total score
+        {
+            PIR_COUNT(third_policy_states);
+            // Set all values to zero (for non first spin part)
+            Num player1_win = number<Num>(0, 1);
+            Num player2_win = number<Num>(0, 1);
+            Num player3_win = number<Num>(0, 1);
+
+            // Run all spins (must do a first spin, spin!=0) for player 3
+            for (int spin = 1; spin <= segments; spin++)
+            {
+                const Num spin_probability = segment_probability<Num>(rules, spin);
+                PolicyChoice<Num, Policies> policy = policies.third_player(tables, p1, p2, spin, 1); // probability of spinning again
+                if (tables.third_player_probability(p1, p2, spin, 1, 0) == number<Num>(-1, 1)) // invalid state check
+                    policy = fixed_choice<PolicyChoice<Num, Policies>>(false); // can't spin again if invalid state
+                if (tables.third_player_probability(p1, p2, spin, 0, 0) == number<Num>(-1, 1)) // invalid state check
+                    policy = fixed_choice<PolicyChoice<Num, Policies>>(true); // must spin again if invalid state
+                player1_win += spin_probability * mix<Num>(policy, tables.third_player_probability(p1, p2, spin, 1, 0),
+                                                           tables.third_player_probability(p1, p2, spin, 0, 0));
+                player2_win += spin_probability * mix<Num>(policy, tables.third_player_probability(p1, p2, spin, 1, 1),
+                                                           tables.third_player_probability(p1, p2, spin, 0, 1));
+                player3_win += spin_probability * mix<Num>(policy, tables.third_player_probability(p1, p2, spin, 1, 2),
+                                                           tables.third_player_probability(p1, p2, spin, 0, 2));
+            }
+            assert(is_one<Num>(player1_win + player2_win + player3_win)); // Ensure probabilities sum to 1
+
+            // Set all array values
+            tables.third_player_policy_probability(p1, p2, 0) = player1_win;
+            tables.third_player_policy_probability(p1, p2, 1) = player2_win;
+            tables.third_player_policy_probability(p1, p2, 2) = player3_win;
+        }
+    });
+}
+
+// Stage 3: win probabilities for each of the 2nd player's options
+template <class Num, class Policies>
+void solve_second_player_options(DpTables<Num>& tables, const GameRules& rules, const Policies& policies)
+{
+    PIR_SCOPED_TIMER("solve_second_player_options");
+    const int segments = rules.segments;
+    const int last = tables.options() - 1; // spin again for the last time
+    for_each_slice<Num>(segments + 1, [&](int p1) {
+        vector<Num> prefix; // over player 2's total, for this p1
+        fill_prefix_sums(prefix, rules, [&](int p2, int player) { return tables.third_player_policy_probability(p1, p2, player); });
+        for (int spin1 = 0; spin1 <= segments; spin1++) // player 2 spin (NOTE: 0 means they choose not to spin)
+            for (int spinAgain = 0; spinAgain <= 1; spinAgain++) // spin again (for the last time) [1] or not [0]
+            {
+                const int option = spinAgain ? last : 0;
+                PIR_COUNT(second_options_states);
+                // Skip invalid states 
+                if (spin1 == 0 || (spin1 == segments && spinAgain)) // skiped first spin or spin again on top score
+                {
+                    tables.second_player_probability(p1, spin1, option, 0) = number<Num>(-1, 1);
+                    tables.second_player_probability(p1, spin1, option, 1) = number<Num>(-1, 1);
+                    tables.second_player_probability(p1, spin1, option, 2) = number<Num>(-1, 1);
+                    continue;
+                }
+            
+                // Calculate the win probabilities for player 2 based on the decision
+                if (spinAgain == 0) { // Don't spin again
+                    tables.second_player_probability(p1, spin1, option, 0) = tables.third_player_policy_probability(p1, spin1, 0);
+                    tables.second_player_probability(p1, spin1, option, 1) = tables.third_player_policy_probability(p1, spin1, 1);
+                    tables.second_player_probability(p1, spin1, option, 2) = tables.third_player_policy_probability(p1, spin1, 2);
+                } else { // Spin again
+                    for (int player = 0; player < 3; player++)
+                        tables.second_player_probability(p1, spin1, option, player) = spin_again_probability(
+                            prefix, rules, spin1, tables.third_player_policy_probability(p1, 0, player), player);
+
+                    assert(is_one<Num>(tables.second_player_probability(p1, spin1, option, 0)
+                            + tables.second_player_probability(p1, spin1, option, 1)
+                            + tables.second_player_probability(p1, spin1, option, 2))); // Ensure probabilities sum to 1
+                }
+            }
+        solve_later_options<Num, PolicyChoice<Num, Policies>>(
+            rules, tables.options(),
+            [&](int spin, int again, int player) -> Num& { return tables.second_player_probability(p1, spin, again, player); },
+            [&](int spin, int spins) -> PolicyChoice<Num, Policies> {
+                return policies.second_player(tables, p1, spin, spins);
+            },
+            [&](int player) { return tables.third_player_policy_probability(p1, 0, player); });
+    });
+}
+
+// Stage 4: 2nd player's win probabilities under their policy
+template <class Num, class Policies>
+void solve_second_player_policy(DpTables<Num>& tables, const GameRules& rules, const Policies& policies)
+{
+    PIR_SCOPED_TIMER("solve_second_player_policy");
+    const int segments = rules.segments;
+    for_each_slice<Num>(segments + 1, [&](int p1) { // player 1 total score
+        PIR_COUNT(second_policy_states);
+        // Set all values to zero (for non first spin part)
+        Num player1_win = number<Num>(0, 1);
+        Num player2_win = number<Num>(0, 1);
+        Num player3_win = number<Num>(0, 1);
+
+        // Run all spins (must do a first spin, spin!=0) for player 3
+        for (int spin = 1; spin <= segments; spin++)
+        {
+            const Num spin_probability = segment_probability<Num>(rules, spin);
+            PolicyChoice<Num, Policies> policy = policies.second_player(tables, p1, spin, 1); // probability of spinning again
+            if (tables.second_player_probability(p1, spin, 1, 0) == number<Num>(-1, 1)) // invalid state check
+                policy = fixed_choice<PolicyChoice<Num, Policies>>(false); // can't spin again if invalid state
+            if (tables.second_player_probability(p1, spin, 0, 0) == number<Num>(-1, 1)) // invalid state check
+                policy = fixed_choice<PolicyChoice<Num, Policies>>(true); // must spin again if invalid state
+            player1_win += spin_probability * mix<Num>(policy, tables.second_player_probability(p1, spin, 1, 0),
+                                                       tables.second_player_probability(p1, spin, 0, 0));
+            player2_win += spin_probability * mix<Num>(policy, tables.second_player_probability(p1, spin, 1, 1),
+                                                       tables.second_player_probability(p1, spin, 0, 1));
+            player3_win += spin_probability * mix<Num>(policy, tables.second_player_probability(p1, spin, 1, 2),
+                                                       tables.second_player_probability(p1, spin, 0, 2));
+        }
+        assert(is_one<Num>(player1_win + player2_win + player3_win)); // Ensure probabilities sum to 1
+
+        // Set all array values
+        tables.second_player_policy_probability(p1, 0) = player1_win;
+        tables.second_player_policy_probability(p1, 1) = player2_win;
+        tables.second_player_policy_probability(p1, 2) = player3_win;
+    });
+}
+
+// Stage 5: win probabilities for each of the 1st player's options
+template <class Num, class Policies>
+void solve_first_player_options(DpTables<Num>& tables, const GameRules& rules, const Policies& policies)
+{
+    PIR_SCOPED_TIMER("solve_first_player_options");
+    const int segments = rules.segments;
+    const int last = tables.options() - 1; // spin again for the last time
+    vector<Num> prefix; // over player 1's total
+    fill_prefix_sums(prefix, rules, [&](int p1, int player) { return tables.second_player_policy_probability(p1, player); });
+    for (int spin1 = 0; spin1 <= segments; spin1++) // player 1 spin (NOTE: 0 means they choose not to spin)
+        for (int spinAgain = 0; spinAgain <= 1; spinAgain++) // spin again (for the last time) [1] or not [0]
+        {
+            const int option = spinAgain ? last : 0;
+            PIR_COUNT(first_options_states);
+            // Skip invalid states 
+            if (spin1 == 0 || (spin1 == segments && spinAgain)) // skiped first spin or spin again on top score
+            {
+                tables.first_player_probability(spin1, option, 0) = number<Num>(-1, 1);
+                tables.first_player_probability(spin1, option, 1) = number<Num>(-1, 1);
+                tables.first_player_probability(spin1, option, 2) = number<Num>(-1, 1);
+                continue;
+            }
+            
+            // Calculate the win probabilities for player 1 based on the decision
+            if (spinAgain == 0) { // Don't spin again
+                tables.first_player_probability(spin1, option, 0) = tables.second_player_policy_probability(spin1, 0);
+                tables.first_player_probability(spin1, option, 1) = tables.second_player_policy_probability(spin1, 1);
+                tables.first_player_probability(spin1, option, 2) = tables.second_player_policy_probability(spin1, 2);
+            } else { // Spin again
+                for (int player = 0; player < 3; player++)
+                    tables.first_player_probability(spin1, option, player) = spin_again_probability(
+                        prefix, rules, spin1, tables.second_player_policy_probability(0, player), player);
+
+                assert(is_one<Num>(tables.first_player_probability(spin1, option, 0)
+                        + tables.first_player_probability(spin1, option, 1)
+                        + tables.first_player_probability(spin1, option, 2))); // Ensure probabilities sum to 1
+            }
+        }
+    solve_later_options<Num, PolicyChoice<Num, Policies>>(
+        rules, tables.options(),
+        [&](int spin, int again, int player) -> Num& { return tables.first_player_probability(spin, again, player); },
+        [&](int spin, int spins) -> PolicyChoice<Num, Policies> { return policies.first_player(tables, spin, spins); },
+        [&](int player) { return tables.second_player_policy_probability(0, player); });
+}
+
+// Stage 6: 1st player's win probabilities under their policy (expected win rates)
+template <class Num, class Policies>
+void solve_first_player_policy(DpTables<Num>& tables, const GameRules& rules, const Policies& policies)
+{
+    PIR_SCOPED_TIMER("solve_first_player_policy");
+    const int segments = rules.segments;
+    PIR_COUNT(first_policy_states);
+    // Set all values to zero (for non first spin part)
+    Num player1_win = number<Num>(0, 1);
+    Num player2_win = number<Num>(0, 1);
+    Num player3_win = number<Num>(0, 1);
+
+    // Run all spins (must do a first spin, spin!=0) for player 3
+    for (int spin = 1; spin <= segments; spin++)
+    {
+        const Num spin_probability = segment_probability<Num>(rules, spin);
+        PolicyChoice<Num, Policies> policy = policies.first_player(tables, spin, 1); // probability of spinning again
+        if (tables.first_player_probability(spin, 1, 0) == number<Num>(-1, 1)) // invalid state check
+            policy = fixed_choice<PolicyChoice<Num, Policies>>(false); // can't spin again if invalid state
+        if (tables.first_player_probability(spin, 0, 0) == number<Num>(-1, 1)) // invalid state check
+            policy = fixed_choice<PolicyChoice<Num, Policies>>(true); // must spin again if invalid state
+        player1_win += spin_probability * mix<Num>(policy, tables.first_player_probability(spin, 1, 0),
+                                                   tables.first_player_probability(spin, 0, 0));
+        player2_win += spin_probability * mix<Num>(policy, tables.first_player_probability(spin, 1, 1),
+                                                   tables.first_player_probability(spin, 0, 1));
+        player3_win += spin_probability * mix<Num>(policy, tables.first_player_probability(spin, 1, 2),
+                                                   tables.first_player_probability(spin, 0, 2));
+    }
+    assert(is_one<Num>(player1_win + player2_win + player3_win)); // Ensure probabilities sum to 1
+
+    // Set all array values
+    tables.first_player_policy_probability(0) = player1_win;
+    tables.first_player_policy_probability(1) = player2_win;
+    tables.first_player_policy_probability(2) = player3_win;
+}
+
+template <class Num, class Policies>
+void solve_dp_tables(DpTables<Num>& tables, const GameRules& rules, const Policies& policies)
+{
+    if (tables.scores() != rules.scores() || tables.options() != rules.spins_per_turn)
+        throw invalid_argument("solve_dp_tables: the tables don't have the shape of the rules");
+    if (!rules.uniform_wheel()) {
+        constexpr NumericKind kind = NumericTraits<Num>::kind;
+        if (kind == NumericKind::exact || kind == NumericKind::modular)
+            throw invalid_argument("A weighted wheel needs floating tables");
+        if ((int)rules.segment_probabilities.size() != rules.segments)
+            throw invalid_argument("The wheel needs one probability per segment");
+    }
+    if constexpr (is_same_v<Policies, PolicySet<Num>>)
+        if (policies.compiled_solve) {
+            policies.compiled_solve(tables, rules);
+            return;
+        }
+    solve_third_player_options(tables, rules, policies);
+    solve_third_player_policy(tables, rules, policies);
+    solve_second_player_options(tables, rules, policies);
+    solve_second_player_policy(tables, rules, policies);
+    solve_first_player_options(tables, rules, policies);
+    solve_first_player_policy(tables, rules, policies);
+}
+
+template <class Policies>
+DpTables<typename Policies::number_type> initialize_dp_tables(const GameRules& rules, const Policies& policies)
+{
+    using Num = typename Policies::number_type;
+    PIR_SCOPED_TIMER("initialize_dp_tables");
+    DpTables<Num> tables = DpTables<Num>::allocate(rules.scores(), rules.spins_per_turn);
+    solve_dp_tables(tables, rules, policies);
+    return tables;
+}
+
+template <class Num>
+PolicySet<Num> optimal_policies() {
+    return {"optimal", third_player_optimal_policy<Num>, second_player_optimal_policy<Num>, first_player_optimal_policy<Num>,
+            [](DpTables<Num>& tables, const GameRules& rules) { solve_dp_tables(tables, rules, OptimalPolicies<Num>{}); }};
+}
+
+
+// -- State lookups --
+template <class Num>
+Num policy_state_probability(const DpTables<Num>& tables, const GameRules& rules, const PolicySet<Num>& policies,
+                             int player, int p1, int p2, int spin, int winner)
+{
+    // Before the first spin: the policy tables
+    if (spin == 0)
+        return (player == 1) ? tables.first_player_policy_probability(winner)
+               : (player == 2) ? tables.second_player_policy_probability(p1, winner)
+               : tables.third_player_policy_probability(p1, p2, winner);
+
+    // After it: the option values weighted by the policy (no further spin on the top score)
+    auto option = [&](int again) -> const Num& {
+        return (player == 1) ? tables.first_player_probability(spin, again, winner)
+               : (player == 2) ? tables.second_player_probability(p1, spin, again, winner)
+               : tables.third_player_probability(p1, p2, spin, again, winner);
+    };
+    if (spin == rules.segments)
+        return option(0);
+    Num spin_probability = (player == 1) ? policies.first_player(tables, spin, 1)
+                           : (player == 2) ? policies.second_player(tables, p1, spin, 1)
+                           : policies.third_player(tables, p1, p2, spin, 1);
+    return spin_probability * option(1) + (number<Num>(1, 1) - spin_probability) * option(0);
+}
+
+
+// -- Instantiations --
+#define PIR_INSTANTIATE_STAGES(Num, Policies) \
+    template void solve_third_player_options<Num>(DpTables<Num>&, const GameRules&, const Policies&); \
+    template void solve_third_player_policy<Num>(DpTables<Num>&, const GameRules&, const Policies&); \
+    template void solve_second_player_options<Num>(DpTables<Num>&, const GameRules&, const Policies&); \
+    template void solve_second_player_policy<Num>(DpTables<Num>&, const GameRules&, const Policies&); \
+    template void solve_first_player_options<Num>(DpTables<Num>&, const GameRules&, const Policies&); \
+    template void solve_first_player_policy<Num>(DpTables<Num>&, const GameRules&, const Policies&); \
+    template void solve_dp_tables<Num>(DpTables<Num>&, const GameRules&, const Policies&); \
+    template DpTables<Num> initialize_dp_tables<Policies>(const GameRules&, const Policies&);
+
+#define PIR_INSTANTIATE_SOLVER(Num) \
+    template Num third_player_optimal_policy<Num>(const DpTables<Num>&, int, int, int, int); \
+    template Num second_player_optimal_policy<Num>(const DpTables<Num>&, int, int, int); \
+    template Num first_player_optimal_policy<Num>(const DpTables<Num>&, int, int); \
+    template PolicySet<Num> optimal_policies<Num>(); \
+    PIR_INSTANTIATE_STAGES(Num, PolicySet<Num>) \
+    PIR_INSTANTIATE_STAGES(Num, OptimalPolicies<Num>) \
+    PIR_INSTANTIATE_STAGES(Num, ThresholdPolicies<Num>) \
+    PIR_INSTANTIATE_STAGES(Num, TablePolicies<Num>) \
+    PIR_INSTANTIATE_STAGES(Num, DecisionTablePolicies<Num>) \
+    template Num policy_state_probability<Num>(const DpTables<Num>&, const GameRules&, const PolicySet<Num>&, int, int, \
+                                               int, int, int);
+
+PIR_INSTANTIATE_SOLVER(Fraction)
+PIR_INSTANTIATE_SOLVER(double)
+PIR_INSTANTIATE_SOLVER(Dual)
+
+// Residues (modular_solver.h): only the solve itself, the policies are fixed decisions
+template void solve_dp_tables<ModNum>(DpTables<ModNum>&, const GameRules&, const PolicySet<ModNum>&);
+template DpTables<ModNum> initialize_dp_tables<PolicySet<ModNum>>(const GameRules&, const PolicySet<ModNum>&);
@@ -0,0 +1,120 @@
+#ifndef DP_SOLVER_H
+#define DP_SOLVER_H
+
+#include <functional>
+#include <string>
+#include <type_traits>
+#include "dp_tables.h"
+#include "game_rules.h"
+#include "numeric.h"
+
+
+// ---- Policies -----
+// A policy returns the probability that the player spins again. It gets the tables of the solve in progress;
+// when it is called, every table of the later players is already filled, and so are the player's own options
+// for later spins. spin is the player's running total and spins the number of spins they have made (1 in the
+// standard game; up to spins_per_turn - 1, see game_rules.h).
+// NOTE: the 3rd player's options are solved per (leading total, tied) class (dp_tables.h). With more than two
+//      spins per turn a policy that decides differently within a class (it looks at more than the leading total
+//      and the tie) is detected, and those options are solved per (p1, p2) instead.
+// PROBLEM: We give C1 and C2 data in their policies that describe exactly what later contestants policies are
+//      something they don't have access to in a contest
+//      If you really want to simulate without this knowledge, don't use the DP values in the policy
+template <class Num>
+struct PolicySet {
+    using number_type = Num;
+    std::string name; // identifies the policies in table cache keys and output
+    std::function<Num(const DpTables<Num>& tables, int p1, int p2, int spin, int spins)> third_player;
+    std::function<Num(const DpTables<Num>& tables, int p1, int spin, int spins)> second_player;
+    std::function<Num(const DpTables<Num>& tables, int spin, int spins)> first_player;
+    // Set by the sets with a compiled counterpart (optimal_policies, threshold_policies): solve_dp_tables runs that
+    // instead of calling the functions above state by state
+    std::function<void(DpTables<Num>& tables, const GameRules& rules)> compiled_solve;
+};
+
+// -- Compiled policies --
+// The solver stages and the simulator take any type with PolicySet's three members (as functions or callables) and
+// its number_type, so
+// a policy known at compile time inlines into the loops; PolicySet is the type-erased set the command line picks.
+// A type that declares static constexpr bool deterministic = true returns bool (spin again or not) instead of a
+// probability, and the solve selects an option instead of mixing policy * spin + (1 - policy) * stay.
+template <class Policies, class = void>
+struct PolicyTraits {
+    static constexpr bool deterministic = false;
+};
+template <class Policies>
+struct PolicyTraits<Policies, std::void_t<decltype(Policies::deterministic)>> {
+    static constexpr bool deterministic = Policies::deterministic;
+};
+
+// What a policy returns: the probability of spinning again, or whether to for deterministic policies
+template <class Num, class Policies>
+using PolicyChoice = std::conditional_t<PolicyTraits<Policies>::deterministic, bool, Num>;
+
+// The optimal policies (below) compiled: spin again when that wins strictly more often
+template <class Num>
+struct OptimalPolicies {
+    using number_type = Num;
+    static constexpr bool deterministic = true;
+    bool third_player(const DpTables<Num>& tables, int p1, int p2, int spin, int spins) const {
+        return tables.third_player_probability(p1, p2, spin, spins, 2) > tables.third_player_probability(p1, p2, spin, 0, 2);
+    }
+    bool second_player(const DpTables<Num>& tables, int p1, int spin, int spins) const {
+        return tables.second_player_probability(p1, spin, spins, 1) > tables.second_player_probability(p1, spin, 0, 1);
+    }
+    bool first_player(const DpTables<Num>& tables, int spin, int spins) const {
+        return tables.first_player_probability(spin, spins, 0) > tables.first_player_probability(spin, 0, 0);
+    }
+};
+
+// Optimal 3rd player policy (for winning game): Spin again if less than max score
+template <class Num>
+Num third_player_optimal_policy(const DpTables<Num>& tables, int player1_score, int player2_score, int spin1, int spins);
+// Optimal 2nd player policy (for winning game) -- ASSUMING 3RD PLAYER ACTS ACCORDING TO THEIR POLICY
+template <class Num>
+Num second_player_optimal_policy(const DpTables<Num>& tables, int player1_score, int spin1, int spins);
+// Optimal 1st player policy (for winning game) -- ASSUMING 2ND & 3RD PLAYER ACTS ACCORDING TO THEIR POLICY
+template <class Num>
+Num first_player_optimal_policy(const DpTables<Num>& tables, int spin1, int spins);
+
+// All three optimal policies, named "optimal" (solved as OptimalPolicies)
+template <class Num>
+PolicySet<Num> optimal_policies();
+
+
+// -- Initialize DP tables --
+// The solve runs in six stages, last player first. Each stage only reads the tables filled by the stages before it,
+// so a stage can be re-run (or timed) on its own once the earlier stages are filled. The options stages only use
+// the policies with more than two spins per turn (for the choices after the later spins).
+template <class Num, class Policies>
+void solve_third_player_options(DpTables<Num>& tables, const GameRules& rules, const Policies& policies); // Stage 1: win probabilities for each of the 3rd player's options
+template <class Num, class Policies>
+void solve_third_player_policy(DpTables<Num>& tables, const GameRules& rules, const Policies& policies); // Stage 2
+template <class Num, class Policies>
+void solve_second_player_options(DpTables<Num>& tables, const GameRules& rules, const Policies& policies); // Stage 3
+template <class Num, class Policies>
+void solve_second_player_policy(DpTables<Num>& tables, const GameRules& rules, const Policies& policies); // Stage 4
+template <class Num, class Policies>
+void solve_first_player_options(DpTables<Num>& tables, const GameRules& rules, const Policies& policies); // Stage 5
+template <class Num, class Policies>
+void solve_first_player_policy(DpTables<Num>& tables, const GameRules& rules, const Policies& policies); // Stage 6
+
+// Run all six stages on new tables
+// NOTE: the exact (Fraction) solve is only safe for small wheels, the denominators grow like segments^6
+// NOTE: instantiated for PolicySet, OptimalPolicies and ThresholdPolicies (policies.h)
+template <class Policies>
+DpTables<typename Policies::number_type> initialize_dp_tables(const GameRules& rules, const Policies& policies);
+
+// ...or again on tables of the same rules' shape, overwriting them (no allocation, except when the 3rd player's
+// policy switches class tables to the per (p1, p2) layout; for loops of many solves)
+template <class Num, class Policies>
+void solve_dp_tables(DpTables<Num>& tables, const GameRules& rules, const Policies& policies);
+
+// -- State lookups --
+// Win probability of player winner (0-2) from the state where player (1-3) has made their first spin (spin = 0:
+// before it), given the earlier players' totals p1 / p2, when everyone plays by policies
+template <class Num>
+Num policy_state_probability(const DpTables<Num>& tables, const GameRules& rules, const PolicySet<Num>& policies,
+                             int player, int p1, int p2, int spin, int winner);
+
+#endif // DP_SOLVER_H
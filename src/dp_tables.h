@@ -0,0 +1,123 @@
+#ifndef DP_TABLES_H
+#define DP_TABLES_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+// --- Tables ---
+// All six solver tables of one solve, laid out back to back in one block of values (in this order):
+// NOTE: The "spin" values can only be 1-S, 0 means the player chose not to do the first spin which isn't allowed
+//   third_player_probability:        (leading total) (1st and 2nd player tied [1] or not [0]) (3rd player spin) (option) (player # - 1)
+//   third_player_policy_probability: (1st player total) (2nd player total) (player # - 1)   -- incorporate third player policy
+//   second_player_probability:       (1st player total) (2nd player spin) (option) (player # - 1)
+//   second_player_policy_probability:(1st player total) (player # - 1)   -- incorporate second player policy
+//   first_player_probability:        (1st player spin) (option) (player # - 1)
+//   first_player_policy_probability: (player # - 1)   -- incorporate first player policy (expected win rates)
+// where totals / spins run over 0..scores-1. Every entry is a win probability.
+//
+// With up to K spins per turn (GameRules::spins_per_turn) the "spin" is the running total and there are K options:
+// 0 = stay, j = spin again after j spins (1..K-1). Staying is worth the same whatever the spin count, so it is
+// stored once instead of once per spin count: K entries per total rather than 2 * (K - 1). In the standard game
+// (K = 2) that is the familiar spin again [1] or not [0].
+//
+// The 3rd player's options only depend on the score to beat, max(p1, p2), and on whether the first two are tied:
+// the trailing total can't win any more, and who leads only says which of the first two gets the leader's share.
+// So that table stores one entry per class, as if player 1 leads (or both tie) -- the other player's column is
+// 0 when they don't tie -- and third_player_probability(p1, p2, ...) maps (p1, p2) to its class, swapping
+// players 1 and 2 when player 2 leads. That is 2 * scores instead of scores^2 entries per spin.
+// (In an N-player game the same holds for the last player, classes being the leading total and how many tie
+// for it; the policy tables still take the full totals, policies may look at them.)
+// With more than two spins per turn the options after the later spins also follow the 3rd player's policy, and a
+// policy that looks at more than the class (e.g. at p2 when player 1 leads) makes class members differ. The
+// solver detects that and stores those tables per (p1, p2) instead (third_player_by_class() false):
+//   third_player_probability:        (1st player total) (2nd player total) (3rd player spin) (option) (player # - 1)
+//
+// A DpTables is a cheap handle: copies share the same values. The values are either owned (allocate) or
+// borrowed from something that keeps them alive, e.g. a memory-mapped cache file (see table_cache.h).
+template <class Num>
+class DpTables {
+public:
+    DpTables() = default;
+
+    // New zeroed tables for totals 0..scores-1 and options 0..options-1 (options = spins per turn), the 3rd
+    // player's options stored per class or per (p1, p2)
+    static DpTables allocate(int scores, int options, bool third_by_class = true) {
+        auto storage = std::make_shared<std::vector<Num>>(value_count(scores, options, third_by_class));
+        Num* data = storage->data();
+        return DpTables(scores, options, third_by_class, data, std::move(storage));
+    }
+
+    // Tables viewing values owned by owner (which must hold value_count(scores, options, third_by_class) values at data)
+    static DpTables view(int scores, int options, bool third_by_class, Num* data, std::shared_ptr<const void> owner) {
+        return DpTables(scores, options, third_by_class, data, std::move(owner));
+    }
+
+    // Number of values in all six tables together
+    static size_t value_count(int scores, int options, bool third_by_class = true) {
+        size_t s = scores, k = options;
+        return s * (third_by_class ? 2 : s) * s * k * 3 + s * s * 3 + s * s * k * 3 + s * 3 + s * k * 3 + 3;
+    }
+
+    bool empty() const { return data == nullptr; }
+    int scores() const { return num_scores; }
+    int options() const { return num_options; }
+    bool third_player_by_class() const { return third_by_class; }
+    Num* values() const { return data; }
+    size_t size() const { return value_count(num_scores, num_options, third_by_class); }
+
+    // -- Accessors (same index order as the table descriptions above) --
+    Num& third_player_probability(int p1, int p2, int spin, int option, int player) const {
+        if (!third_by_class)
+            return data[((((size_t)p1 * num_scores + p2) * num_scores + spin) * num_options + option) * 3 + player];
+        if (p2 > p1 && player < 2) // player 2 leads: the class is stored with player 1 leading
+            player = 1 - player;
+        return third_player_class_probability(p1 > p2 ? p1 : p2, p1 == p2, spin, option, player);
+    }
+    // (class layout only)
+    Num& third_player_class_probability(int leader, int tied, int spin, int option, int player) const {
+        return data[((((size_t)leader * 2 + tied) * num_scores + spin) * num_options + option) * 3 + player];
+    }
+    Num& third_player_policy_probability(int p1, int p2, int player) const {
+        return data[third_policy_offset() + (size_t)(p1 * num_scores + p2) * 3 + player];
+    }
+    Num& second_player_probability(int p1, int spin, int option, int player) const {
+        return data[second_offset() + ((size_t)(p1 * num_scores + spin) * num_options + option) * 3 + player];
+    }
+    Num& second_player_policy_probability(int p1, int player) const {
+        return data[second_policy_offset() + (size_t)p1 * 3 + player];
+    }
+    Num& first_player_probability(int spin, int option, int player) const {
+        return data[first_offset() + ((size_t)spin * num_options + option) * 3 + player];
+    }
+    Num& first_player_policy_probability(int player) const {
+        return data[first_policy_offset() + player];
+    }
+
+private:
+    DpTables(int scores, int options, bool third_by_class, Num* data, std::shared_ptr<const void> owner)
+        : num_scores(scores), num_options(options), third_by_class(third_by_class), data(data), owner(std::move(owner)) {
+        size_t s = scores, k = options;
+        offsets[0] = s * (third_by_class ? 2 : s) * s * k * 3; // third_player_policy_probability
+        offsets[1] = offsets[0] + s * s * 3;                   // second_player_probability
+        offsets[2] = offsets[1] + s * s * k * 3;               // second_player_policy_probability
+        offsets[3] = offsets[2] + s * 3;                       // first_player_probability
+        offsets[4] = offsets[3] + s * k * 3;                   // first_player_policy_probability
+    }
+
+    size_t third_policy_offset() const { return offsets[0]; }
+    size_t second_offset() const { return offsets[1]; }
+    size_t second_policy_offset() const { return offsets[2]; }
+    size_t first_offset() const { return offsets[3]; }
+    size_t first_policy_offset() const { return offsets[4]; }
+
+    int num_scores = 0;
+    int num_options = 2;
+    bool third_by_class = true; // 3rd player's options per (leading total, tied) class, else per (p1, p2)
+    size_t offsets[5] = {}; // where the tables after the first start
+    Num* data = nullptr;
+    std::shared_ptr<const void> owner; // keeps data alive
+};
+
+#endif // DP_TABLES_H
@@ -0,0 +1,83 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include "numeric.h"
+
+
+// --- Dual numbers ---
+// Forward-mode automatic differentiation: a value together with its gradient with respect to the wheel's segment
+// probabilities. The solver gives segment v its probability (GameRules::segment_probability) with the unit vector
+// e_v as its gradient (NumericTraits<Dual>::segment_variable), so one solve over Dual tables carries the derivative
+// of every table entry along with its value -- instead of a re-solve per segment.
+// The gradient is unconstrained (each segment probability moved on its own, the wheel no longer summing to 1);
+// moving eps of probability from segment u to segment v changes a value by eps * (gradient[v - 1] - gradient[u - 1]).
+// Decisions compare values only, so a policy's decisions are held fixed, as for a one-sided derivative.
+class Dual {
+public:
+    static constexpr int gradient_size = 20; // segments of the standard wheel; larger wheels can't be differentiated
+
+    Dual() = default; // 0
+    Dual(double value) : value(value) {} // a constant
+
+    double value = 0;
+    std::array<double, gradient_size> gradient{};
+
+    friend Dual operator+(Dual a, const Dual& b) {
+        a.value += b.value;
+        for (int i = 0; i < gradient_size; i++)
+            a.gradient[i] += b.gradient[i];
+        return a;
+    }
+    friend Dual operator-(Dual a, const Dual& b) {
+        a.value -= b.value;
+        for (int i = 0; i < gradient_size; i++)
+            a.gradient[i] -= b.gradient[i];
+        return a;
+    }
+    friend Dual operator*(const Dual& a, const Dual& b) {
+        Dual product(a.value * b.value);
+        for (int i = 0; i < gradient_size; i++)
+            product.gradient[i] = a.value * b.gradient[i] + b.value * a.gradient[i];
+        return product;
+    }
+    friend Dual operator/(const Dual& a, const Dual& b) {
+        Dual quotient(a.value / b.value);
+        for (int i = 0; i < gradient_size; i++)
+            quotient.gradient[i] = (a.gradient[i] - quotient.value * b.gradient[i]) / b.value;
+        return quotient;
+    }
+    Dual& operator+=(const Dual& other) { return *this = *this + other; }
+    Dual& operator-=(const Dual& other) { return *this = *this - other; }
+    Dual& operator*=(const Dual& other) { return *this = *this * other; }
+
+    friend bool operator==(const Dual& a, const Dual& b) = default;
+    // ordered by value (the decisions)
+    friend bool operator<(const Dual& a, const Dual& b) { return a.value < b.value; }
+    friend bool operator>(const Dual& a, const Dual& b) { return a.value > b.value; }
+    friend bool operator<=(const Dual& a, const Dual& b) { return a.value <= b.value; }
+    friend bool operator>=(const Dual& a, const Dual& b) { return a.value >= b.value; }
+};
+
+template <>
+struct NumericTraits<Dual> {
+    static constexpr NumericKind kind = NumericKind::dual;
+    static constexpr const char* name = "dual";
+    static Dual ratio(long long num, long long denom) { return Dual((double)num / (double)denom); }
+    static double to_double(const Dual& value) { return value.value; }
+    static bool is_one(const Dual& value) { return std::abs(value.value - 1.0) < 1e-9; }
+
+    // The probability of spinning value (1..gradient_size), as the variable of gradient entry value - 1
+    static Dual segment_variable(int value, double probability) {
+        if (value > Dual::gradient_size)
+            throw std::invalid_argument("Dual numbers differentiate wheels of up to "
+                                        + std::to_string(Dual::gradient_size) + " segments");
+        Dual variable(probability);
+        variable.gradient[value - 1] = 1;
+        return variable;
+    }
+};
+
+#endif // DUAL_H
@@ -0,0 +1,80 @@
+#include "episode.h"
+#include <algorithm>
+#include <numeric>
+using namespace std;
+
+array<int, 3> spin_order(const array<long long, 3>& pre_wheel_winnings) {
+    array<int, 3> order;
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(),
+                [&](int a, int b) { return pre_wheel_winnings[a] < pre_wheel_winnings[b]; });
+    return order;
+}
+
+vector<long long> winnings_class_bounds(vector<long long> pool, int count) {
+    sort(pool.begin(), pool.end());
+    vector<long long> bounds;
+    for (int i = 1; i < count && !pool.empty(); i++) {
+        long long bound = pool[(pool.size() * i - 1) / count];
+        if (bounds.empty() || bound > bounds.back())
+            bounds.push_back(bound);
+    }
+    return bounds;
+}
+
+int winnings_class(long long winnings, const vector<long long>& bounds) {
+    return lower_bound(bounds.begin(), bounds.end(), winnings) - bounds.begin();
+}
+
+string winnings_class_name(int index, const vector<long long>& bounds) {
+    auto dollars = [](long long amount) {
+        string digits = to_string(amount), text;
+        for (size_t i = 0; i < digits.size(); i++) {
+            if (i > 0 && (digits.size() - i) % 3 == 0)
+                text += ',';
+            text += digits[i];
+        }
+        return "$" + text;
+    };
+    const string low = index == 0 ? "$0" : dollars(bounds[index - 1] + 1);
+    return index < (int)bounds.size() ? low + "-" + dollars(bounds[index]) : low + "+";
+}
+
+EpisodeModel::EpisodeModel(const array<double, 3>& seat_win_probability, const ShowcaseModel& showcase)
+    : seat_win(seat_win_probability), showcase(showcase) {}
+
+array<ContestantOutlook, 6> EpisodeModel::solve(const EpisodeRecord& episode) const {
+    // -- Wheel layer: each contestant's seat, and so their chance to win the showdown --
+    array<ContestantOutlook, 6> contestants;
+    for (int showdown = 0; showdown < 2; showdown++) {
+        const auto& records = episode.showdowns[showdown].contestants;
+        const array<int, 3> order = spin_order(
+            {records[0].pre_wheel_winnings, records[1].pre_wheel_winnings, records[2].pre_wheel_winnings});
+        for (int seat = 0; seat < 3; seat++) {
+            ContestantOutlook& contestant = contestants[showdown * 3 + order[seat]];
+            contestant.name = records[order[seat]].name;
+            contestant.showdown = showdown;
+            contestant.seat = seat;
+            contestant.pre_wheel_winnings = records[order[seat]].pre_wheel_winnings;
+            contestant.showcase_probability = seat_win[seat];
+        }
+    }
+
+    // -- Showcase layer: against each possible winner of the other showdown --
+    for (ContestantOutlook& contestant : contestants) {
+        double win = 0;
+        for (int other = 0; other < 3; other++) {
+            const ContestantOutlook& opponent = contestants[(1 - contestant.showdown) * 3 + other];
+            const double role = (contestant.pre_wheel_winnings > opponent.pre_wheel_winnings)
+                                    ? showcase.top_win_probability
+                                : (contestant.pre_wheel_winnings < opponent.pre_wheel_winnings)
+                                    ? showcase.other_win_probability
+                                    : (showcase.top_win_probability + showcase.other_win_probability) / 2;
+            win += opponent.showcase_probability * role;
+        }
+        contestant.win_probability = contestant.showcase_probability * win;
+        contestant.expected_showcase = contestant.win_probability * showcase.prize_value;
+        contestant.expected_total = contestant.pre_wheel_winnings + contestant.expected_showcase;
+    }
+    return contestants;
+}
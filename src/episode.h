@@ -0,0 +1,61 @@
+#ifndef EPISODE_H
+#define EPISODE_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include "replay.h"
+
+
+// --- Episode model ---
+// A whole episode: two Showcase Showdowns, whose winners meet in the Showcase. In each showdown the contestant with
+// the least pre-wheel winnings spins first and the one with the most spins last. The wheel layer is one solve: the
+// seats' win probabilities, reused for every spin order and every episode. The Showcase layer is parametric (below).
+// Together they give each contestant's chance to reach and win the Showcase and their expected winnings.
+// With the Showcase prize independent of the wheel, maximizing the chance to win the showdown also maximizes the
+// episode value, so the wheel policies carry over unchanged (the $1,000 wheel bonus is left out).
+
+// The Showcase: the contestant with more winnings (the "top winner", who may pass the first showcase) wins their
+// showcase with top_win_probability, the other one with other_win_probability (equal winnings: the average)
+struct ShowcaseModel {
+    double top_win_probability = 0.5;
+    double other_win_probability = 0.4;
+    double prize_value = 30000; // average value of a showcase, in dollars
+};
+
+// -- Spin order and winnings classes --
+// Spin order of three contestants by pre-wheel winnings: order[seat] = index of the contestant (ties keep their order)
+std::array<int, 3> spin_order(const std::array<long long, 3>& pre_wheel_winnings);
+
+// Per-contestant results are grouped by pre-wheel winnings: the classes split a pool of winnings (e.g. a dataset's)
+// into count equally likely ranges. bounds[i] is the largest winnings of class i (the last class is open-ended).
+std::vector<long long> winnings_class_bounds(std::vector<long long> pool, int count);
+int winnings_class(long long winnings, const std::vector<long long>& bounds);
+// "$1,250-$3,400"
+std::string winnings_class_name(int index, const std::vector<long long>& bounds);
+
+struct ContestantOutlook {
+    std::string name;
+    int showdown = 0;              // 0 or 1
+    int seat = 0;                  // spin position, 0-2
+    long long pre_wheel_winnings = 0;
+    double showcase_probability = 0; // wins the showdown
+    double win_probability = 0;      // ...and then the Showcase
+    double expected_showcase = 0;    // expected Showcase winnings, dollars
+    double expected_total = 0;       // pre-wheel winnings + expected_showcase
+};
+
+class EpisodeModel {
+public:
+    // seat_win_probability: the wheel's win probability of each spin position (DpTables::first_player_policy_probability)
+    EpisodeModel(const std::array<double, 3>& seat_win_probability, const ShowcaseModel& showcase);
+
+    // The six contestants (showdown 1, then showdown 2, each in the episode's listed order)
+    std::array<ContestantOutlook, 6> solve(const EpisodeRecord& episode) const;
+
+private:
+    std::array<double, 3> seat_win;
+    ShowcaseModel showcase;
+};
+
+#endif // EPISODE_H
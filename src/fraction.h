@@ -0,0 +1,222 @@
+#ifndef FRACTION_H
+#define FRACTION_H
+
+#include <iostream>
+#include <numeric> // for gcd
+#include <algorithm> // for std::swap
+#include <climits> // for LLONG_MIN
+#include <compare> // for <=> operator
+#include <stdexcept> // for overflow_error
+#include "instrumentation.h"
+using namespace std;
+
+// Fraction class to represent rational numbers
+class Fraction {
+private:
+    long long numerator;
+    long long denominator;
+
+    // Helper function to simplify the fraction
+    void simplify() {
+        PIR_COUNT(fraction_simplify);
+        if (denominator == 0) {
+            throw std::runtime_error("Denominator cannot be zero");
+        }
+
+        if (numerator == 0) {
+            denominator = 1;
+            return;
+        }
+
+        PIR_COUNT(gcd_calls);
+        // gcd of the magnitudes in unsigned arithmetic (|LLONG_MIN| doesn't fit a long long)
+        long long common_divisor = (long long)std::gcd(magnitude(numerator), magnitude(denominator));
+        numerator /= common_divisor;
+        denominator /= common_divisor;
+
+        // Ensure denominator is always positive
+        if (denominator < 0) {
+            numerator = checked_negate(numerator);
+            denominator = checked_negate(denominator);
+        }
+    }
+
+    // -- Overflow checked integer helpers (a result that doesn't fit throws std::overflow_error) --
+    static unsigned long long magnitude(long long value) {
+        return value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+    }
+    static long long checked_negate(long long value) {
+        if (value == LLONG_MIN)
+            throw std::overflow_error("Fraction overflow");
+        return -value;
+    }
+    static long long checked_multiply(long long a, long long b) {
+        long long product;
+        if (__builtin_mul_overflow(a, b, &product))
+            throw std::overflow_error("Fraction overflow");
+        return product;
+    }
+    static long long gcd_of(long long a, long long b) {
+        PIR_COUNT(gcd_calls);
+        return (long long)std::gcd(magnitude(a), magnitude(b));
+    }
+
+    // Constructor for values already in lowest terms with a positive denominator (skips simplify)
+    struct Reduced {};
+    static constexpr Reduced reduced{};
+    Fraction(long long num, long long denom, Reduced) : numerator(num), denominator(denom) {}
+
+    // a + sign * b when the plain cross multiplication overflows (sign is 1 or -1), exact in 128 bits.
+    // With g = gcd(a.den, b.den) and t = a.num * (b.den / g) + sign * b.num * (a.den / g), the result is
+    // t / (a.den / g * b.den) and the only factors it can still share are those of gcd(t, g) (Knuth, TAOCP 4.5.1).
+    [[gnu::noinline, gnu::cold]] static Fraction add_wide(const Fraction& a, const Fraction& b, int sign) {
+        const long long common = gcd_of(a.denominator, b.denominator);
+        const long long a_scale = b.denominator / common;
+        const long long b_scale = a.denominator / common;
+        const __int128 t = (__int128)a.numerator * a_scale + (__int128)sign * b.numerator * b_scale;
+        if (t == 0)
+            return Fraction();
+        const __int128 t_magnitude = t < 0 ? -t : t;
+        const long long g = (long long)std::gcd((unsigned long long)(t_magnitude % common), (unsigned long long)common);
+        const __int128 new_num = t / g;
+        const __int128 new_den = (__int128)b_scale * (b.denominator / g);
+        if (new_num < LLONG_MIN || new_num > LLONG_MAX || new_den > LLONG_MAX)
+            throw std::overflow_error("Fraction overflow");
+        return Fraction((long long)new_num, (long long)new_den, reduced);
+    }
+
+public:
+    // Default constructor (0/1)
+    Fraction() : numerator(0), denominator(1) {}
+
+    // Constructor with numerator and denominator
+    Fraction(long long num, long long denom = 1) : numerator(num), denominator(denom) {
+        simplify();
+    }
+
+    // Get numerator
+    long long getNumerator() const { return numerator; }
+
+    // Get denominator
+    long long getDenominator() const { return denominator; }
+
+    // Set numerator and denominator
+    void set(long long num, long long denom) {
+        numerator = num;
+        denominator = denom;
+        simplify();
+    }
+
+    // Get value as long double
+    long double value() const {
+        return static_cast<long double>(numerator) / denominator;
+    }
+
+    // Arithmetic operators
+    // Operands are always in lowest terms, so common factors are divided out before multiplying (the results
+    // come out in lowest terms without a full simplify). Results are exact; one that doesn't fit in long long
+    // throws std::overflow_error instead of wrapping around.
+
+    Fraction operator+(const Fraction& other) const {
+        PIR_COUNT(fraction_ops);
+        long long lhs, rhs, new_num, new_den;
+        if (__builtin_mul_overflow(numerator, other.denominator, &lhs)
+            | __builtin_mul_overflow(other.numerator, denominator, &rhs)
+            | __builtin_add_overflow(lhs, rhs, &new_num)
+            | __builtin_mul_overflow(denominator, other.denominator, &new_den))
+            return add_wide(*this, other, 1);
+        return Fraction(new_num, new_den);
+    }
+
+    Fraction operator-(const Fraction& other) const {
+        PIR_COUNT(fraction_ops);
+        long long lhs, rhs, new_num, new_den;
+        if (__builtin_mul_overflow(numerator, other.denominator, &lhs)
+            | __builtin_mul_overflow(other.numerator, denominator, &rhs)
+            | __builtin_sub_overflow(lhs, rhs, &new_num)
+            | __builtin_mul_overflow(denominator, other.denominator, &new_den))
+            return add_wide(*this, other, -1);
+        return Fraction(new_num, new_den);
+    }
+
+    Fraction operator*(const Fraction& other) const {
+        PIR_COUNT(fraction_ops);
+        long long new_num, new_den;
+        if (!(__builtin_mul_overflow(numerator, other.numerator, &new_num)
+              | __builtin_mul_overflow(denominator, other.denominator, &new_den)))
+            return Fraction(new_num, new_den); // no overflow: one gcd
+        // cancel the cross factors first (gcd(0, d) == d keeps a zero product at 0/1)
+        long long cross1 = gcd_of(numerator, other.denominator);
+        long long cross2 = gcd_of(other.numerator, denominator);
+        new_num = checked_multiply(numerator / cross1, other.numerator / cross2);
+        new_den = checked_multiply(denominator / cross2, other.denominator / cross1);
+        return Fraction(new_num, new_den, reduced);
+    }
+
+    Fraction operator/(const Fraction& other) const {
+        PIR_COUNT(fraction_ops);
+        if (other.numerator == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        // multiply by the reciprocal, cancelling gcd(numerators) and gcd(denominators); the divisor's sign goes
+        // to the numerator before multiplying (so a LLONG_MIN numerator is reachable, a 2^63 denominator isn't)
+        long long numerators = gcd_of(numerator, other.numerator);
+        long long denominators = gcd_of(denominator, other.denominator);
+        long long num_factor = other.denominator / denominators;
+        long long den_factor = other.numerator / numerators;
+        if (den_factor < 0) {
+            num_factor = -num_factor; // positive before
+            den_factor = checked_negate(den_factor);
+        }
+        long long new_num = checked_multiply(numerator / numerators, num_factor);
+        long long new_den = checked_multiply(denominator / denominators, den_factor);
+        return Fraction(new_num, new_den, reduced);
+    }
+
+    // Compound assignment operators
+    Fraction& operator+=(const Fraction& other) {
+        *this = *this + other;
+        return *this;
+    }
+
+    Fraction& operator-=(const Fraction& other) {
+        *this = *this - other;
+        return *this;
+    }
+
+    Fraction& operator*=(const Fraction& other) {
+        *this = *this * other;
+        return *this;
+    }
+
+    Fraction& operator/=(const Fraction& other) {
+        *this = *this / other;
+        return *this;
+    }
+
+    // Equality operator
+    bool operator==(const Fraction& other) const {
+        return numerator == other.numerator && denominator == other.denominator;
+    }
+
+    // Comparison operator (C++20 spaceship operator)
+    // The cross products are 128 bit, so any two fractions compare correctly
+    auto operator<=>(const Fraction& other) const {
+        PIR_COUNT(fraction_ops);
+        __int128 lhs = (__int128)numerator * other.denominator;
+        __int128 rhs = (__int128)other.numerator * denominator;
+        return lhs <=> rhs;
+    }
+
+    // Output operator
+    friend std::ostream& operator<<(std::ostream& os, const Fraction& frac) {
+        if (frac.denominator == 1) {
+            os << frac.numerator;
+        } else {
+            os << frac.numerator << "/" << frac.denominator;
+        }
+        return os;
+    }
+};
+
+#endif // FRACTION_H
@@ -0,0 +1,42 @@
+#ifndef GAME_RULES_H
+#define GAME_RULES_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+// --- Rules ---
+// The rule configuration a solve depends on. Fields that are left at their defaults give the standard game.
+// Assumptions that are not configurable (yet):
+//   There is an equal probability of anyone winning in the spinoff
+//   No one is allowed to skip their first spin (including third player when both others bust)
+//   You are not allowed to spin again once your total reached the top score
+struct GameRules {
+    int segments = 20; // the wheel has values 1..segments (5, 10, ..., 100 cents) spun uniformly; above segments busts
+    int spins_per_turn = 2; // at most this many spins per turn (at least 2); the total is the sum, busting ends the turn
+    // Probability of each value 1..segments, empty for the uniform wheel. Only the floating (and dual) solves
+    // take a weighted wheel; the exact solvers, the simulator and the other engines need the uniform one.
+    std::vector<double> segment_probabilities;
+
+    int scores() const { return segments + 1; } // number of possible totals: 0 (bust) and 1..segments
+    bool uniform_wheel() const { return segment_probabilities.empty(); }
+    double segment_probability(int value) const {
+        return uniform_wheel() ? 1.0 / segments : segment_probabilities[value - 1];
+    }
+
+    // Canonical text form (part of the table cache key, so every field has to appear here)
+    // (the standard two spins are left out, so the keys of standard solves don't change)
+    std::string describe() const {
+        std::string text = "segments=" + std::to_string(segments)
+                           + (spins_per_turn != 2 ? " spins=" + std::to_string(spins_per_turn) : "");
+        for (size_t i = 0; i < segment_probabilities.size(); i++) {
+            char probability[32];
+            snprintf(probability, sizeof probability, "%.17g", segment_probabilities[i]);
+            text += (i == 0 ? " wheel=" : ",") + std::string(probability);
+        }
+        return text;
+    }
+};
+
+#endif // GAME_RULES_H
@@ -0,0 +1,175 @@
+#include "instrumentation.h"
+#include <fstream>
+#include <stdexcept>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+namespace instrumentation {
+
+namespace {
+
+struct Span {
+    const char* name;
+    int64_t start_us;
+    int64_t duration_us;
+};
+
+// Everything one thread records. Kept alive by the registry after the thread exits.
+struct ThreadData {
+    ThreadCounters counters;
+    int thread_id;
+    mutex spans_mutex; // uncontended except while a report / trace is being written
+    vector<Span> spans;
+    uint64_t dropped_spans = 0;
+};
+
+const size_t max_spans_per_thread = 1 << 20; // bound memory when a timer sits in a hot loop
+
+mutex registry_mutex;
+vector<unique_ptr<ThreadData>> registry;
+thread_local ThreadData* current_thread_data = nullptr;
+
+const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+ThreadData& thread_data() {
+    if (current_thread_data == nullptr)
+        register_thread();
+    return *current_thread_data;
+}
+
+// Copy of all spans, grouped by thread id
+vector<pair<int, vector<Span>>> collect_spans(uint64_t& dropped) {
+    vector<pair<int, vector<Span>>> spans;
+    dropped = 0;
+    lock_guard<mutex> lock(registry_mutex);
+    for (const unique_ptr<ThreadData>& data : registry) {
+        lock_guard<mutex> spans_lock(data->spans_mutex);
+        spans.emplace_back(data->thread_id, data->spans);
+        dropped += data->dropped_spans;
+    }
+    return spans;
+}
+
+} // namespace
+
+
+const char* counter_name(Counter counter) {
+    switch (counter) {
+        case fraction_ops: return "fraction_ops";
+        case fraction_simplify: return "fraction_simplify";
+        case gcd_calls: return "gcd_calls";
+        case third_options_states: return "third_options_states";
+        case third_policy_states: return "third_policy_states";
+        case second_options_states: return "second_options_states";
+        case second_policy_states: return "second_policy_states";
+        case first_options_states: return "first_options_states";
+        case first_policy_states: return "first_policy_states";
+        case simulated_games: return "simulated_games";
+        case modular_fallbacks: return "modular_fallbacks";
+        case counter_count: break;
+    }
+    return "unknown";
+}
+
+ThreadCounters* register_thread() {
+    lock_guard<mutex> lock(registry_mutex);
+    registry.push_back(make_unique<ThreadData>());
+    ThreadData* data = registry.back().get();
+    data->thread_id = (int)registry.size();
+    current_thread_data = data;
+    current_thread_counters = &data->counters;
+    return &data->counters;
+}
+
+array<uint64_t, counter_count> counter_totals() {
+    array<uint64_t, counter_count> totals{};
+    lock_guard<mutex> lock(registry_mutex);
+    for (const unique_ptr<ThreadData>& data : registry)
+        for (int c = 0; c < counter_count; c++)
+            totals[c] += data->counters.values[c].load(memory_order_relaxed);
+    return totals;
+}
+
+void reset() {
+    lock_guard<mutex> lock(registry_mutex);
+    for (const unique_ptr<ThreadData>& data : registry) {
+        for (atomic<uint64_t>& value : data->counters.values)
+            value.store(0, memory_order_relaxed);
+        lock_guard<mutex> spans_lock(data->spans_mutex);
+        data->spans.clear();
+        data->dropped_spans = 0;
+    }
+}
+
+int64_t now_us() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+void record_span(const char* name, int64_t start_us, int64_t duration_us) {
+    ThreadData& data = thread_data();
+    lock_guard<mutex> lock(data.spans_mutex);
+    if (data.spans.size() >= max_spans_per_thread) {
+        data.dropped_spans++;
+        return;
+    }
+    data.spans.push_back({name, start_us, duration_us});
+}
+
+void print_report(ostream& os) {
+    uint64_t dropped;
+    map<string, pair<long long, int64_t>> timers; // name -> (count, total us)
+    for (const auto& [thread_id, spans] : collect_spans(dropped))
+        for (const Span& span : spans) {
+            timers[span.name].first++;
+            timers[span.name].second += span.duration_us;
+        }
+
+    os << "-- Timers --" << endl;
+    for (const auto& [name, timer] : timers)
+        os << left << setw(36) << name << right << setw(10) << timer.first << " calls" << setw(14)
+           << timer.second / 1000.0 << " ms total" << endl;
+    if (dropped > 0)
+        os << "(" << dropped << " spans dropped, per-thread buffer full)" << endl;
+
+    os << "-- Counters --" << endl;
+    array<uint64_t, counter_count> totals = counter_totals();
+    for (int c = 0; c < counter_count; c++)
+        os << left << setw(36) << counter_name((Counter)c) << right << setw(16) << totals[c] << endl;
+}
+
+void write_chrome_trace(const string& path) {
+    ofstream out(path);
+    if (!out)
+        throw runtime_error("Cannot write trace file " + path);
+
+    uint64_t dropped;
+    const auto spans = collect_spans(dropped);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() -> ostream& {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        return out;
+    };
+    for (const auto& [thread_id, thread_spans] : spans) {
+        separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread_id
+                    << ",\"args\":{\"name\":\"thread " << thread_id << "\"}}";
+        for (const Span& span : thread_spans)
+            separator() << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread_id
+                        << ",\"ts\":" << span.start_us << ",\"dur\":" << span.duration_us << "}";
+    }
+
+    // Counter totals as one counter event at the end of the trace
+    array<uint64_t, counter_count> totals = counter_totals();
+    separator() << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << now_us() << ",\"args\":{";
+    for (int c = 0; c < counter_count; c++)
+        out << (c ? "," : "") << "\"" << counter_name((Counter)c) << "\":" << totals[c];
+    out << "}}";
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":" << dropped << "}}\n";
+}
+
+} // namespace instrumentation
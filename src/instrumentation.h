@@ -0,0 +1,104 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+// --- Instrumentation ---
+// Per-thread event counters and scoped timers for the solver and the simulator.
+// The PIR_COUNT / PIR_SCOPED_TIMER macros are compiled in only when PIR_INSTRUMENT is defined (CMake option
+// PIR_INSTRUMENTATION, always on in Debug builds); otherwise they expand to nothing and cost nothing.
+// Each thread writes only its own counters and event buffer, so recording never takes a lock.
+namespace instrumentation {
+
+enum Counter {
+    fraction_ops,          // Fraction arithmetic / comparison operations
+    fraction_simplify,     // Fraction::simplify calls
+    gcd_calls,             // std::gcd calls made by simplify
+    third_options_states,  // states visited by each solver stage
+    third_policy_states,
+    second_options_states,
+    second_policy_states,
+    first_options_states,
+    first_policy_states,
+    simulated_games,
+    modular_fallbacks,     // modular solves answered by the Fraction solver
+    counter_count
+};
+
+// Name of a counter (as shown in reports and traces)
+const char* counter_name(Counter counter);
+
+// Counters of one thread. Only the owning thread writes, readers may sum them at any time (relaxed atomics
+// so a concurrent read is not a data race; the increment still compiles to a plain add).
+struct ThreadCounters {
+    std::array<std::atomic<uint64_t>, counter_count> values{};
+};
+ThreadCounters* register_thread(); // creates the calling thread's counters and span buffer
+inline thread_local ThreadCounters* current_thread_counters = nullptr;
+inline ThreadCounters& thread_counters() {
+    if (current_thread_counters == nullptr)
+        current_thread_counters = register_thread();
+    return *current_thread_counters;
+}
+
+inline void add(Counter counter, uint64_t amount = 1) {
+    std::atomic<uint64_t>& value = thread_counters().values[counter];
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Counter totals over all threads (including threads that have finished)
+std::array<uint64_t, counter_count> counter_totals();
+
+// Clear all counters and recorded timer events
+void reset();
+
+// Microseconds since the first use of the instrumentation
+int64_t now_us();
+
+// Record a completed span [start_us, start_us + duration_us) on the calling thread.
+// name must outlive the trace (string literals)
+void record_span(const char* name, int64_t start_us, int64_t duration_us);
+
+// Times the enclosing scope
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) : name(name), start_us(now_us()) {}
+    ~ScopedTimer() { record_span(name, start_us, now_us() - start_us); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* name;
+    int64_t start_us;
+};
+
+// Per-name totals of the recorded spans plus the counter totals, as a readable table
+void print_report(std::ostream& os);
+
+// Write all recorded spans and the counter totals as Chrome trace-event JSON
+// (open in chrome://tracing or https://ui.perfetto.dev)
+void write_chrome_trace(const std::string& path);
+
+} // namespace instrumentation
+
+
+#define PIR_CONCAT_INNER(a, b) a##b
+#define PIR_CONCAT(a, b) PIR_CONCAT_INNER(a, b)
+
+#ifdef PIR_INSTRUMENT
+#define PIR_COUNT(counter) ::instrumentation::add(::instrumentation::counter)
+#define PIR_COUNT_N(counter, amount) ::instrumentation::add(::instrumentation::counter, (amount))
+#define PIR_SCOPED_TIMER(name) ::instrumentation::ScopedTimer PIR_CONCAT(pir_scoped_timer_, __LINE__)(name)
+#else
+#define PIR_COUNT(counter) ((void)0)
+#define PIR_COUNT_N(counter, amount) ((void)0)
+#define PIR_SCOPED_TIMER(name) ((void)0)
+#endif
+
+#endif // INSTRUMENTATION_H
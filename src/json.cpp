@@ -0,0 +1,262 @@
+#include "json.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+namespace {
+
+class JsonParser {
+public:
+    explicit JsonParser(string_view text) : text(text) {}
+
+    JsonValue parse_document() {
+        JsonValue value = parse_value(0);
+        skip_whitespace();
+        if (pos != text.size())
+            fail("unexpected trailing characters");
+        return value;
+    }
+
+private:
+    static const int max_depth = 256;
+
+    string_view text;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const string& message) const {
+        throw runtime_error("JSON parse error at byte " + to_string(pos) + ": " + message);
+    }
+
+    void skip_whitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t'))
+            pos++;
+    }
+
+    void expect(char c) {
+        if (pos >= text.size() || text[pos] != c)
+            fail(string("expected '") + c + "'");
+        pos++;
+    }
+
+    bool consume_literal(string_view literal) {
+        if (text.substr(pos, literal.size()) != literal)
+            return false;
+        pos += literal.size();
+        return true;
+    }
+
+    JsonValue parse_value(int depth) {
+        if (depth > max_depth)
+            fail("nesting too deep");
+        skip_whitespace();
+        if (pos >= text.size())
+            fail("unexpected end of input");
+
+        JsonValue value;
+        char c = text[pos];
+        if (c == '{') {
+            value.type = JsonValue::Type::object;
+            pos++;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == '}') {
+                pos++;
+                return value;
+            }
+            while (true) {
+                skip_whitespace();
+                string key = parse_string();
+                skip_whitespace();
+                expect(':');
+                value.object.emplace_back(move(key), parse_value(depth + 1));
+                skip_whitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                expect('}');
+                return value;
+            }
+        }
+        if (c == '[') {
+            value.type = JsonValue::Type::array;
+            pos++;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == ']') {
+                pos++;
+                return value;
+            }
+            while (true) {
+                value.array.push_back(parse_value(depth + 1));
+                skip_whitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                expect(']');
+                return value;
+            }
+        }
+        if (c == '"') {
+            value.type = JsonValue::Type::string;
+            value.string = parse_string();
+            return value;
+        }
+        if (consume_literal("true")) {
+            value.type = JsonValue::Type::boolean;
+            value.boolean = true;
+            return value;
+        }
+        if (consume_literal("false")) {
+            value.type = JsonValue::Type::boolean;
+            return value;
+        }
+        if (consume_literal("null"))
+            return value;
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            value.type = JsonValue::Type::number;
+            value.number = parse_number();
+            return value;
+        }
+        fail(string("unexpected character '") + c + "'");
+    }
+
+    double parse_number() {
+        size_t start = pos;
+        if (text[pos] == '-')
+            pos++;
+        while (pos < text.size() && ((text[pos] >= '0' && text[pos] <= '9') || text[pos] == '.' || text[pos] == 'e'
+                                     || text[pos] == 'E' || text[pos] == '+' || text[pos] == '-'))
+            pos++;
+        string digits(text.substr(start, pos - start));
+        char* end = nullptr;
+        double number = strtod(digits.c_str(), &end);
+        if (end != digits.c_str() + digits.size())
+            fail("malformed number '" + digits + "'");
+        return number;
+    }
+
+    unsigned parse_hex4() {
+        if (pos + 4 > text.size())
+            fail("truncated \\u escape");
+        unsigned code = 0;
+        for (int i = 0; i < 4; i++) {
+            char h = text[pos++];
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= h - '0';
+            else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+            else fail("bad \\u escape");
+        }
+        return code;
+    }
+
+    static void append_utf8(string& out, unsigned code) {
+        if (code < 0x80) {
+            out += (char)code;
+        } else if (code < 0x800) {
+            out += (char)(0xC0 | (code >> 6));
+            out += (char)(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += (char)(0xE0 | (code >> 12));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        } else {
+            out += (char)(0xF0 | (code >> 18));
+            out += (char)(0x80 | ((code >> 12) & 0x3F));
+            out += (char)(0x80 | ((code >> 6) & 0x3F));
+            out += (char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    string parse_string() {
+        expect('"');
+        string out;
+        while (true) {
+            // copy the run of plain characters in one go
+            size_t run = pos;
+            while (run < text.size() && text[run] != '"' && text[run] != '\\')
+                run++;
+            out.append(text.substr(pos, run - pos));
+            pos = run;
+            if (pos >= text.size())
+                fail("unterminated string");
+            if (text[pos] == '"') {
+                pos++;
+                return out;
+            }
+            pos++; // backslash
+            if (pos >= text.size())
+                fail("unterminated escape");
+            char e = text[pos++];
+            switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned code = parse_hex4();
+                    if (code >= 0xD800 && code <= 0xDBFF && text.substr(pos, 2) == "\\u") { // surrogate pair
+                        pos += 2;
+                        unsigned low = parse_hex4();
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default: fail(string("bad escape '\\") + e + "'");
+            }
+        }
+    }
+};
+
+} // namespace
+
+
+const JsonValue* JsonValue::find(string_view key) const {
+    for (const auto& [member_key, member] : object)
+        if (member_key == key)
+            return &member;
+    return nullptr;
+}
+
+JsonValue parse_json(string_view text) {
+    return JsonParser(text).parse_document();
+}
+
+JsonValue parse_json_file(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in)
+        throw runtime_error("Cannot open " + path);
+    stringstream buffer;
+    buffer << in.rdbuf();
+    return parse_json(buffer.str());
+}
+
+string json_quote(string_view text) {
+    string out = "\"";
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
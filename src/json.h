@@ -0,0 +1,40 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// --- JSON ---
+// Minimal JSON reader for the scraped datasets (PyCharmMiscProject/*.json): parses a whole document into a tree.
+class JsonValue {
+public:
+    enum class Type { null, boolean, number, string, array, object };
+
+    Type type = Type::null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object; // members in document order
+
+    bool is_null() const { return type == Type::null; }
+    bool is_number() const { return type == Type::number; }
+    bool is_string() const { return type == Type::string; }
+    bool is_array() const { return type == Type::array; }
+    bool is_object() const { return type == Type::object; }
+
+    // Member with this key (nullptr if this is not an object or has no such member)
+    const JsonValue* find(std::string_view key) const;
+};
+
+// Parse a JSON document (throws std::runtime_error with the byte offset on malformed input)
+JsonValue parse_json(std::string_view text);
+JsonValue parse_json_file(const std::string& path);
+
+// text as a quoted JSON string
+std::string json_quote(std::string_view text);
+
+#endif // JSON_H
@@ -0,0 +1,398 @@
+#include "markov_chain.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include "instrumentation.h"
+using namespace std;
+
+namespace {
+
+template <class Num>
+Num number(long long num, long long denom) { return NumericTraits<Num>::ratio(num, denom); }
+template <class Num>
+bool is_zero(const Num& value) { return value == number<Num>(0, 1); }
+
+// One state's outgoing probabilities while it is built (a handful of targets, merged on insert)
+template <class Num>
+struct Row {
+    vector<pair<uint32_t, Num>> targets;
+    array<Num, 3> absorption = {number<Num>(0, 1), number<Num>(0, 1), number<Num>(0, 1)};
+
+    void add(size_t state, const Num& probability) {
+        if (is_zero(probability))
+            return;
+        for (auto& [target, p] : targets)
+            if (target == state) {
+                p += probability;
+                return;
+            }
+        targets.push_back({(uint32_t)state, probability});
+    }
+};
+
+// Players (bit k = player k + 1) with the highest of the three totals
+int leaders(int p1, int p2, int p3) {
+    int best = max(p1, max(p2, p3));
+    return (p1 == best) | (p2 == best) << 1 | (p3 == best) << 2;
+}
+
+// Where the end of a game with these totals goes: straight to the winner, or to the spin-off of the tied players
+template <class Num>
+void add_outcome(const MarkovChain<Num>& chain, Row<Num>& row, int tied, const Num& probability) {
+    if (__builtin_popcount(tied) == 1)
+        row.absorption[__builtin_ctz(tied)] += probability;
+    else
+        row.add(chain.spin_off_state(tied), probability);
+}
+
+int popcount(int bits) { return __builtin_popcount(bits); }
+
+} // namespace
+
+
+template <class Num>
+string MarkovChain<Num>::describe_state(size_t state) const {
+    auto turn = [this](size_t index) {
+        return "total=" + to_string(index / spins_per_turn + 1) + " spins=" + to_string(index % spins_per_turn + 1);
+    };
+    const size_t s = scores();
+    if (state == first_player_start())
+        return "player 1 start";
+    if (state < second_start_offset())
+        return "player 1 " + turn(state - 1);
+    if (state < second_state_offset())
+        return "player 2 start p1=" + to_string(state - second_start_offset());
+    if (state < third_start_offset()) {
+        size_t index = state - second_state_offset();
+        return "player 2 p1=" + to_string(index / turn_states()) + " " + turn(index % turn_states());
+    }
+    if (state < third_state_offset()) {
+        size_t index = state - third_start_offset();
+        return "player 3 start p1=" + to_string(index / s) + " p2=" + to_string(index % s);
+    }
+    if (state < spin_off_offset()) {
+        size_t index = state - third_state_offset(), players = index / turn_states();
+        return "player 3 p1=" + to_string(players / s) + " p2=" + to_string(players % s) + " "
+               + turn(index % turn_states());
+    }
+    const int masks[4] = {3, 5, 6, 7};
+    string tied;
+    for (int k = 0; k < 3; k++)
+        if (masks[state - spin_off_offset()] & (1 << k))
+            tied += (tied.empty() ? "" : "+") + to_string(k + 1);
+    return "spin-off " + tied;
+}
+
+
+// -- Building the chain --
+template <class Num>
+MarkovChain<Num> build_markov_chain(const GameRules& rules, const DpTables<Num>& tables,
+                                    const PolicySet<Num>& policies) {
+    PIR_SCOPED_TIMER("build_markov_chain");
+    if (!rules.uniform_wheel())
+        throw invalid_argument("The Markov chain engine only takes the uniform wheel");
+    const int segments = rules.segments, max_spins = rules.spins_per_turn;
+    MarkovChain<Num> chain;
+    chain.segments = segments;
+    chain.spins_per_turn = max_spins;
+    vector<Row<Num>> rows(chain.state_count());
+    const Num spin_probability = number<Num>(1, segments);
+
+    // A player's turn: from the start, the first spin; after a spin, stay or (policy) spin again, where every
+    // value past the top score busts. end(total, row, probability) adds where the turn ending on total leads.
+    auto add_turn = [&](auto state_of, auto policy, auto end, size_t start) {
+        for (int value = 1; value <= segments; value++)
+            rows[start].add(state_of(value, 1), spin_probability);
+        for (int spins = 1; spins <= max_spins; spins++)
+            for (int total = 1; total <= segments; total++) {
+                Row<Num>& row = rows[state_of(total, spins)];
+                Num again = (spins < max_spins && total < segments) ? policy(total, spins) : number<Num>(0, 1);
+                end(total, row, number<Num>(1, 1) - again);
+                if (is_zero(again))
+                    continue;
+                const Num each = again * spin_probability;
+                for (int value = 1; total + value <= segments; value++)
+                    row.add(state_of(total + value, spins + 1), each);
+                end(0, row, number<Num>(total, 1) * each); // the values that bust
+            };
+    };
+
+    add_turn([&](int total, int spins) { return chain.first_player_state(total, spins); },
+             [&](int total, int spins) { return policies.first_player(tables, total, spins); },
+             [&](int total, Row<Num>& row, const Num& p) { row.add(chain.second_player_start(total), p); },
+             chain.first_player_start());
+    for (int p1 = 0; p1 <= segments; p1++) {
+        add_turn([&](int total, int spins) { return chain.second_player_state(p1, total, spins); },
+                 [&](int total, int spins) { return policies.second_player(tables, p1, total, spins); },
+                 [&](int total, Row<Num>& row, const Num& p) { row.add(chain.third_player_start(p1, total), p); },
+                 chain.second_player_start(p1));
+        for (int p2 = 0; p2 <= segments; p2++)
+            add_turn([&](int total, int spins) { return chain.third_player_state(p1, p2, total, spins); },
+                     [&](int total, int spins) { return policies.third_player(tables, p1, p2, total, spins); },
+                     [&](int total, Row<Num>& row, const Num& p) {
+                         add_outcome(chain, row, leaders(p1, p2, total), p);
+                     },
+                     chain.third_player_start(p1, p2));
+    }
+
+    // Spin-offs: every tied player spins once; the players T in tied that share the highest spin m win (|T| = 1)
+    // or go again, with probability (1/S)^|T| ((m - 1)/S)^(n - |T|) summed over m
+    for (int tied : {3, 5, 6, 7}) {
+        Row<Num>& row = rows[chain.spin_off_state(tied)];
+        const int n = popcount(tied);
+        for (int top = tied; top > 0; top = (top - 1) & tied) // the nonempty subsets of tied
+            for (int m = 1; m <= segments; m++) {
+                Num p = number<Num>(1, 1);
+                for (int k = 0; k < n; k++)
+                    p *= (k < popcount(top)) ? spin_probability : number<Num>(m - 1, segments);
+                add_outcome(chain, row, top, p);
+            }
+    }
+
+    // Compress
+    chain.row_start.reserve(rows.size() + 1);
+    chain.row_start.push_back(0);
+    for (Row<Num>& row : rows) {
+        for (auto& [target, p] : row.targets) {
+            chain.column.push_back(target);
+            chain.probability.push_back(std::move(p));
+        }
+        chain.absorption.push_back(row.absorption);
+        chain.row_start.push_back(chain.column.size());
+    }
+    return chain;
+}
+
+
+// -- Solvers --
+template <class Num>
+vector<vector<uint32_t>> strongly_connected_components(const MarkovChain<Num>& chain) {
+    // Tarjan's algorithm with an explicit stack (the chain is deep: a turn is a long path)
+    const size_t n = chain.states();
+    const uint32_t unvisited = UINT32_MAX;
+    vector<uint32_t> index(n, unvisited), low(n), stack;
+    vector<bool> on_stack(n, false);
+    vector<pair<uint32_t, size_t>> calls; // (state, next transition to follow)
+    vector<vector<uint32_t>> components;
+    uint32_t next_index = 0;
+    for (uint32_t root = 0; root < n; root++) {
+        if (index[root] != unvisited)
+            continue;
+        calls.push_back({root, chain.row_start[root]});
+        index[root] = low[root] = next_index++;
+        stack.push_back(root);
+        on_stack[root] = true;
+        while (!calls.empty()) {
+            auto& [state, next] = calls.back();
+            if (next < chain.row_start[state + 1]) {
+                uint32_t target = chain.column[next++];
+                if (index[target] == unvisited) {
+                    index[target] = low[target] = next_index++;
+                    stack.push_back(target);
+                    on_stack[target] = true;
+                    calls.push_back({target, chain.row_start[target]});
+                } else if (on_stack[target]) {
+                    low[state] = min(low[state], index[target]);
+                }
+                continue;
+            }
+            const uint32_t done = state;
+            calls.pop_back();
+            if (!calls.empty())
+                low[calls.back().first] = min(low[calls.back().first], low[done]);
+            if (low[done] == index[done]) {
+                vector<uint32_t> component;
+                uint32_t member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    on_stack[member] = false;
+                    component.push_back(member);
+                } while (member != done);
+                components.push_back(std::move(component));
+            }
+        }
+    }
+    return components;
+}
+
+namespace {
+
+template <class Num>
+bool has_self_loop(const MarkovChain<Num>& chain, uint32_t state) {
+    for (size_t i = chain.row_start[state]; i < chain.row_start[state + 1]; i++)
+        if (chain.column[i] == state)
+            return true;
+    return false;
+}
+
+template <class Num>
+void count_components(const MarkovChain<Num>& chain, const vector<vector<uint32_t>>& components,
+                      ChainSolveStats& stats) {
+    stats.components = components.size();
+    for (const vector<uint32_t>& component : components) {
+        stats.largest_component = max(stats.largest_component, component.size());
+        stats.cyclic_components += component.size() > 1 || has_self_loop(chain, component[0]);
+    }
+}
+
+} // namespace
+
+template <class Num>
+vector<array<Num, 3>> solve_absorption_exact(const MarkovChain<Num>& chain, ChainSolveStats* stats) {
+    PIR_SCOPED_TIMER("solve_absorption_exact");
+    using Traits = NumericTraits<Num>;
+    const Num zero = number<Num>(0, 1), one = number<Num>(1, 1);
+    const vector<vector<uint32_t>> components = strongly_connected_components(chain);
+    vector<array<Num, 3>> values(chain.states(), {zero, zero, zero});
+    vector<int> position(chain.states(), -1); // index in the component being solved
+    for (const vector<uint32_t>& component : components) {
+        const size_t m = component.size();
+        for (size_t i = 0; i < m; i++)
+            position[component[i]] = (int)i;
+
+        // (I - Q_CC) x_C = R_C + Q_C,out x_out, as an m x (m + 3) augmented matrix
+        vector<vector<Num>> matrix(m, vector<Num>(m + 3, zero));
+        for (size_t i = 0; i < m; i++) {
+            const uint32_t state = component[i];
+            matrix[i][i] = one;
+            for (int k = 0; k < 3; k++)
+                matrix[i][m + k] = chain.absorption[state][k];
+            for (size_t t = chain.row_start[state]; t < chain.row_start[state + 1]; t++) {
+                const uint32_t target = chain.column[t];
+                if (position[target] >= 0)
+                    matrix[i][position[target]] -= chain.probability[t];
+                else
+                    for (int k = 0; k < 3; k++)
+                        matrix[i][m + k] += chain.probability[t] * values[target][k];
+            }
+        }
+
+        // Gaussian elimination (pivot: the largest magnitude, any nonzero is exact for Fraction)
+        for (size_t col = 0; col < m; col++) {
+            size_t pivot = col;
+            for (size_t r = col + 1; r < m; r++)
+                if (fabs(Traits::to_double(matrix[r][col])) > fabs(Traits::to_double(matrix[pivot][col])))
+                    pivot = r;
+            if (is_zero(matrix[pivot][col]))
+                throw runtime_error("Markov chain: a component never reaches an absorbing state ("
+                                    + chain.describe_state(component[col]) + ")");
+            swap(matrix[col], matrix[pivot]);
+            for (size_t r = 0; r < m; r++) {
+                if (r == col || is_zero(matrix[r][col]))
+                    continue;
+                const Num factor = matrix[r][col] / matrix[col][col];
+                for (size_t c = col; c < m + 3; c++)
+                    matrix[r][c] -= factor * matrix[col][c];
+            }
+        }
+        for (size_t i = 0; i < m; i++) {
+            for (int k = 0; k < 3; k++)
+                values[component[i]][k] = matrix[i][m + k] / matrix[i][i];
+            position[component[i]] = -1;
+        }
+    }
+    if (stats)
+        count_components(chain, components, *stats);
+    return values;
+}
+
+vector<array<double, 3>> solve_absorption_gauss_seidel(const MarkovChain<double>& chain, double tolerance,
+                                                       int max_sweeps, ChainSolveStats* stats) {
+    PIR_SCOPED_TIMER("solve_absorption_gauss_seidel");
+    const vector<vector<uint32_t>> components = strongly_connected_components(chain);
+    vector<uint32_t> order;
+    order.reserve(chain.states());
+    for (const vector<uint32_t>& component : components)
+        order.insert(order.end(), component.begin(), component.end());
+
+    vector<array<double, 3>> values(chain.states(), {0, 0, 0});
+    auto update = [&](uint32_t state) {
+        array<double, 3> value = chain.absorption[state];
+        for (size_t t = chain.row_start[state]; t < chain.row_start[state + 1]; t++)
+            for (int k = 0; k < 3; k++)
+                value[k] += chain.probability[t] * values[chain.column[t]][k];
+        return value;
+    };
+    int sweeps = 0;
+    for (double change = INFINITY; change > tolerance && sweeps < max_sweeps; sweeps++) {
+        change = 0;
+        for (uint32_t state : order) {
+            array<double, 3> value = update(state);
+            for (int k = 0; k < 3; k++)
+                change = max(change, fabs(value[k] - values[state][k]));
+            values[state] = value;
+        }
+    }
+    if (stats) {
+        count_components(chain, components, *stats);
+        stats->sweeps = sweeps;
+        stats->residual = 0;
+        for (uint32_t state = 0; state < chain.states(); state++) {
+            array<double, 3> value = update(state);
+            for (int k = 0; k < 3; k++)
+                stats->residual = max(stats->residual, fabs(value[k] - values[state][k]));
+        }
+    }
+    return values;
+}
+
+
+// -- Cross-check --
+template <class Num>
+ChainCheck compare_chain_with_tables(const MarkovChain<Num>& chain, const vector<array<Num, 3>>& values,
+                                     const GameRules& rules, const DpTables<Num>& tables,
+                                     const PolicySet<Num>& policies, double tolerance) {
+    using Traits = NumericTraits<Num>;
+    ChainCheck check;
+    auto compare = [&](size_t state, auto expected) {
+        check.states++;
+        double difference = 0;
+        bool equal = true;
+        for (int k = 0; k < 3; k++) {
+            const Num table_value = expected(k);
+            equal = equal && values[state][k] == table_value;
+            difference = max(difference, fabs(Traits::to_double(values[state][k] - table_value)));
+        }
+        if (!equal && difference >= tolerance)
+            check.mismatches++;
+        if (difference > check.max_difference || (check.worst_state.empty() && !equal)) {
+            check.max_difference = difference;
+            check.worst_state = chain.describe_state(state);
+        }
+    };
+    const int segments = rules.segments;
+    compare(chain.first_player_start(), [&](int k) { return tables.first_player_policy_probability(k); });
+    for (int spin = 1; spin <= segments; spin++)
+        compare(chain.first_player_state(spin, 1),
+                [&](int k) { return policy_state_probability(tables, rules, policies, 1, 0, 0, spin, k); });
+    for (int p1 = 0; p1 <= segments; p1++) {
+        compare(chain.second_player_start(p1), [&](int k) { return tables.second_player_policy_probability(p1, k); });
+        for (int spin = 1; spin <= segments; spin++)
+            compare(chain.second_player_state(p1, spin, 1),
+                    [&](int k) { return policy_state_probability(tables, rules, policies, 2, p1, 0, spin, k); });
+        for (int p2 = 0; p2 <= segments; p2++) {
+            compare(chain.third_player_start(p1, p2),
+                    [&](int k) { return tables.third_player_policy_probability(p1, p2, k); });
+            for (int spin = 1; spin <= segments; spin++)
+                compare(chain.third_player_state(p1, p2, spin, 1),
+                        [&](int k) { return policy_state_probability(tables, rules, policies, 3, p1, p2, spin, k); });
+        }
+    }
+    return check;
+}
+
+
+// -- Instantiations --
+#define PIR_INSTANTIATE_MARKOV_CHAIN(Num) \
+    template struct MarkovChain<Num>; \
+    template MarkovChain<Num> build_markov_chain<Num>(const GameRules&, const DpTables<Num>&, const PolicySet<Num>&); \
+    template vector<vector<uint32_t>> strongly_connected_components<Num>(const MarkovChain<Num>&); \
+    template vector<array<Num, 3>> solve_absorption_exact<Num>(const MarkovChain<Num>&, ChainSolveStats*); \
+    template ChainCheck compare_chain_with_tables<Num>(const MarkovChain<Num>&, const vector<array<Num, 3>>&, \
+                                                       const GameRules&, const DpTables<Num>&, \
+                                                       const PolicySet<Num>&, double);
+
+PIR_INSTANTIATE_MARKOV_CHAIN(Fraction)
+PIR_INSTANTIATE_MARKOV_CHAIN(double)
@@ -0,0 +1,115 @@
+#ifndef MARKOV_CHAIN_H
+#define MARKOV_CHAIN_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dp_solver.h"
+
+
+// --- Markov chain engine ---
+// The game compiled into an absorbing Markov chain: every point where the wheel is spun or someone decides is a
+// transient state, "player k wins" are the three absorbing states, and the policies' spin probabilities are folded
+// into the transitions. Win probabilities are then absorption probabilities, which also exist when the game graph
+// has cycles -- something backward induction (initialize_dp_tables) can't handle. In the standard game the cycles
+// are the tie spin-offs, which the chain plays out (the tied players spin once each, a tie for the highest spin
+// goes again) instead of assuming them uniform; by symmetry that gives the same 1/n, so on these rules the chain
+// must agree with the DP tables exactly.
+//
+// States, with ids in this order:
+//   before player 1's first spin; player 1 after a spin (total, spins taken so far);
+//   before player 2's first spin (p1); player 2 after a spin (p1, total, spins);
+//   before player 3's first spin (p1, p2); player 3 after a spin (p1, p2, total, spins);
+//   the spin-offs (which players tie).
+// A bust ends the turn at once, so only totals 1..segments have after-spin states.
+template <class Num>
+struct MarkovChain {
+    int segments = 0;
+    int spins_per_turn = 0;
+
+    // Transitions between transient states as compressed rows: state s goes to column[i] with probability[i]
+    // for i in row_start[s] .. row_start[s + 1] - 1
+    std::vector<size_t> row_start;
+    std::vector<uint32_t> column;
+    std::vector<Num> probability;
+    std::vector<std::array<Num, 3>> absorption; // per state: probability of "player k wins" next
+
+    size_t states() const { return row_start.empty() ? 0 : row_start.size() - 1; }
+    size_t transitions() const { return column.size(); }
+
+    // -- State ids --
+    size_t first_player_start() const { return 0; }
+    size_t first_player_state(int total, int spins) const { return 1 + turn_index(total, spins); }
+    size_t second_player_start(int p1) const { return second_start_offset() + p1; }
+    size_t second_player_state(int p1, int total, int spins) const {
+        return second_state_offset() + (size_t)p1 * turn_states() + turn_index(total, spins);
+    }
+    size_t third_player_start(int p1, int p2) const { return third_start_offset() + (size_t)p1 * scores() + p2; }
+    size_t third_player_state(int p1, int p2, int total, int spins) const {
+        return third_state_offset() + ((size_t)p1 * scores() + p2) * turn_states() + turn_index(total, spins);
+    }
+    // tied: bit k set when player k + 1 ties for the highest total (at least two bits)
+    size_t spin_off_state(int tied) const { return spin_off_offset() + (tied == 7 ? 3 : tied / 2 - 1); }
+    size_t state_count() const { return spin_off_offset() + 4; }
+
+    // "player 3 p1=12 p2=0 total=14 spins=1", "spin-off 1+3", ...
+    std::string describe_state(size_t state) const;
+
+private:
+    int scores() const { return segments + 1; }
+    size_t turn_states() const { return (size_t)segments * spins_per_turn; }
+    size_t turn_index(int total, int spins) const { return (size_t)(total - 1) * spins_per_turn + spins - 1; }
+    size_t second_start_offset() const { return 1 + turn_states(); }
+    size_t second_state_offset() const { return second_start_offset() + scores(); }
+    size_t third_start_offset() const { return second_state_offset() + scores() * turn_states(); }
+    size_t third_state_offset() const { return third_start_offset() + (size_t)scores() * scores(); }
+    size_t spin_off_offset() const { return third_state_offset() + (size_t)scores() * scores() * turn_states(); }
+};
+
+// The chain of a solve: the policies decide with the solved tables (as in the simulator)
+template <class Num>
+MarkovChain<Num> build_markov_chain(const GameRules& rules, const DpTables<Num>& tables,
+                                    const PolicySet<Num>& policies);
+
+// -- Solvers --
+// Both return every state's absorption probabilities (the win probabilities of the three players from there).
+struct ChainSolveStats {
+    size_t components = 0;        // strongly connected components of the transition graph
+    size_t cyclic_components = 0; // ...with a cycle (more than one state, or a state that can return to itself)
+    size_t largest_component = 0;
+    int sweeps = 0;               // Gauss-Seidel sweeps
+    double residual = 0;          // largest |x - (R + Q x)| of the result (Gauss-Seidel)
+};
+
+// Strongly connected components (Tarjan), in reverse topological order: each comes after every component it leads to
+template <class Num>
+std::vector<std::vector<uint32_t>> strongly_connected_components(const MarkovChain<Num>& chain);
+
+// Exact sparse solve: the components in reverse topological order (block triangular form), each by Gaussian
+// elimination of its own states with the values it leads to already known. Loop-free parts cost one pass over
+// their transitions and nothing fills in outside the cyclic components. Exact with Fraction.
+template <class Num>
+std::vector<std::array<Num, 3>> solve_absorption_exact(const MarkovChain<Num>& chain, ChainSolveStats* stats = nullptr);
+
+// Gauss-Seidel: sweeps x = R + Q x in place, in the components' order (so a loop-free chain settles in one sweep),
+// until no value moves by more than tolerance or after max_sweeps
+std::vector<std::array<double, 3>> solve_absorption_gauss_seidel(const MarkovChain<double>& chain, double tolerance,
+                                                                 int max_sweeps, ChainSolveStats* stats = nullptr);
+
+// -- Cross-check against the DP tables --
+// The chain's values before each player's first spin (the policy tables) and after it (policy_state_probability)
+struct ChainCheck {
+    long long states = 0;     // states compared (three values each)
+    long long mismatches = 0; // states that differ (by more than tolerance)
+    double max_difference = 0;
+    std::string worst_state;
+};
+
+template <class Num>
+ChainCheck compare_chain_with_tables(const MarkovChain<Num>& chain, const std::vector<std::array<Num, 3>>& values,
+                                     const GameRules& rules, const DpTables<Num>& tables,
+                                     const PolicySet<Num>& policies, double tolerance = 0);
+
+#endif // MARKOV_CHAIN_H
@@ -0,0 +1,99 @@
+#include "modular.h"
+#include <stdexcept>
+using namespace std;
+
+[[gnu::tls_model("initial-exec")]] thread_local const ModularField* ModularField::active = nullptr;
+
+namespace {
+
+const size_t small_inverse_count = 4096; // ratio() denominators are small: segments, 2 * segments, 3 * segments
+
+uint64_t multiply_mod(uint64_t a, uint64_t b, uint64_t m) { return (uint64_t)((unsigned __int128)a * b % m); }
+
+uint64_t power_mod(uint64_t base, uint64_t exponent, uint64_t m) {
+    uint64_t result = 1 % m;
+    base %= m;
+    for (; exponent; exponent >>= 1) {
+        if (exponent & 1)
+            result = multiply_mod(result, base, m);
+        base = multiply_mod(base, base, m);
+    }
+    return result;
+}
+
+// Deterministic for all 64 bit n with these bases
+bool is_prime(uint64_t n) {
+    if (n < 2)
+        return false;
+    static const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    for (uint64_t base : bases)
+        if (n % base == 0)
+            return n == base;
+    uint64_t odd = n - 1;
+    int twos = 0;
+    for (; odd % 2 == 0; odd /= 2)
+        twos++;
+    for (uint64_t base : bases) {
+        uint64_t x = power_mod(base, odd, n);
+        if (x == 1 || x == n - 1)
+            continue;
+        bool composite = true;
+        for (int i = 1; i < twos && composite; i++) {
+            x = multiply_mod(x, x, n);
+            composite = (x != n - 1);
+        }
+        if (composite)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+ModularField::ModularField(uint64_t prime) : p(prime) {
+    if (prime < 3 || prime >= (1ull << 62) || prime % 2 == 0)
+        throw invalid_argument("ModularField needs an odd prime below 2^62");
+    if (active)
+        throw logic_error("ModularField: this thread already has a field");
+    // Newton's iteration for p^-1 mod 2^64 (p odd), 6 doublings of the correct low bits
+    uint64_t inverse = p;
+    for (int i = 0; i < 6; i++)
+        inverse *= 2 - p * inverse;
+    p_neg_inverse = 0 - inverse;
+    uint64_t r = (uint64_t)(((unsigned __int128)1 << 64) % p);
+    r2 = (uint64_t)((unsigned __int128)r * r % p);
+
+    // i^-1 = -(p / i) * (p mod i)^-1 (mod p), then into Montgomery form
+    vector<uint64_t> inverses(small_inverse_count, 0);
+    inverses[1] = 1;
+    for (size_t i = 2; i < small_inverse_count; i++)
+        inverses[i] = p - multiply_mod(p / i, inverses[p % i], p);
+    small_inverses.resize(small_inverse_count);
+    for (size_t i = 1; i < small_inverse_count; i++)
+        small_inverses[i] = to_montgomery(inverses[i]);
+    active = this;
+}
+
+ModularField::~ModularField() {
+    active = nullptr;
+}
+
+uint64_t ModularField::large_inverse(uint64_t x) const {
+    x %= p;
+    if (x == 0)
+        throw domain_error("ModNum: division by a multiple of the prime");
+    return to_montgomery(power_mod(x, p - 2, p)); // Fermat
+}
+
+uint64_t inverse_mod_prime(uint64_t x, uint64_t prime) {
+    return power_mod(x, prime - 2, prime);
+}
+
+vector<uint64_t> modular_primes(int count) {
+    vector<uint64_t> primes;
+    for (uint64_t candidate = (1ull << 62) - 1; (int)primes.size() < count; candidate -= 2)
+        if (is_prime(candidate))
+            primes.push_back(candidate);
+    return primes;
+}
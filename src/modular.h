@@ -0,0 +1,107 @@
+#ifndef MODULAR_H
+#define MODULAR_H
+
+#include <cstdint>
+#include <vector>
+#include "numeric.h"
+
+
+// --- Modular numbers ---
+// Residues modulo a prime p < 2^62, kept in Montgomery form (x * 2^64 mod p) so that a product is two
+// multiplications and a conditional subtraction: no division and no gcd. The prime is per thread -- every
+// ModNum a thread creates or combines belongs to the ModularField it has in scope -- so the templated solver
+// runs unchanged over ModNum, one thread per prime.
+class ModularField {
+public:
+    explicit ModularField(uint64_t prime); // makes this the thread's field until destroyed (not nestable)
+    ~ModularField();
+    ModularField(const ModularField&) = delete;
+    ModularField& operator=(const ModularField&) = delete;
+
+    static const ModularField& current() { return *active; }
+
+    uint64_t prime() const { return p; }
+    uint64_t reduce(unsigned __int128 t) const { // t * 2^-64 mod p, for t < p * 2^64
+        uint64_t m = (uint64_t)t * p_neg_inverse;
+        uint64_t u = (uint64_t)((t + (unsigned __int128)m * p) >> 64);
+        return u >= p ? u - p : u;
+    }
+    uint64_t to_montgomery(uint64_t x) const { return reduce((unsigned __int128)(x < p ? x : x % p) * r2); }
+    uint64_t from_montgomery(uint64_t x) const { return reduce(x); }
+    // of a value in normal form, as Montgomery form (x != 0 mod p)
+    uint64_t inverse(uint64_t x) const {
+        return (x > 0 && x < small_inverses.size()) ? small_inverses[x] : large_inverse(x);
+    }
+
+private:
+    uint64_t p;
+    uint64_t p_neg_inverse; // -p^-1 mod 2^64
+    uint64_t r2;            // 2^128 mod p
+    std::vector<uint64_t> small_inverses; // Montgomery form inverses of 1..small_inverses.size()-1 (ratio())
+    uint64_t large_inverse(uint64_t x) const;
+    // initial-exec: every ModNum operation reads it, and the general dynamic model (PIC code) makes that a call
+    [[gnu::tls_model("initial-exec")]] static thread_local const ModularField* active;
+};
+
+class ModNum {
+public:
+    ModNum() = default; // 0
+
+    // from / to a residue in normal form (0..p-1)
+    static ModNum from_residue(uint64_t residue) { return ModNum(ModularField::current().to_montgomery(residue)); }
+    uint64_t residue() const { return ModularField::current().from_montgomery(value); }
+
+    friend ModNum operator+(ModNum a, ModNum b) {
+        const uint64_t p = ModularField::current().prime();
+        uint64_t sum = a.value + b.value;
+        return ModNum(sum >= p ? sum - p : sum);
+    }
+    friend ModNum operator-(ModNum a, ModNum b) {
+        return ModNum(a.value >= b.value ? a.value - b.value : a.value + ModularField::current().prime() - b.value);
+    }
+    friend ModNum operator*(ModNum a, ModNum b) {
+        return ModNum(ModularField::current().reduce((unsigned __int128)a.value * b.value));
+    }
+    ModNum& operator+=(ModNum other) { return *this = *this + other; }
+    ModNum& operator-=(ModNum other) { return *this = *this - other; }
+    ModNum& operator*=(ModNum other) { return *this = *this * other; }
+    friend bool operator==(ModNum a, ModNum b) = default;
+    // (no ordering: residues can only be compared for equality)
+
+private:
+    explicit ModNum(uint64_t montgomery) : value(montgomery) {}
+    uint64_t value = 0;
+
+    friend struct NumericTraits<ModNum>;
+};
+
+template <>
+struct NumericTraits<ModNum> {
+    static constexpr NumericKind kind = NumericKind::modular;
+    static constexpr const char* name = "modular";
+    static ModNum ratio(long long num, long long denom) {
+        const ModularField& field = ModularField::current();
+        const uint64_t p = field.prime();
+        if (denom < 0) {
+            num = -num;
+            denom = -denom;
+        }
+        uint64_t magnitude = num < 0 ? 0ull - (uint64_t)num : (uint64_t)num;
+        if (magnitude >= p)
+            magnitude %= p;
+        const uint64_t numerator = (num < 0 && magnitude) ? p - magnitude : magnitude;
+        if (denom == 1) // the solver's constants and fixed decisions
+            return ModNum(field.to_montgomery(numerator));
+        return ModNum(field.reduce((unsigned __int128)field.to_montgomery(numerator) * field.inverse((uint64_t)denom)));
+    }
+    static double to_double(ModNum) { return 0; } // meaningless for residues
+    static bool is_one(ModNum value) { return value == ratio(1, 1); }
+};
+
+// x^-1 mod prime (normal form, x != 0 mod prime)
+uint64_t inverse_mod_prime(uint64_t x, uint64_t prime);
+
+// The largest primes below 2^62, from the top (deterministic Miller-Rabin)
+std::vector<uint64_t> modular_primes(int count);
+
+#endif // MODULAR_H
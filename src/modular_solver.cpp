@@ -0,0 +1,263 @@
+#include "modular_solver.h"
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "dp_solver.h"
+#include "instrumentation.h"
+#include "modular.h"
+#include "policies.h"
+#include "thread_pool.h"
+using namespace std;
+
+double BigRational::value() const {
+    if (numerator.fits_long_long() && denominator.fits_long_long())
+        return (double)numerator.to_long_long() / (double)denominator.to_long_long();
+    return stod(numerator.to_string()) / stod(denominator.to_string());
+}
+
+bool reconstruct_rational(const BigInt& residue, const BigInt& modulus, BigRational& result) {
+    // Extended Euclid on (modulus, residue), stopped at the first remainder with 2 r^2 < modulus (Wang's method)
+    BigInt r0 = modulus, r1 = residue, t0 = 0, t1 = 1;
+    while (!r1.is_zero() && BigInt(2) * r1 * r1 >= modulus) {
+        BigInt q = r0 / r1;
+        BigInt r2 = r0 - q * r1, t2 = t0 - q * t1;
+        r0 = std::move(r1);
+        r1 = std::move(r2);
+        t0 = std::move(t1);
+        t1 = std::move(t2);
+    }
+    if (t1.is_zero() || BigInt(2) * t1 * t1 >= modulus || BigInt::gcd(r1, t1) != BigInt(1))
+        return false;
+    if (t1.sign() < 0) {
+        r1 = -r1;
+        t1 = -t1;
+    }
+    result = {r1, t1};
+    return true;
+}
+
+namespace {
+
+// Spin-again decisions (0 / 1) of every state, fixed by the floating solve
+struct Decisions {
+    int scores = 0;
+    vector<uint8_t> third;  // [spins - 1][p1][p2][spin]
+    vector<uint8_t> second; // [spins - 1][p1][spin]
+    vector<uint8_t> first;  // [spins - 1][spin]
+
+    uint8_t& at(int player, int p1, int p2, int spin, int spins) {
+        return (player == 3) ? third[index(player, p1, p2, spin, spins)]
+               : (player == 2) ? second[index(player, p1, p2, spin, spins)] : first[index(player, p1, p2, spin, spins)];
+    }
+    uint8_t at(int player, int p1, int p2, int spin, int spins) const {
+        return (player == 3) ? third[index(player, p1, p2, spin, spins)]
+               : (player == 2) ? second[index(player, p1, p2, spin, spins)] : first[index(player, p1, p2, spin, spins)];
+    }
+
+private:
+    size_t index(int player, int p1, int p2, int spin, int spins) const {
+        const size_t s = scores, before = spins - 1;
+        return (player == 3) ? ((before * s + p1) * s + p2) * s + spin
+               : (player == 2) ? (before * s + p1) * s + spin : before * s + spin;
+    }
+};
+
+// A decision the floating values can't be trusted on: its two options are too close
+struct NearTie {
+    int player, p1, p2, spin, spins;
+};
+
+Decisions floating_decisions(const GameRules& rules, const string& policy_name, double tolerance,
+                             vector<NearTie>& near_ties, long long& count) {
+    PIR_SCOPED_TIMER("modular_floating_decisions");
+    if (policy_needs_floating(policy_name))
+        throw invalid_argument("The modular solve needs rational decisions (optimal or threshold-K), not " + policy_name);
+    const PolicySet<double> policies = policies_by_name<double>(policy_name, rules);
+    const DpTables<double> tables = initialize_dp_tables(rules, policies);
+    const bool compares_options = (policy_name == "optimal"); // the other policies decide by the state alone
+
+    const int segments = rules.segments, scores = rules.scores(), choices = rules.spins_per_turn - 1;
+    Decisions decisions;
+    decisions.scores = scores;
+    decisions.third.assign((size_t)choices * scores * scores * scores, 0);
+    decisions.second.assign((size_t)choices * scores * scores, 0);
+    decisions.first.assign((size_t)choices * scores, 0);
+    for (int spins = 1; spins <= choices; spins++)
+        for (int player = 1; player <= 3; player++)
+            for (int p1 = 0; p1 <= (player >= 2 ? segments : 0); p1++)
+                for (int p2 = 0; p2 <= (player == 3 ? segments : 0); p2++)
+                    for (int spin = 1; spin < segments; spin++) { // no decision on the top score
+                        double probability = (player == 1) ? policies.first_player(tables, spin, spins)
+                                             : (player == 2) ? policies.second_player(tables, p1, spin, spins)
+                                             : policies.third_player(tables, p1, p2, spin, spins);
+                        if (probability != 0 && probability != 1)
+                            throw invalid_argument("The modular solve needs decisions of 0 or 1 (policy " + policy_name + ")");
+                        decisions.at(player, p1, p2, spin, spins) = (uint8_t)probability;
+                        count++;
+                        if (!compares_options)
+                            continue;
+                        auto option = [&](int again) {
+                            return (player == 1) ? tables.first_player_probability(spin, again, 0)
+                                   : (player == 2) ? tables.second_player_probability(p1, spin, again, 1)
+                                   : tables.third_player_probability(p1, p2, spin, again, 2);
+                        };
+                        if (fabs(option(spins) - option(0)) < tolerance)
+                            near_ties.push_back({player, p1, p2, spin, spins});
+                    }
+    return decisions;
+}
+
+// Residues modulo prime of the values to reconstruct: the three win probabilities, then every near tie's
+// (spin again - stay) difference in the deciding player's win probability
+vector<uint64_t> solve_residues(const GameRules& rules, shared_ptr<const Decisions> decisions,
+                                const vector<NearTie>& near_ties, uint64_t prime) {
+    PIR_SCOPED_TIMER("modular_solve_residues");
+    ModularField field(prime);
+    using Traits = NumericTraits<ModNum>;
+    auto decision = [](uint8_t spin_again) { return Traits::ratio(spin_again, 1); };
+    PolicySet<ModNum> policies{
+        "fixed",
+        [decisions, decision](const DpTables<ModNum>&, int p1, int p2, int spin, int spins) {
+            return decision(decisions->at(3, p1, p2, spin, spins));
+        },
+        [decisions, decision](const DpTables<ModNum>&, int p1, int spin, int spins) {
+            return decision(decisions->at(2, p1, 0, spin, spins));
+        },
+        [decisions, decision](const DpTables<ModNum>&, int spin, int spins) {
+            return decision(decisions->at(1, 0, 0, spin, spins));
+        },
+        nullptr,
+    };
+    DpTables<ModNum> tables = initialize_dp_tables(rules, policies);
+
+    vector<uint64_t> residues;
+    for (int player = 0; player < 3; player++)
+        residues.push_back(tables.first_player_policy_probability(player).residue());
+    for (const NearTie& tie : near_ties) {
+        auto option = [&](int again) {
+            return (tie.player == 1) ? tables.first_player_probability(tie.spin, again, 0)
+                   : (tie.player == 2) ? tables.second_player_probability(tie.p1, tie.spin, again, 1)
+                   : tables.third_player_probability(tie.p1, tie.p2, tie.spin, again, 2);
+        };
+        residues.push_back((option(tie.spins) - option(0)).residue());
+    }
+    return residues;
+}
+
+// Chinese remainder theorem: the x in [0, product of primes) with x = residues[i] (mod primes[i])
+BigInt combine_residues(const vector<vector<uint64_t>>& residues, const vector<uint64_t>& primes, int count,
+                        size_t value, BigInt& modulus) {
+    BigInt x = (long long)residues[0][value];
+    modulus = (long long)primes[0];
+    for (int i = 1; i < count; i++) {
+        const uint64_t p = primes[i];
+        uint64_t x_mod_p = (uint64_t)(x % BigInt((long long)p)).to_long_long();
+        uint64_t m_mod_p = (uint64_t)(modulus % BigInt((long long)p)).to_long_long();
+        uint64_t difference = (residues[i][value] + p - x_mod_p) % p;
+        uint64_t t = (uint64_t)((unsigned __int128)difference * inverse_mod_prime(m_mod_p, p) % p);
+        x = x + modulus * BigInt((long long)t);
+        modulus = modulus * BigInt((long long)p);
+    }
+    return x;
+}
+
+// value mod prime, for a rational with a denominator prime to it
+uint64_t rational_mod(const BigRational& value, uint64_t prime) {
+    BigInt p = (long long)prime;
+    BigInt numerator = value.numerator % p;
+    if (numerator.sign() < 0)
+        numerator = numerator + p;
+    uint64_t denominator = (uint64_t)(value.denominator % p).to_long_long();
+    if (denominator == 0)
+        return UINT64_MAX; // can't be checked with this prime: treat as a mismatch
+    return (uint64_t)((unsigned __int128)(uint64_t)numerator.to_long_long() * inverse_mod_prime(denominator, prime)
+                      % prime);
+}
+
+BigRational from_fraction(const Fraction& value) {
+    return {BigInt(value.getNumerator()), BigInt(value.getDenominator())};
+}
+
+} // namespace
+
+ModularSolveResult solve_exact_modular(const GameRules& rules, const string& policy_name,
+                                       const ModularSolveOptions& options)
+{
+    PIR_SCOPED_TIMER("solve_exact_modular");
+    if (!rules.uniform_wheel())
+        throw invalid_argument("The modular solve needs the uniform wheel");
+    ModularSolveResult result;
+    vector<NearTie> near_ties;
+    auto decisions = make_shared<Decisions>(
+        floating_decisions(rules, policy_name, options.decision_tolerance, near_ties, result.decisions));
+    result.near_ties = (long long)near_ties.size();
+
+    const vector<uint64_t> primes = modular_primes(options.max_primes + 1);
+    vector<vector<uint64_t>> residues; // per prime, with the current decisions
+    int used = max(1, min(options.initial_primes, options.max_primes));
+    while (result.rounds < options.max_rounds) {
+        result.rounds++;
+
+        // Residues of the primes not run yet (the reconstruction primes and one check prime), in parallel
+        const size_t have = residues.size(), needed = (size_t)used + 1;
+        residues.resize(needed);
+        shared_ptr<const Decisions> fixed = decisions;
+        atomic<size_t> next{have};
+        TaskGroup workers;
+        for (int t = 0; t < max(1, options.threads) && have + t < needed; t++)
+            workers.run([&]() {
+                for (size_t i; (i = next++) < needed;)
+                    residues[i] = solve_residues(rules, fixed, near_ties, primes[i]);
+            });
+        workers.wait();
+
+        // Reconstruct every value and check it against the extra prime
+        vector<BigRational> values(3 + near_ties.size());
+        bool verified = true;
+        for (size_t j = 0; j < values.size() && verified; j++) {
+            BigInt modulus;
+            BigInt x = combine_residues(residues, primes, used, j, modulus);
+            verified = reconstruct_rational(x, modulus, values[j]) && rational_mod(values[j], primes[used]) == residues[used][j];
+        }
+        if (!verified) { // more primes
+            if (used == options.max_primes)
+                break;
+            used = min(2 * used, options.max_primes);
+            continue;
+        }
+
+        // The exact sign of every near tie must match its decision (an exact tie stays, like the optimal policy)
+        long long flipped = 0;
+        for (size_t k = 0; k < near_ties.size(); k++) {
+            const NearTie& tie = near_ties[k];
+            uint8_t exact_decision = values[3 + k].numerator.sign() > 0;
+            uint8_t& decision = decisions->at(tie.player, tie.p1, tie.p2, tie.spin, tie.spins);
+            if (decision != exact_decision) {
+                decision = exact_decision;
+                flipped++;
+            }
+        }
+        if (flipped) { // the residues are stale
+            result.flipped += flipped;
+            residues.clear();
+            continue;
+        }
+
+        for (int player = 0; player < 3; player++)
+            result.win_probability[player] = values[player];
+        result.primes = used;
+        return result;
+    }
+
+    // -- Fallback: the Fraction solver --
+    PIR_COUNT(modular_fallbacks);
+    const PolicySet<Fraction> policies = policies_by_name<Fraction>(policy_name, rules);
+    const DpTables<Fraction> tables = initialize_dp_tables(rules, policies);
+    for (int player = 0; player < 3; player++)
+        result.win_probability[player] = from_fraction(tables.first_player_policy_probability(player));
+    result.fell_back = true;
+    return result;
+}
@@ -0,0 +1,55 @@
+#ifndef MODULAR_SOLVER_H
+#define MODULAR_SOLVER_H
+
+#include <array>
+#include <string>
+#include "big_int.h"
+#include "game_rules.h"
+
+
+// --- Multi-modular exact solve ---
+// Exact win probabilities without Fraction arithmetic:
+//   1. a floating solve fixes every spin-again decision; decisions of the optimal policy whose two options are
+//      within decision_tolerance of each other are "near ties" that the floating values can't be trusted on
+//   2. the whole backward induction runs over ModNum (modular.h) modulo several 62-bit primes, one thread per
+//      prime, with the decisions fixed
+//   3. the final probabilities (and the near ties' option differences) are rebuilt from their residues by the
+//      Chinese remainder theorem and rational reconstruction, and checked against one more prime
+//   4. a near tie whose exact difference disagrees with the floating decision is flipped and the residues are
+//      recomputed; results that don't verify get more primes
+// When that doesn't settle (max_rounds, max_primes), the solve falls back to the Fraction solver.
+// Policies: optimal and threshold-K (their decisions are 0 or 1); qre is not rational.
+struct BigRational {
+    BigInt numerator;
+    BigInt denominator; // positive
+
+    std::string to_string() const { return numerator.to_string() + "/" + denominator.to_string(); }
+    double value() const;
+};
+
+struct ModularSolveOptions {
+    int threads = 1;                 // residue solves at once (tasks on the shared thread pool)
+    int initial_primes = 2;          // reconstruction primes of the first round (plus one check prime)
+    int max_primes = 48;
+    int max_rounds = 8;
+    double decision_tolerance = 1e-9;
+};
+
+struct ModularSolveResult {
+    std::array<BigRational, 3> win_probability;
+    int primes = 0;             // reconstruction primes of the final round
+    int rounds = 0;             // modular passes (a pass runs every prime not yet run with the current decisions)
+    long long decisions = 0;    // spin-again decisions fixed by the floating solve
+    long long near_ties = 0;    // decisions checked exactly
+    long long flipped = 0;      // near ties the floating solve got wrong
+    bool fell_back = false;     // answered by the Fraction solver
+};
+
+ModularSolveResult solve_exact_modular(const GameRules& rules, const std::string& policy_name,
+                                       const ModularSolveOptions& options = {});
+
+// Rational reconstruction: the fraction a / b with |a|, b <= sqrt(modulus / 2) and a = b * residue (mod modulus),
+// if there is one
+bool reconstruct_rational(const BigInt& residue, const BigInt& modulus, BigRational& result);
+
+#endif // MODULAR_SOLVER_H
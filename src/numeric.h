@@ -0,0 +1,39 @@
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+#include <cmath>
+#include "fraction.h"
+
+
+// --- Numeric types ---
+// The solver and simulator are templates over the number type of the tables:
+//   Fraction: exact (the default, fine for the standard 20 segment wheel)
+//   double:   fast and approximate (large wheels, non-rational policies like QRE)
+//   ModNum:   residues modulo a prime, for the multi-modular exact solve (modular.h, modular_solver.h)
+//   Dual:     doubles carrying their gradient with respect to the segment probabilities (dual.h)
+// NumericTraits<Num> has everything the templates need that the two types don't share.
+enum class NumericKind : int { exact = 0, floating = 1, modular = 2, dual = 3 };
+
+template <class Num>
+struct NumericTraits;
+
+template <>
+struct NumericTraits<Fraction> {
+    static constexpr NumericKind kind = NumericKind::exact;
+    static constexpr const char* name = "exact";
+    static Fraction ratio(long long num, long long denom) { return Fraction(num, denom); }
+    static double to_double(const Fraction& value) { return (double)value.value(); }
+    // true if value is (for this type) equal to one -- used by the probabilities-sum-to-1 checks
+    static bool is_one(const Fraction& value) { return value == Fraction(1, 1); }
+};
+
+template <>
+struct NumericTraits<double> {
+    static constexpr NumericKind kind = NumericKind::floating;
+    static constexpr const char* name = "floating";
+    static double ratio(long long num, long long denom) { return (double)num / (double)denom; }
+    static double to_double(double value) { return value; }
+    static bool is_one(double value) { return std::abs(value - 1.0) < 1e-9; }
+};
+
+#endif // NUMERIC_H
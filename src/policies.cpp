@@ -0,0 +1,116 @@
+#include "policies.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include "dual.h"
+#include "policy_language.h"
+#include "report.h"
+using namespace std;
+
+namespace {
+
+template <class Num>
+Num spin_if(bool spin) { return NumericTraits<Num>::ratio(spin ? 1 : 0, 1); }
+
+double logit_choice(double lambda, double win_if_spin, double win_if_stay) {
+    return 1.0 / (1.0 + exp(-lambda * (win_if_spin - win_if_stay)));
+}
+
+// "prefix-VALUE" -> VALUE (empty if name doesn't start with prefix-)
+string parameter_of(const string& name, const string& prefix) {
+    if (name.size() <= prefix.size() + 1 || name.compare(0, prefix.size() + 1, prefix + "-") != 0)
+        return "";
+    return name.substr(prefix.size() + 1);
+}
+
+// text as a number, if all of it is one
+template <class T>
+optional<T> parse_number(const string& text) {
+    T value{};
+    auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc() || end != text.data() + text.size())
+        return nullopt;
+    return value;
+}
+
+} // namespace
+
+
+template <class Num>
+PolicySet<Num> threshold_policies(int k) {
+    const ThresholdPolicies<Num> compiled{k};
+    return {
+        "threshold-" + to_string(k),
+        [compiled](const DpTables<Num>& tables, int p1, int p2, int spin, int spins) {
+            return spin_if<Num>(compiled.third_player(tables, p1, p2, spin, spins));
+        },
+        [compiled](const DpTables<Num>& tables, int p1, int spin, int spins) {
+            return spin_if<Num>(compiled.second_player(tables, p1, spin, spins));
+        },
+        [compiled](const DpTables<Num>& tables, int spin, int spins) {
+            return spin_if<Num>(compiled.first_player(tables, spin, spins));
+        },
+        [compiled](DpTables<Num>& tables, const GameRules& rules) { solve_dp_tables(tables, rules, compiled); },
+    };
+}
+
+PolicySet<double> qre_policies(double lambda) {
+    return {
+        "qre-" + format_number(lambda),
+        [lambda](const DpTables<double>& tables, int p1, int p2, int spin, int spins) {
+            return logit_choice(lambda, tables.third_player_probability(p1, p2, spin, spins, 2),
+                                tables.third_player_probability(p1, p2, spin, 0, 2));
+        },
+        [lambda](const DpTables<double>& tables, int p1, int spin, int spins) {
+            return logit_choice(lambda, tables.second_player_probability(p1, spin, spins, 1),
+                                tables.second_player_probability(p1, spin, 0, 1));
+        },
+        [lambda](const DpTables<double>& tables, int spin, int spins) {
+            return logit_choice(lambda, tables.first_player_probability(spin, spins, 0),
+                                tables.first_player_probability(spin, 0, 0));
+        },
+        nullptr,
+    };
+}
+
+bool policy_needs_floating(const string& name) {
+    return !parameter_of(name, "qre").empty();
+}
+
+template <class Num>
+PolicySet<Num> policies_by_name(const string& name, const GameRules& rules) {
+    if (name == "optimal")
+        return optimal_policies<Num>();
+    if (optional<int> k = parse_number<int>(parameter_of(name, "threshold")))
+        return threshold_policies<Num>(*k);
+    if (optional<double> lambda = parse_number<double>(parameter_of(name, "qre"))) {
+        if constexpr (NumericTraits<Num>::kind == NumericKind::floating)
+            return qre_policies(*lambda);
+        else
+            throw invalid_argument("Policy " + name + " needs floating tables");
+    }
+    if (name.compare(0, 6, "rules:") == 0 && name.size() > 6) {
+        string path = name.substr(6); // a name this returned: drop its @HASH
+        if (size_t at = path.rfind('@'); at != string::npos && path.size() - at == 17
+                                         && path.find_first_not_of("0123456789abcdef", at + 1) == string::npos)
+            path.erase(at);
+        const PolicyTables tables = load_policy_rules(path, rules);
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)policy_tables_fingerprint(tables));
+        return table_policies<Num>(tables, "rules:" + path + "@" + hash);
+    }
+    throw invalid_argument("Unknown policy '" + name + "' (optimal, threshold-K, qre-LAMBDA or rules:PATH)");
+}
+
+
+// -- Instantiations --
+template PolicySet<Fraction> threshold_policies<Fraction>(int);
+template PolicySet<double> threshold_policies<double>(int);
+template PolicySet<Fraction> policies_by_name<Fraction>(const string&, const GameRules&);
+template PolicySet<double> policies_by_name<double>(const string&, const GameRules&);
+template PolicySet<Dual> threshold_policies<Dual>(int);
+template PolicySet<Dual> policies_by_name<Dual>(const string&, const GameRules&);
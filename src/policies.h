@@ -0,0 +1,42 @@
+#ifndef POLICIES_H
+#define POLICIES_H
+
+#include <algorithm>
+#include <string>
+#include "dp_solver.h"
+
+
+// --- Policy library ---
+// Policies besides the optimal ones (dp_solver.h), selectable by name on the command line:
+//   optimal       optimal_policies
+//   threshold-K   spin again when the total is below K (in wheel units, 13 = 65 cents); players 2 and 3
+//                 also always spin when they are behind the leader
+//   qre-LAMBDA    logit quantal response: spin with probability 1 / (1 + exp(-LAMBDA * (W_spin - W_stay))),
+//                 W = the player's own win probability after each choice. LAMBDA -> infinity gives optimal play.
+//                 Needs the floating tables (the probabilities are not rational).
+//   rules:PATH    a file of rules (policy_language.h), compiled for the rules of the solve
+template <class Num>
+PolicySet<Num> threshold_policies(int k);
+
+// threshold-K compiled (dp_solver.h): what threshold_policies solves with
+template <class Num>
+struct ThresholdPolicies {
+    using number_type = Num;
+    static constexpr bool deterministic = true;
+    int k = 0;
+    bool third_player(const DpTables<Num>&, int p1, int p2, int spin, int) const { return spin < k || spin < std::max(p1, p2); }
+    bool second_player(const DpTables<Num>&, int p1, int spin, int) const { return spin < k || spin < p1; }
+    bool first_player(const DpTables<Num>&, int spin, int) const { return spin < k; }
+};
+
+PolicySet<double> qre_policies(double lambda);
+
+// Policy set by name for a game with these rules (throws std::invalid_argument for unknown names or qre with exact
+// tables). rules:PATH sets are named rules:PATH@HASH, HASH from the compiled tables (so edits change table cache keys).
+template <class Num>
+PolicySet<Num> policies_by_name(const std::string& name, const GameRules& rules);
+
+// true if the policy set only works with floating tables
+bool policy_needs_floating(const std::string& name);
+
+#endif // POLICIES_H
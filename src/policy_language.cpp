@@ -0,0 +1,446 @@
+#include "policy_language.h"
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include "dual.h"
+using namespace std;
+
+namespace {
+
+// -- Rules --
+struct Operand {
+    enum Kind { total, best, p1, p2, spins, number } kind = number;
+    int value = 0; // number, in wheel units
+};
+
+struct Condition {
+    enum Kind { always, less, less_equal, greater, greater_equal, equal, not_equal, behind, tied, ahead,
+                negation, conjunction, disjunction } kind = always;
+    Operand left, right;         // comparisons
+    vector<Condition> children;  // negation (one), conjunction / disjunction
+};
+
+struct Rule {
+    Fraction spin_probability;
+    Condition condition;
+};
+
+// A decision state as the rules see it
+struct State {
+    int p1 = 0, p2 = 0, total = 0, spins = 1, best = 0;
+};
+
+int value_of(const Operand& operand, const State& state) {
+    switch (operand.kind) {
+    case Operand::total: return state.total;
+    case Operand::best: return state.best;
+    case Operand::p1: return state.p1;
+    case Operand::p2: return state.p2;
+    case Operand::spins: return state.spins;
+    default: return operand.value;
+    }
+}
+
+bool holds(const Condition& condition, const State& state) {
+    const int left = value_of(condition.left, state), right = value_of(condition.right, state);
+    switch (condition.kind) {
+    case Condition::always: return true;
+    case Condition::less: return left < right;
+    case Condition::less_equal: return left <= right;
+    case Condition::greater: return left > right;
+    case Condition::greater_equal: return left >= right;
+    case Condition::equal: return left == right;
+    case Condition::not_equal: return left != right;
+    case Condition::behind: return state.total < state.best;
+    case Condition::tied: return state.best > 0 && state.total == state.best;
+    case Condition::ahead: return state.total > state.best;
+    case Condition::negation: return !holds(condition.children[0], state);
+    case Condition::conjunction:
+        for (const Condition& child : condition.children)
+            if (!holds(child, state))
+                return false;
+        return true;
+    case Condition::disjunction:
+        for (const Condition& child : condition.children)
+            if (holds(child, state))
+                return true;
+        return false;
+    }
+    return false;
+}
+
+// -- Parser --
+// One line at a time: words, numbers (with a "c" or "%" suffix or a decimal point) and operators
+class LineParser {
+public:
+    LineParser(const string& line, int number, int segments) : line_number(number), segments(segments) {
+        for (size_t i = 0; i < line.size();) {
+            const char c = line[i];
+            if (isspace((unsigned char)c)) {
+                i++;
+            } else if (isalpha((unsigned char)c) || c == '_') {
+                size_t end = i;
+                while (end < line.size() && (isalnum((unsigned char)line[end]) || line[end] == '_'))
+                    end++;
+                tokens.push_back(line.substr(i, end - i));
+                i = end;
+            } else if (isdigit((unsigned char)c) || c == '.') {
+                size_t end = i;
+                while (end < line.size() && (isdigit((unsigned char)line[end]) || line[end] == '.'))
+                    end++;
+                if (end < line.size() && (line[end] == 'c' || line[end] == '%')
+                    && (end + 1 == line.size() || !isalnum((unsigned char)line[end + 1])))
+                    end++;
+                tokens.push_back(line.substr(i, end - i));
+                i = end;
+            } else if ((c == '<' || c == '>' || c == '=' || c == '!') && i + 1 < line.size() && line[i + 1] == '=') {
+                tokens.push_back(line.substr(i, 2));
+                i += 2;
+            } else if (c == '<' || c == '>' || c == '(' || c == ')' || c == ',' || c == ':' || c == '/') {
+                tokens.push_back(string(1, c));
+                i++;
+            } else {
+                fail(string("unexpected '") + c + "'");
+            }
+        }
+    }
+
+    bool done() const { return position == tokens.size(); }
+    const string& peek() const { static const string end; return done() ? end : tokens[position]; }
+    bool accept(const string& token) {
+        if (peek() != token)
+            return false;
+        position++;
+        return true;
+    }
+    void expect(const string& token) {
+        if (!accept(token))
+            fail("expected '" + token + "'" + (done() ? string(" at the end") : " before '" + peek() + "'"));
+    }
+    [[noreturn]] void fail(const string& message) const {
+        throw invalid_argument("line " + to_string(line_number) + ": " + message);
+    }
+
+    // "player 1:", "players 2, 3:" -> the players (0-2)
+    vector<int> section() {
+        vector<int> players;
+        do {
+            const string token = peek();
+            if (token != "1" && token != "2" && token != "3")
+                fail("expected a player number 1-3");
+            players.push_back(token[0] - '1');
+            position++;
+        } while (accept(","));
+        expect(":");
+        return players;
+    }
+
+    Rule rule() {
+        Rule rule;
+        const bool spin = accept("spin");
+        if (!spin && !accept("stay"))
+            fail("expected spin, stay or a player section");
+        Fraction probability(1);
+        if (accept("with"))
+            probability = this->probability();
+        rule.spin_probability = spin ? probability : Fraction(1) - probability;
+        if (accept("if"))
+            rule.condition = disjunction();
+        if (!done())
+            fail("unexpected '" + peek() + "'");
+        return rule;
+    }
+
+private:
+    vector<string> tokens;
+    size_t position = 0;
+    int line_number;
+    int segments; // cent values go up to the wheel's top segment
+
+    // 0.9, 90%, 1/3
+    Fraction probability() {
+        const string token = peek();
+        if (token.empty() || !(isdigit((unsigned char)token[0]) || token[0] == '.'))
+            fail("expected a probability");
+        position++;
+        const bool percent = token.back() == '%';
+        string text = token;
+        Fraction value = decimal(percent ? token.substr(0, token.size() - 1) : token);
+        if (percent)
+            value = value / Fraction(100);
+        else if (accept("/")) {
+            const string denominator_token = integer_token();
+            const Fraction denominator = decimal(denominator_token);
+            text += "/" + denominator_token;
+            if (denominator == Fraction(0))
+                fail("probability " + text + " is not between 0 and 1");
+            value = value / denominator;
+        }
+        if (value < Fraction(0) || Fraction(1) < value)
+            fail("probability " + text + " is not between 0 and 1");
+        return value;
+    }
+
+    string integer_token() {
+        const string token = peek();
+        if (token.empty() || !isdigit((unsigned char)token[0]))
+            fail("expected a number");
+        position++;
+        return token;
+    }
+
+    Fraction decimal(const string& text) {
+        const size_t point = text.find('.');
+        const string digits = (point == string::npos) ? text : text.substr(0, point) + text.substr(point + 1);
+        const size_t decimals = (point == string::npos) ? 0 : text.size() - point - 1;
+        if (digits.empty() || digits.size() > 15 || digits.find_first_not_of("0123456789") != string::npos)
+            fail("bad number '" + text + "'");
+        long long denominator = 1;
+        for (size_t i = 0; i < decimals; i++)
+            denominator *= 10;
+        return Fraction(stoll(digits), denominator);
+    }
+
+    Condition disjunction() {
+        Condition first = conjunction();
+        if (peek() != "or")
+            return first;
+        Condition any;
+        any.kind = Condition::disjunction;
+        any.children.push_back(std::move(first));
+        while (accept("or"))
+            any.children.push_back(conjunction());
+        return any;
+    }
+
+    Condition conjunction() {
+        Condition first = unary();
+        if (peek() != "and")
+            return first;
+        Condition all;
+        all.kind = Condition::conjunction;
+        all.children.push_back(std::move(first));
+        while (accept("and"))
+            all.children.push_back(unary());
+        return all;
+    }
+
+    Condition unary() {
+        Condition condition;
+        if (accept("not")) {
+            condition.kind = Condition::negation;
+            condition.children.push_back(unary());
+        } else if (accept("(")) {
+            condition = disjunction();
+            expect(")");
+        } else if (accept("behind")) {
+            condition.kind = Condition::behind;
+        } else if (accept("tied")) {
+            condition.kind = Condition::tied;
+        } else if (accept("ahead")) {
+            condition.kind = Condition::ahead;
+        } else {
+            condition.left = operand();
+            const string op = peek();
+            if (op == "<") condition.kind = Condition::less;
+            else if (op == "<=") condition.kind = Condition::less_equal;
+            else if (op == ">") condition.kind = Condition::greater;
+            else if (op == ">=") condition.kind = Condition::greater_equal;
+            else if (op == "==") condition.kind = Condition::equal;
+            else if (op == "!=") condition.kind = Condition::not_equal;
+            else fail("expected a comparison after the value");
+            position++;
+            condition.right = operand();
+        }
+        return condition;
+    }
+
+    Operand operand() {
+        const string token = peek();
+        Operand operand;
+        if (token == "total") operand.kind = Operand::total;
+        else if (token == "best") operand.kind = Operand::best;
+        else if (token == "p1") operand.kind = Operand::p1;
+        else if (token == "p2") operand.kind = Operand::p2;
+        else if (token == "spins") operand.kind = Operand::spins;
+        else if (!token.empty() && isdigit((unsigned char)token[0])) {
+            const bool cents = token.back() == 'c';
+            const string digits = cents ? token.substr(0, token.size() - 1) : token;
+            if (digits.find_first_not_of("0123456789") != string::npos || digits.size() > 9)
+                fail("expected a whole number, not '" + token + "'");
+            const int value = stoi(digits);
+            if (cents && value % 5 != 0)
+                fail(token + " is not a wheel value (5 cents a unit)");
+            if (cents && value > segments * 5)
+                fail(token + " is not a wheel value (the top segment is " + to_string(segments * 5) + "c)");
+            operand.value = cents ? value / 5 : value;
+        } else {
+            fail(token.empty() ? "expected a value at the end" : "unknown value '" + token + "'");
+        }
+        position++;
+        return operand;
+    }
+};
+
+// The rules of each player (the sections in the order they appear)
+array<vector<Rule>, 3> parse_rules(const string& text, int segments) {
+    array<vector<Rule>, 3> rules;
+    vector<int> players;
+    istringstream lines(text);
+    string line;
+    for (int number = 1; getline(lines, line); number++) {
+        if (size_t comment = line.find('#'); comment != string::npos)
+            line.erase(comment);
+        LineParser parser(line, number, segments);
+        if (parser.done())
+            continue;
+        if (parser.accept("player") || parser.accept("players")) {
+            players = parser.section();
+            if (!parser.done())
+                parser.fail("a section header ends with ':'");
+            continue;
+        }
+        if (players.empty())
+            parser.fail("rule before the first player section");
+        const Rule rule = parser.rule();
+        for (int player : players)
+            rules[player].push_back(rule);
+    }
+    return rules;
+}
+
+// The first matching rule's spin probability (stay if none)
+Fraction decide(const vector<Rule>& rules, const State& state) {
+    for (const Rule& rule : rules)
+        if (holds(rule.condition, state))
+            return rule.spin_probability;
+    return Fraction(0);
+}
+
+template <class Num>
+shared_ptr<const vector<Num>> converted(const vector<Fraction>& probabilities) {
+    auto values = make_shared<vector<Num>>();
+    values->reserve(probabilities.size());
+    for (const Fraction& probability : probabilities)
+        values->push_back(NumericTraits<Num>::ratio(probability.getNumerator(), probability.getDenominator()));
+    return values;
+}
+
+shared_ptr<const vector<uint8_t>> decisions(const vector<Fraction>& probabilities) {
+    auto values = make_shared<vector<uint8_t>>();
+    values->reserve(probabilities.size());
+    for (const Fraction& probability : probabilities)
+        values->push_back(probability.getNumerator() != 0);
+    return values;
+}
+
+} // namespace
+
+
+PolicyTables compile_policy_rules(const string& text, const GameRules& rules) {
+    const array<vector<Rule>, 3> players = parse_rules(text, rules.segments);
+    PolicyTables tables;
+    tables.segments = rules.segments;
+    tables.spins_per_turn = rules.spins_per_turn;
+    const size_t scores = rules.scores(), choices = rules.spins_per_turn - 1;
+    tables.third.resize(choices * scores * scores * scores);
+    tables.second.resize(choices * scores * scores);
+    tables.first.resize(choices * scores);
+
+    auto store = [&tables](Fraction& entry, const Fraction& probability) {
+        entry = probability;
+        tables.deterministic = tables.deterministic && (probability == Fraction(0) || probability == Fraction(1));
+    };
+    for (int spins = 1; spins <= (int)choices; spins++)
+        for (int total = 0; total <= rules.segments; total++) {
+            State state{0, 0, total, spins, 0};
+            store(tables.first[tables.first_index(total, spins)], decide(players[0], state));
+            for (int p1 = 0; p1 <= rules.segments; p1++) {
+                state = {p1, 0, total, spins, p1};
+                store(tables.second[tables.second_index(p1, total, spins)], decide(players[1], state));
+                for (int p2 = 0; p2 <= rules.segments; p2++) {
+                    state = {p1, p2, total, spins, max(p1, p2)};
+                    store(tables.third[tables.third_index(p1, p2, total, spins)], decide(players[2], state));
+                }
+            }
+        }
+    return tables;
+}
+
+PolicyTables load_policy_rules(const string& path, const GameRules& rules) {
+    ifstream file(path);
+    if (!file)
+        throw runtime_error("Can't read policy rules " + path);
+    ostringstream text;
+    text << file.rdbuf();
+    try {
+        return compile_policy_rules(text.str(), rules);
+    } catch (const invalid_argument& error) {
+        throw invalid_argument(path + " " + error.what());
+    }
+}
+
+uint64_t policy_tables_fingerprint(const PolicyTables& tables) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a over the shape and the probabilities
+    auto add = [&hash](long long value) {
+        for (int byte = 0; byte < 8; byte++) {
+            hash ^= (uint64_t)(value >> (8 * byte)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    add(tables.segments);
+    add(tables.spins_per_turn);
+    for (const vector<Fraction>* probabilities : {&tables.third, &tables.second, &tables.first})
+        for (const Fraction& probability : *probabilities) {
+            add(probability.getNumerator());
+            add(probability.getDenominator());
+        }
+    return hash;
+}
+
+template <class Num>
+PolicySet<Num> table_policies(const PolicyTables& tables, const string& name) {
+    auto layout = make_shared<const PolicyTables>(tables);
+    auto check_shape = [layout](const GameRules& rules) {
+        if (rules.segments != layout->segments || rules.spins_per_turn != layout->spins_per_turn)
+            throw invalid_argument("The policy tables were compiled for other rules");
+    };
+    const TablePolicies<Num> probabilities{layout, converted<Num>(tables.third), converted<Num>(tables.second),
+                                           converted<Num>(tables.first)};
+    function<void(DpTables<Num>&, const GameRules&)> compiled_solve;
+    if (tables.deterministic) {
+        const DecisionTablePolicies<Num> decided{layout, decisions(tables.third), decisions(tables.second),
+                                                 decisions(tables.first)};
+        compiled_solve = [decided, check_shape](DpTables<Num>& dp, const GameRules& rules) {
+            check_shape(rules);
+            solve_dp_tables(dp, rules, decided);
+        };
+    } else {
+        compiled_solve = [probabilities, check_shape](DpTables<Num>& dp, const GameRules& rules) {
+            check_shape(rules);
+            solve_dp_tables(dp, rules, probabilities);
+        };
+    }
+    return {
+        name,
+        [probabilities](const DpTables<Num>& dp, int p1, int p2, int spin, int spins) {
+            return probabilities.third_player(dp, p1, p2, spin, spins);
+        },
+        [probabilities](const DpTables<Num>& dp, int p1, int spin, int spins) {
+            return probabilities.second_player(dp, p1, spin, spins);
+        },
+        [probabilities](const DpTables<Num>& dp, int spin, int spins) {
+            return probabilities.first_player(dp, spin, spins);
+        },
+        compiled_solve,
+    };
+}
+
+
+// -- Instantiations --
+template PolicySet<Fraction> table_policies<Fraction>(const PolicyTables&, const string&);
+template PolicySet<double> table_policies<double>(const PolicyTables&, const string&);
+template PolicySet<Dual> table_policies<Dual>(const PolicyTables&, const string&);
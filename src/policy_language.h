@@ -0,0 +1,108 @@
+#ifndef POLICY_LANGUAGE_H
+#define POLICY_LANGUAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "dp_solver.h"
+#include "fraction.h"
+
+
+// --- Policy language ---
+// Policies written as rules instead of code, e.g. Simulation.py's contestant 2:
+//
+//   # spin on a tie below 50 cents, otherwise up to 55 cents
+//   player 2:
+//       spin if tied and total < 50c
+//       stay if tied
+//       spin if total <= 55c
+//       stay
+//   player 3:
+//       spin if behind
+//       stay with 90% if total == 70c
+//       spin if total <= 50c
+//
+// A file has a section per player ("player 1:" .. "player 3:"; "players 2, 3:" shares one). Within a section the
+// first rule that matches a state decides it, and a state no rule matches stays. A rule is an action with an
+// optional condition:
+//   spin | stay | spin with P | stay with P        P: 0.9, 90% or 1/3 (exact, so the tables stay rational)
+//   if COND                                        comparisons, flags, not / and / or, parentheses
+// Values: total (the deciding player's running total), best (the highest earlier total, 0 for player 1), p1, p2
+// (earlier totals, 0 = bust or not played yet), spins (spins made so far), numbers in wheel units or cents ("55c",
+// 5 cents a unit). Flags: behind (total < best), tied (total == best, best > 0), ahead (total > best).
+//
+// The rules are evaluated once per state when the file is compiled, into flat tables of spin probabilities
+// (PolicyTables) for one wheel size and spins per turn; the solver and the simulator only look them up.
+
+// The compiled rules: the spin-again probability of every decision state
+struct PolicyTables {
+    int segments = 0;
+    int spins_per_turn = 0;
+    bool deterministic = true;    // every probability is 0 or 1
+    std::vector<Fraction> third;  // [spins - 1][p1][p2][total]
+    std::vector<Fraction> second; // [spins - 1][p1][total]
+    std::vector<Fraction> first;  // [spins - 1][total]
+
+    size_t third_index(int p1, int p2, int total, int spins) const {
+        const size_t s = segments + 1;
+        return (((size_t)(spins - 1) * s + p1) * s + p2) * s + total;
+    }
+    size_t second_index(int p1, int total, int spins) const {
+        const size_t s = segments + 1;
+        return ((size_t)(spins - 1) * s + p1) * s + total;
+    }
+    size_t first_index(int total, int spins) const { return (size_t)(spins - 1) * (segments + 1) + total; }
+};
+
+// Parse and compile rules (throws std::invalid_argument "line N: ..." for errors)
+PolicyTables compile_policy_rules(const std::string& text, const GameRules& rules);
+PolicyTables load_policy_rules(const std::string& path, const GameRules& rules);
+
+// Hash of the shape and every probability: tables that decide alike get the same one (for policy names)
+uint64_t policy_tables_fingerprint(const PolicyTables& tables);
+
+// The tables as a policy set named name. Its solve runs through DecisionTablePolicies when the tables are
+// deterministic and TablePolicies otherwise (compiled_solve in dp_solver.h).
+template <class Num>
+PolicySet<Num> table_policies(const PolicyTables& tables, const std::string& name);
+
+// -- Compiled table policies (dp_solver.h) --
+// The spin probabilities converted to Num once
+template <class Num>
+struct TablePolicies {
+    using number_type = Num;
+    std::shared_ptr<const PolicyTables> layout;
+    std::shared_ptr<const std::vector<Num>> third, second, first;
+
+    Num third_player(const DpTables<Num>&, int p1, int p2, int spin, int spins) const {
+        return (*third)[layout->third_index(p1, p2, spin, spins)];
+    }
+    Num second_player(const DpTables<Num>&, int p1, int spin, int spins) const {
+        return (*second)[layout->second_index(p1, spin, spins)];
+    }
+    Num first_player(const DpTables<Num>&, int spin, int spins) const {
+        return (*first)[layout->first_index(spin, spins)];
+    }
+};
+
+// ...and the decisions of deterministic tables
+template <class Num>
+struct DecisionTablePolicies {
+    using number_type = Num;
+    static constexpr bool deterministic = true;
+    std::shared_ptr<const PolicyTables> layout;
+    std::shared_ptr<const std::vector<uint8_t>> third, second, first;
+
+    bool third_player(const DpTables<Num>&, int p1, int p2, int spin, int spins) const {
+        return (*third)[layout->third_index(p1, p2, spin, spins)];
+    }
+    bool second_player(const DpTables<Num>&, int p1, int spin, int spins) const {
+        return (*second)[layout->second_index(p1, spin, spins)];
+    }
+    bool first_player(const DpTables<Num>&, int spin, int spins) const {
+        return (*first)[layout->first_index(spin, spins)];
+    }
+};
+
+#endif // POLICY_LANGUAGE_H
@@ -0,0 +1,528 @@
+#include "query_server.h"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+using namespace query_protocol;
+
+namespace {
+
+const size_t max_payload_size = 256;  // policy names
+const size_t read_chunk_size = 64 * 1024;
+const size_t max_pending_input = 1024 * 1024; // per connection: stop reading there until the batch is answered
+const int accept_retry_ms = 100;              // listener paused for lack of descriptors: retry after this
+
+runtime_error system_error_for(const string& what) {
+    return runtime_error(what + ": " + strerror(errno));
+}
+
+// What run(true) takes through its signalfd
+sigset_t server_signals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    return signals;
+}
+
+sockaddr_un socket_address(const string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw invalid_argument("Socket path too long: " + path);
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+template <class Num>
+class QueryTablesImpl : public QueryTables {
+public:
+    QueryTablesImpl(const GameRules& rules, DpTables<Num> tables, PolicySet<Num> policies)
+        : rules(rules), tables(std::move(tables)), policies(std::move(policies)) {}
+
+    int segments() const override { return rules.segments; }
+    const string& policy_name() const override { return policies.name; }
+
+    void answer(const Request& request, Response& response) const override {
+        response.segments = (uint16_t)rules.segments;
+        if (request.kind == RequestKind::info)
+            return;
+        const int player = request.player, p1 = request.p1, p2 = request.p2, spin = request.spin;
+        if (request.kind != RequestKind::state || player < 1 || player > 3 || p1 > rules.segments
+            || p2 > rules.segments || spin > rules.segments) {
+            response.status = Status::bad_request;
+            return;
+        }
+        using Traits = NumericTraits<Num>;
+        for (int k = 0; k < 3; k++)
+            response.win_probability[k] =
+                Traits::to_double(policy_state_probability(tables, rules, policies, player, p1, p2, spin, k));
+        if (spin > 0 && spin < rules.segments) {
+            response.spin_probability = Traits::to_double((player == 1) ? policies.first_player(tables, spin, 1)
+                                                          : (player == 2) ? policies.second_player(tables, p1, spin, 1)
+                                                          : policies.third_player(tables, p1, p2, spin, 1));
+            response.spin_again = response.spin_probability >= 0.5;
+        }
+    }
+
+private:
+    GameRules rules;
+    DpTables<Num> tables;
+    PolicySet<Num> policies;
+};
+
+class CompactQueryTables : public QueryTables {
+public:
+    CompactQueryTables(CompactTables tables, string name) : tables(std::move(tables)), name(std::move(name)) {}
+
+    int segments() const override { return tables.segments(); }
+    const string& policy_name() const override { return name; }
+
+    void answer(const Request& request, Response& response) const override {
+        const int segments = tables.segments();
+        response.segments = (uint16_t)segments;
+        if (request.kind == RequestKind::info)
+            return;
+        const int player = request.player, p1 = request.p1, p2 = request.p2, spin = request.spin;
+        if (request.kind != RequestKind::state || player < 1 || player > 3 || p1 > segments || p2 > segments
+            || spin > segments) {
+            response.status = Status::bad_request;
+            return;
+        }
+        for (int k = 0; k < 3; k++)
+            response.win_probability[k] = tables.win_probability(player, p1, p2, spin, k);
+        if (spin > 0 && spin < segments) {
+            response.spin_probability = tables.spin_probability(player, p1, p2, spin);
+            response.spin_again = response.spin_probability >= 0.5;
+        }
+    }
+
+private:
+    CompactTables tables;
+    string name;
+};
+
+struct Connection {
+    vector<char> input;
+    vector<char> output;
+    size_t output_sent = 0;
+    bool waiting_to_write = false; // EPOLLOUT armed, reading paused until the output drains
+    bool closing = false;          // close once the output is sent
+};
+
+} // namespace
+
+
+template <class Num>
+shared_ptr<const QueryTables> make_query_tables(const GameRules& rules, DpTables<Num> tables, PolicySet<Num> policies) {
+    return make_shared<QueryTablesImpl<Num>>(rules, std::move(tables), std::move(policies));
+}
+
+shared_ptr<const QueryTables> make_query_tables(CompactTables tables, string policy_name) {
+    return make_shared<CompactQueryTables>(std::move(tables), std::move(policy_name));
+}
+
+
+// -- Server --
+struct QueryServer::State {
+    string socket_path;
+    QueryTableLoader loader;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;   // eventfd: stop() and finished swaps
+    int signal_fd = -1;
+    bool accept_paused = false; // listener disarmed: out of descriptors
+    unordered_map<int, Connection> connections;
+
+    shared_ptr<const QueryTables> tables; // event loop thread only
+    atomic<uint32_t> generation{1};
+    atomic<bool> stopping{false};
+
+    // Swap in progress: the loader runs on its own thread and hands the result over through swap_result
+    thread swap_thread;
+    bool swap_running = false;
+    mutex swap_mutex;
+    shared_ptr<const QueryTables> swap_result;
+    string swap_error;
+
+    atomic<uint64_t> connection_count{0}, request_count{0}, batch_count{0};
+
+    void watch(int fd, uint32_t events, int operation) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, operation, fd, &event) != 0)
+            throw system_error_for("epoll_ctl");
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written; // the counter can only fail to grow by overflowing, which still wakes the loop
+    }
+
+    void accept_connections() {
+        while (true) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                // Out of descriptors: the client stays in the backlog and the listener stays readable, so stop
+                // watching it until a connection closes (or accept_retry_ms passes) instead of spinning on it
+                if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                    watch(listen_fd, 0, EPOLL_CTL_MOD);
+                    accept_paused = true;
+                }
+                return;
+            }
+            connections[fd];
+            watch(fd, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD);
+            connection_count++;
+        }
+    }
+
+    void resume_accepting() {
+        if (!accept_paused)
+            return;
+        accept_paused = false;
+        watch(listen_fd, EPOLLIN, EPOLL_CTL_MOD);
+    }
+
+    void close_connection(int fd) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(fd);
+        resume_accepting();
+    }
+
+    void start_swap(const string& policy_name) {
+        if (swap_thread.joinable())
+            swap_thread.join();
+        swap_running = true;
+        swap_thread = thread([this, policy_name]() {
+            try {
+                shared_ptr<const QueryTables> loaded = loader(policy_name);
+                lock_guard<mutex> lock(swap_mutex);
+                swap_result = std::move(loaded);
+            } catch (const exception& e) {
+                lock_guard<mutex> lock(swap_mutex);
+                swap_error = e.what();
+            }
+            wake();
+        });
+    }
+
+    void finish_swap() {
+        lock_guard<mutex> lock(swap_mutex);
+        if (!swap_running || (!swap_result && swap_error.empty()))
+            return;
+        if (swap_result) {
+            tables = std::move(swap_result);
+            generation++;
+            cerr << "query server: serving " << tables->policy_name() << " (generation " << generation << ")" << endl;
+        } else {
+            cerr << "query server: swap failed, still serving " << tables->policy_name() << ": " << swap_error << endl;
+        }
+        swap_result.reset();
+        swap_error.clear();
+        swap_running = false;
+    }
+
+    // Answer every complete request in the input buffer; false if the connection sent garbage
+    bool answer_batch(Connection& connection) {
+        const shared_ptr<const QueryTables> current = tables; // one table set per batch
+        const uint32_t current_generation = generation;
+        size_t position = 0;
+        size_t answered = 0;
+        bool valid = true;
+        while (connection.input.size() - position >= sizeof(Request)) {
+            Request request;
+            memcpy(&request, connection.input.data() + position, sizeof(Request));
+            if (request.payload_size > max_payload_size) {
+                valid = false;
+                break;
+            }
+            if (connection.input.size() - position < sizeof(Request) + request.payload_size)
+                break;
+            const char* payload = connection.input.data() + position + sizeof(Request);
+            position += sizeof(Request) + request.payload_size;
+
+            Response response{};
+            response.id = request.id;
+            response.generation = current_generation;
+            if (request.kind == RequestKind::swap) {
+                response.segments = (uint16_t)current->segments();
+                if (swap_running)
+                    response.status = Status::busy;
+                else
+                    start_swap(request.payload_size ? string(payload, request.payload_size) : current->policy_name());
+            } else {
+                current->answer(request, response);
+            }
+            const char* bytes = reinterpret_cast<const char*>(&response);
+            connection.output.insert(connection.output.end(), bytes, bytes + sizeof(Response));
+            answered++;
+        }
+        connection.input.erase(connection.input.begin(), connection.input.begin() + position);
+        if (answered) {
+            request_count += answered;
+            batch_count++;
+        }
+        return valid;
+    }
+
+    // Send what we can; arm EPOLLOUT (and pause reading) while output is left
+    void flush(int fd, Connection& connection) {
+        while (connection.output_sent < connection.output.size()) {
+            ssize_t sent = send(fd, connection.output.data() + connection.output_sent,
+                                connection.output.size() - connection.output_sent, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                close_connection(fd);
+                return;
+            }
+            connection.output_sent += sent;
+        }
+        bool pending = connection.output_sent < connection.output.size();
+        if (!pending) {
+            connection.output.clear();
+            connection.output_sent = 0;
+            if (connection.closing) {
+                close_connection(fd);
+                return;
+            }
+        }
+        if (pending != connection.waiting_to_write) {
+            connection.waiting_to_write = pending;
+            watch(fd, pending ? (EPOLLOUT | EPOLLRDHUP) : (EPOLLIN | EPOLLRDHUP), EPOLL_CTL_MOD);
+        }
+    }
+
+    void read_requests(int fd, Connection& connection) {
+        bool peer_closed = false;
+        while (true) {
+            size_t size = connection.input.size();
+            connection.input.resize(size + read_chunk_size);
+            ssize_t received = recv(fd, connection.input.data() + size, read_chunk_size, 0);
+            connection.input.resize(size + max<ssize_t>(received, 0));
+            if (received > 0 && connection.input.size() >= max_pending_input)
+                break; // answer these first; the rest stays in the socket (EPOLLIN fires again)
+            if (received > 0)
+                continue;
+            if (received < 0 && errno == EINTR)
+                continue;
+            if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                close_connection(fd);
+                return;
+            }
+            peer_closed = (received == 0);
+            break;
+        }
+        if (!answer_batch(connection) || peer_closed)
+            connection.closing = true;
+        flush(fd, connection);
+    }
+
+    void handle_signal() {
+        signalfd_siginfo info;
+        while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+            if (info.ssi_signo == SIGHUP) {
+                if (!swap_running)
+                    start_swap(tables->policy_name());
+            } else {
+                stopping = true;
+            }
+        }
+    }
+};
+
+
+QueryServer::QueryServer(const string& socket_path, QueryTableLoader loader, const string& policy_name)
+    : state(make_unique<State>()) {
+    state->socket_path = socket_path;
+    state->loader = std::move(loader);
+    state->tables = state->loader(policy_name);
+
+    sockaddr_un address = socket_address(socket_path);
+    struct stat existing;
+    if (lstat(socket_path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+        unlink(socket_path.c_str()); // left over from a daemon that didn't shut down cleanly
+
+    state->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (state->listen_fd < 0)
+        throw system_error_for("socket");
+    if (bind(state->listen_fd, (const sockaddr*)&address, sizeof(address)) != 0)
+        throw system_error_for("Cannot bind " + socket_path);
+    if (listen(state->listen_fd, SOMAXCONN) != 0)
+        throw system_error_for("listen");
+
+    state->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    state->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (state->epoll_fd < 0 || state->wake_fd < 0)
+        throw system_error_for("epoll / eventfd");
+    state->watch(state->listen_fd, EPOLLIN, EPOLL_CTL_ADD);
+    state->watch(state->wake_fd, EPOLLIN, EPOLL_CTL_ADD);
+}
+
+QueryServer::~QueryServer() {
+    if (state->swap_thread.joinable())
+        state->swap_thread.join();
+    for (auto& [fd, connection] : state->connections)
+        close(fd);
+    for (int fd : {state->listen_fd, state->epoll_fd, state->wake_fd, state->signal_fd})
+        if (fd >= 0)
+            close(fd);
+    if (state->listen_fd >= 0)
+        unlink(state->socket_path.c_str());
+}
+
+void QueryServer::block_signals() {
+    const sigset_t signals = server_signals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+}
+
+void QueryServer::run(bool handle_signals) {
+    if (handle_signals && state->signal_fd < 0) {
+        const sigset_t signals = server_signals();
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        state->signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (state->signal_fd < 0)
+            throw system_error_for("signalfd");
+        state->watch(state->signal_fd, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    const int max_events = 64;
+    epoll_event events[max_events];
+    while (!state->stopping) {
+        int count = epoll_wait(state->epoll_fd, events, max_events, state->accept_paused ? accept_retry_ms : -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            throw system_error_for("epoll_wait");
+        }
+        if (count == 0)
+            state->resume_accepting();
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == state->listen_fd) {
+                state->accept_connections();
+            } else if (fd == state->wake_fd) {
+                uint64_t value;
+                ssize_t drained = read(state->wake_fd, &value, sizeof(value));
+                (void)drained;
+                state->finish_swap();
+            } else if (fd == state->signal_fd) {
+                state->handle_signal();
+            } else if (auto found = state->connections.find(fd); found != state->connections.end()) {
+                Connection& connection = found->second;
+                if (events[i].events & EPOLLERR)
+                    state->close_connection(fd);
+                else if (connection.waiting_to_write)
+                    state->flush(fd, connection);
+                else
+                    state->read_requests(fd, connection);
+            }
+        }
+    }
+}
+
+void QueryServer::stop() {
+    state->stopping = true;
+    state->wake();
+}
+
+QueryServer::Stats QueryServer::stats() const {
+    return {state->connection_count, state->request_count, state->batch_count, state->generation};
+}
+
+
+// -- Client --
+QueryClient::QueryClient(const string& socket_path) {
+    sockaddr_un address = socket_address(socket_path);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throw system_error_for("socket");
+    if (connect(fd, (const sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        throw system_error_for("Cannot connect to " + socket_path);
+    }
+}
+
+QueryClient::~QueryClient() {
+    close(fd);
+}
+
+void QueryClient::send_all(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            throw system_error_for("send");
+        bytes += sent;
+        size -= sent;
+    }
+}
+
+void QueryClient::receive_all(void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t received = recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received == 0)
+            throw runtime_error("Query server closed the connection");
+        if (received < 0)
+            throw system_error_for("recv");
+        bytes += received;
+        size -= received;
+    }
+}
+
+vector<Response> QueryClient::exchange(const vector<Request>& requests) {
+    send_all(requests.data(), requests.size() * sizeof(Request));
+    vector<Response> responses(requests.size());
+    receive_all(responses.data(), responses.size() * sizeof(Response));
+    return responses;
+}
+
+Response QueryClient::swap(const string& policy_name) {
+    if (policy_name.size() > max_payload_size)
+        throw invalid_argument("Policy name too long");
+    Request request{};
+    request.kind = RequestKind::swap;
+    request.payload_size = (uint16_t)policy_name.size();
+    vector<char> message(sizeof(Request) + policy_name.size());
+    memcpy(message.data(), &request, sizeof(Request));
+    memcpy(message.data() + sizeof(Request), policy_name.data(), policy_name.size());
+    send_all(message.data(), message.size());
+    Response response;
+    receive_all(&response, sizeof(response));
+    return response;
+}
+
+
+// -- Instantiations --
+template shared_ptr<const QueryTables> make_query_tables<Fraction>(const GameRules&, DpTables<Fraction>,
+                                                                   PolicySet<Fraction>);
+template shared_ptr<const QueryTables> make_query_tables<double>(const GameRules&, DpTables<double>,
+                                                                 PolicySet<double>);
@@ -0,0 +1,127 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "compact_tables.h"
+#include "dp_solver.h"
+
+
+// --- Query daemon ---
+// Serves decision / win probability queries from solved tables over a Unix domain socket (Linux: epoll,
+// signalfd, eventfd). One thread runs the event loop; every request that has arrived on a connection is
+// answered in one batch and the responses go out in one write.
+//
+// Protocol (native byte order, it's a local socket): the client sends requests, the server answers each one
+// with a Response carrying the same id, in order per connection. Clients may pipeline as many as they like.
+namespace query_protocol {
+
+enum RequestKind : uint8_t {
+    state = 0, // win probabilities in a state (and the policy's decision if the player has spun once)
+    info = 1,  // current table set (generation, segments) only
+    swap = 2,  // replace the table set: payload = policy name (empty: reload the current one)
+};
+
+enum Status : uint8_t {
+    ok = 0,
+    bad_request = 1, // unknown kind or a state outside the tables
+    busy = 2,        // swap while another swap is still loading
+};
+
+struct Request {
+    uint32_t id;           // echoed in the response
+    uint8_t kind;          // RequestKind
+    uint8_t player;        // state: the player about to decide, 1-3
+    uint8_t p1;            // state: totals of the earlier players (wheel units, 0 = bust)
+    uint8_t p2;
+    uint8_t spin;          // state: the player's first spin, 0 = hasn't spun yet
+    uint8_t reserved;
+    uint16_t payload_size; // bytes following the request (swap only)
+};
+static_assert(sizeof(Request) == 12);
+
+struct Response {
+    uint32_t id;
+    uint8_t status;             // Status
+    uint8_t spin_again;         // the policy's more likely choice
+    uint16_t segments;
+    uint32_t generation;        // table set the answer came from (counts swaps)
+    uint32_t reserved;
+    double spin_probability;    // the policy's probability of spinning again (0 before the first spin)
+    double win_probability[3];  // each player's win probability from this state on, under the policy
+};
+static_assert(sizeof(Response) == 48);
+
+} // namespace query_protocol
+
+// Solved tables + policies behind the type-erased interface the server answers from
+class QueryTables {
+public:
+    virtual ~QueryTables() = default;
+    virtual int segments() const = 0;
+    virtual const std::string& policy_name() const = 0;
+    virtual void answer(const query_protocol::Request& request, query_protocol::Response& response) const = 0;
+};
+
+template <class Num>
+std::shared_ptr<const QueryTables> make_query_tables(const GameRules& rules, DpTables<Num> tables,
+                                                     PolicySet<Num> policies);
+// The same answers from compact tables (compact_tables.h) built for policy_name
+std::shared_ptr<const QueryTables> make_query_tables(CompactTables tables, std::string policy_name);
+
+// Builds the table set for a policy name (runs on a background thread during a swap; may throw)
+using QueryTableLoader = std::function<std::shared_ptr<const QueryTables>(const std::string& policy_name)>;
+
+class QueryServer {
+public:
+    // Binds socket_path (replacing a stale socket file) and loads the first table set
+    QueryServer(const std::string& socket_path, QueryTableLoader loader, const std::string& policy_name);
+    ~QueryServer();
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    // Serve until stop() -- or SIGINT / SIGTERM if handle_signals (SIGHUP then reloads the current table set).
+    // handle_signals blocks those signals in the calling thread; threads started before must have them blocked
+    // too (block_signals, before the constructor solves; the thread pool's workers block every signal).
+    void run(bool handle_signals = false);
+    // Block SIGINT, SIGTERM and SIGHUP in the calling thread (and the threads it starts from now on)
+    static void block_signals();
+
+    // Make run return (from any thread)
+    void stop();
+
+    struct Stats {
+        uint64_t connections = 0;
+        uint64_t requests = 0;
+        uint64_t batches = 0; // request batches answered (requests / batches = average batch size)
+        uint32_t generation = 0;
+    };
+    Stats stats() const; // totals so far (from any thread)
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+// Blocking client for the protocol (tools, benchmarks)
+class QueryClient {
+public:
+    explicit QueryClient(const std::string& socket_path);
+    ~QueryClient();
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    // Send the requests in one write and wait for all the responses
+    std::vector<query_protocol::Response> exchange(const std::vector<query_protocol::Request>& requests);
+    query_protocol::Response swap(const std::string& policy_name);
+
+private:
+    int fd = -1;
+    void send_all(const void* data, size_t size);
+    void receive_all(void* data, size_t size);
+};
+
+#endif // QUERY_SERVER_H
@@ -0,0 +1,238 @@
+#include "replay.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "episode.h"
+using namespace std;
+
+namespace {
+
+const int cents_per_unit = 5;
+const int recorded_segments = 20; // the datasets are from the real 5..100 cent wheel
+
+// A spin value in cents -> wheel units (0 if missing / not a wheel value)
+int spin_units(const JsonValue* value) {
+    if (value == nullptr || !value->is_number())
+        return 0;
+    double cents = value->number;
+    int units = (int)lround(cents / cents_per_unit);
+    if (abs(units * cents_per_unit - cents) > 1e-9 || units < 1 || units > recorded_segments)
+        return 0;
+    return units;
+}
+
+// Read one contestant, false if the record doesn't fit the model
+bool parse_contestant(const JsonValue& record, ShowdownRecord::Contestant& contestant) {
+    if (const JsonValue* name = record.find("name"); name && name->is_string())
+        contestant.name = name->string;
+    if (const JsonValue* winnings = record.find("pre_wheel_winnings"); winnings && winnings->is_number())
+        contestant.pre_wheel_winnings = (long long)winnings->number;
+
+    const JsonValue* spins = record.find("initial_spins");
+    if (spins == nullptr || !spins->is_array())
+        return false;
+    bool second_listed = false;
+    for (const JsonValue& spin : spins->array) {
+        const JsonValue* index = spin.find("spin_index");
+        const JsonValue* value = spin.find("value");
+        if (index == nullptr || !index->is_number())
+            return false;
+        if (index->number == 1) {
+            contestant.first_spin = spin_units(value);
+        } else if (index->number == 2) {
+            second_listed = value && !value->is_null();
+            contestant.second_spin = spin_units(value);
+        }
+    }
+    if (contestant.first_spin == 0 || (second_listed && contestant.second_spin == 0))
+        return false;
+    if (contestant.first_spin == recorded_segments && contestant.second_spin != 0)
+        return false; // not allowed to spin again on a dollar
+    int total = contestant.first_spin + contestant.second_spin;
+    contestant.total = (total > recorded_segments) ? 0 : total;
+    return true;
+}
+
+// Read one showdown into showdown, false (and counted as skipped) if it doesn't fit the model
+bool parse_showdown(const JsonValue& record, ShowdownRecord& showdown, DatasetStats& stats) {
+    stats.showdowns_read++;
+    const JsonValue* contestants = record.find("contestants");
+    if (contestants == nullptr || !contestants->is_array() || contestants->array.size() != 3) {
+        stats.showdowns_skipped++;
+        return false;
+    }
+    for (int seat = 0; seat < 3; seat++)
+        if (!parse_contestant(contestants->array[seat], showdown.contestants[seat])) {
+            stats.showdowns_skipped++;
+            return false;
+        }
+    if (const JsonValue* winner = record.find("winner_index"); winner && winner->is_number()
+                                                               && winner->number >= 0 && winner->number < 3)
+        showdown.winner_index = (int)winner->number;
+    return true;
+}
+
+void check_recorded_rules(const GameRules& rules) {
+    if (rules.segments != recorded_segments || rules.spins_per_turn != 2)
+        throw invalid_argument("Replay needs the standard " + to_string(recorded_segments)
+                               + " segment wheel and two spins per turn");
+}
+
+// One seat's spin-again decision: the player's own win probability after each choice and the policy's spin probability
+struct SeatDecision {
+    bool decided = false; // no decision on the top score
+    bool spun = false;
+    double win_if_spin = 0, win_if_stay = 0, spin_probability = 0;
+
+    bool agreed() const { return (spin_probability >= 0.5) == spun; }
+    double win_probability_lost() const { return max(win_if_spin, win_if_stay) - (spun ? win_if_spin : win_if_stay); }
+};
+
+template <class Num>
+array<SeatDecision, 3> seat_decisions(const GameRules& rules, const DpTables<Num>& tables,
+                                      const PolicySet<Num>& policies, const ShowdownRecord& showdown) {
+    using Traits = NumericTraits<Num>;
+    const auto& [c1, c2, c3] = showdown.contestants;
+    array<SeatDecision, 3> decisions;
+    auto decide = [](SeatDecision& decision, bool spun, const Num& win_if_spin, const Num& win_if_stay,
+                     const Num& spin_probability) {
+        decision = {true, spun, Traits::to_double(win_if_spin), Traits::to_double(win_if_stay),
+                    Traits::to_double(spin_probability)};
+    };
+    if (c1.first_spin < rules.segments)
+        decide(decisions[0], c1.second_spin != 0, tables.first_player_probability(c1.first_spin, 1, 0),
+               tables.first_player_probability(c1.first_spin, 0, 0), policies.first_player(tables, c1.first_spin, 1));
+    if (c2.first_spin < rules.segments)
+        decide(decisions[1], c2.second_spin != 0, tables.second_player_probability(c1.total, c2.first_spin, 1, 1),
+               tables.second_player_probability(c1.total, c2.first_spin, 0, 1),
+               policies.second_player(tables, c1.total, c2.first_spin, 1));
+    if (c3.first_spin < rules.segments)
+        decide(decisions[2], c3.second_spin != 0,
+               tables.third_player_probability(c1.total, c2.total, c3.first_spin, 1, 2),
+               tables.third_player_probability(c1.total, c2.total, c3.first_spin, 0, 2),
+               policies.third_player(tables, c1.total, c2.total, c3.first_spin, 1));
+    return decisions;
+}
+
+} // namespace
+
+
+vector<ShowdownRecord> parse_showdowns(const JsonValue& document, DatasetStats& stats) {
+    if (!document.is_array())
+        throw runtime_error("Dataset must be a JSON list of showdowns or episodes");
+    vector<ShowdownRecord> showdowns;
+    for (const JsonValue& item : document.array) {
+        if (const JsonValue* parsed = item.find("parsed_showdowns"); parsed && parsed->is_array()) {
+            for (const JsonValue& record : parsed->array)
+                if (ShowdownRecord showdown; parse_showdown(record, showdown, stats))
+                    showdowns.push_back(showdown);
+        } else if (ShowdownRecord showdown; item.find("contestants") && parse_showdown(item, showdown, stats)) {
+            showdowns.push_back(showdown);
+        }
+    }
+    return showdowns;
+}
+
+vector<EpisodeRecord> parse_episodes(const JsonValue& document, DatasetStats& stats) {
+    if (!document.is_array())
+        throw runtime_error("Dataset must be a JSON list of episodes");
+    vector<EpisodeRecord> episodes;
+    for (const JsonValue& item : document.array) {
+        const JsonValue* parsed = item.find("parsed_showdowns");
+        if (parsed == nullptr || !parsed->is_array())
+            continue;
+        EpisodeRecord episode;
+        if (const JsonValue* title = item.find("episode_title"); title && title->is_string())
+            episode.title = title->string;
+        bool complete = parsed->array.size() == 2;
+        for (size_t i = 0; i < parsed->array.size(); i++) {
+            ShowdownRecord showdown;
+            if (parse_showdown(parsed->array[i], showdown, stats) && i < 2)
+                episode.showdowns[i] = showdown;
+            else
+                complete = false;
+        }
+        if (complete)
+            episodes.push_back(episode);
+        else
+            stats.episodes_skipped++;
+    }
+    return episodes;
+}
+
+vector<ShowdownRecord> load_showdowns(const string& path, DatasetStats& stats) {
+    return parse_showdowns(parse_json_file(path), stats);
+}
+
+vector<EpisodeRecord> load_episodes(const string& path, DatasetStats& stats) {
+    return parse_episodes(parse_json_file(path), stats);
+}
+
+template <class Num>
+array<SeatReplay, 3> replay_showdowns(const GameRules& rules, const DpTables<Num>& tables,
+                                      const PolicySet<Num>& policies, const vector<ShowdownRecord>& showdowns) {
+    check_recorded_rules(rules);
+    using Traits = NumericTraits<Num>;
+    array<SeatReplay, 3> seats;
+    for (const ShowdownRecord& showdown : showdowns) {
+        const array<SeatDecision, 3> decisions = seat_decisions(rules, tables, policies, showdown);
+        for (int seat = 0; seat < 3; seat++) {
+            const SeatDecision& decision = decisions[seat];
+            if (!decision.decided)
+                continue;
+            seats[seat].decisions++;
+            seats[seat].agreed += decision.agreed();
+            seats[seat].win_probability_lost += decision.win_probability_lost();
+            seats[seat].log_likelihood += log(max(1e-12, decision.spun ? decision.spin_probability
+                                                                       : 1 - decision.spin_probability));
+        }
+
+        if (showdown.winner_index >= 0)
+            for (int seat = 0; seat < 3; seat++) {
+                seats[seat].wins += (showdown.winner_index == seat);
+                seats[seat].expected_wins += Traits::to_double(tables.first_player_policy_probability(seat));
+            }
+    }
+    return seats;
+}
+
+template <class Num>
+vector<ContestantReplay> replay_contestants(const GameRules& rules, const DpTables<Num>& tables,
+                                            const PolicySet<Num>& policies, const vector<ShowdownRecord>& showdowns) {
+    check_recorded_rules(rules);
+    using Traits = NumericTraits<Num>;
+    vector<ContestantReplay> contestants;
+    contestants.reserve(showdowns.size() * 3);
+    for (const ShowdownRecord& showdown : showdowns) {
+        const array<SeatDecision, 3> decisions = seat_decisions(rules, tables, policies, showdown);
+        array<long long, 3> winnings;
+        for (int seat = 0; seat < 3; seat++)
+            winnings[seat] = showdown.contestants[seat].pre_wheel_winnings;
+        const array<int, 3> order = spin_order(winnings);
+        for (int seat = 0; seat < 3; seat++) {
+            ContestantReplay contestant;
+            contestant.name = showdown.contestants[seat].name;
+            contestant.pre_wheel_winnings = winnings[seat];
+            contestant.seat = seat;
+            contestant.winnings_seat = (int)(find(order.begin(), order.end(), seat) - order.begin());
+            contestant.decided = decisions[seat].decided;
+            contestant.agreed = decisions[seat].decided && decisions[seat].agreed();
+            contestant.win_probability_lost = decisions[seat].decided ? decisions[seat].win_probability_lost() : 0;
+            contestant.win_probability = Traits::to_double(tables.first_player_policy_probability(seat));
+            contestant.won = showdown.winner_index < 0 ? -1 : showdown.winner_index == seat;
+            contestants.push_back(contestant);
+        }
+    }
+    return contestants;
+}
+
+
+// -- Instantiations --
+template array<SeatReplay, 3> replay_showdowns<Fraction>(const GameRules&, const DpTables<Fraction>&,
+                                                         const PolicySet<Fraction>&, const vector<ShowdownRecord>&);
+template array<SeatReplay, 3> replay_showdowns<double>(const GameRules&, const DpTables<double>&,
+                                                       const PolicySet<double>&, const vector<ShowdownRecord>&);
+template vector<ContestantReplay> replay_contestants<Fraction>(const GameRules&, const DpTables<Fraction>&,
+                                                               const PolicySet<Fraction>&, const vector<ShowdownRecord>&);
+template vector<ContestantReplay> replay_contestants<double>(const GameRules&, const DpTables<double>&,
+                                                             const PolicySet<double>&, const vector<ShowdownRecord>&);
@@ -0,0 +1,82 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include "dp_solver.h"
+#include "json.h"
+
+
+// --- Replay ---
+// Real showdowns from the scraped datasets, scored against solved tables and a policy set.
+
+// One showdown in spin order, values in wheel units (1 = 5 cents)
+struct ShowdownRecord {
+    struct Contestant {
+        std::string name;
+        long long pre_wheel_winnings = 0;
+        int first_spin = 0;
+        int second_spin = 0; // 0 if they stayed
+        int total = 0;       // 0 if they busted
+    };
+    std::array<Contestant, 3> contestants;
+    int winner_index = -1; // seat that went to the showcase (-1 if the record doesn't say)
+};
+
+// An episode: its two showdowns, whose winners go on to the Showcase
+struct EpisodeRecord {
+    std::string title;
+    std::array<ShowdownRecord, 2> showdowns;
+};
+
+struct DatasetStats {
+    long long showdowns_read = 0;
+    long long showdowns_skipped = 0; // not 3 contestants, or spins that don't fit the wheel
+    long long episodes_skipped = 0;  // parse_episodes: not two showdowns that both fit
+};
+
+// Read the showdowns of a dataset: either a list of showdowns (scenario_*_showdowns.json,
+// structured_showdowns.json) or a list of episodes with "parsed_showdowns" (tpir_structured_showdowns.json)
+std::vector<ShowdownRecord> parse_showdowns(const JsonValue& document, DatasetStats& stats);
+std::vector<ShowdownRecord> load_showdowns(const std::string& path, DatasetStats& stats);
+// ...and the complete episodes of tpir_structured_showdowns.json
+std::vector<EpisodeRecord> parse_episodes(const JsonValue& document, DatasetStats& stats);
+std::vector<EpisodeRecord> load_episodes(const std::string& path, DatasetStats& stats);
+
+// How the contestants in one seat played compared to the policy
+struct SeatReplay {
+    long long decisions = 0;         // spin-again decisions (first spin below the top score)
+    long long agreed = 0;            // decisions matching the policy's more likely choice
+    double win_probability_lost = 0; // sum of (better choice - actual choice) in the contestant's own win probability
+    double log_likelihood = 0;       // sum of log P(actual choice) under the policy
+    long long wins = 0;              // showdowns the seat won (records with a known winner)
+    double expected_wins = 0;        // sum of the seat's win probability before the game (same records)
+};
+
+// Replay the showdowns (rules must be the standard 20 segment wheel the data was recorded on)
+template <class Num>
+std::array<SeatReplay, 3> replay_showdowns(const GameRules& rules, const DpTables<Num>& tables,
+                                           const PolicySet<Num>& policies, const std::vector<ShowdownRecord>& showdowns);
+
+// One contestant's showdown, for results by contestant rather than by seat: where they spun as recorded and where
+// the spin order by pre-wheel winnings puts them, their decision, and their seat's chances from the same tables
+struct ContestantReplay {
+    std::string name;
+    long long pre_wheel_winnings = 0;
+    int seat = 0;                    // spin position as recorded, 0-2
+    int winnings_seat = 0;           // spin position by pre-wheel winnings (spin_order in episode.h)
+    bool decided = false;            // had a spin-again decision
+    bool agreed = false;
+    double win_probability_lost = 0;
+    double win_probability = 0;      // the seat's win probability before the game
+    int won = -1;                    // 1 or 0, -1 if the record doesn't say
+};
+
+// The same replay, one entry per contestant (showdown by showdown, in seat order)
+template <class Num>
+std::vector<ContestantReplay> replay_contestants(const GameRules& rules, const DpTables<Num>& tables,
+                                                 const PolicySet<Num>& policies,
+                                                 const std::vector<ShowdownRecord>& showdowns);
+
+#endif // REPLAY_H
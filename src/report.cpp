@@ -0,0 +1,107 @@
+#include "report.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "json.h"
+using namespace std;
+
+namespace {
+
+// true if cell is a JSON number as written (so it can go out unquoted)
+bool is_json_number(const string& cell) {
+    if (cell.empty())
+        return false;
+    size_t i = (cell[0] == '-') ? 1 : 0;
+    if (i >= cell.size() || !isdigit((unsigned char)cell[i]))
+        return false;
+    if (cell[i] == '0' && i + 1 < cell.size() && isdigit((unsigned char)cell[i + 1]))
+        return false; // leading zero
+    char* end = nullptr;
+    strtod(cell.c_str(), &end);
+    return end == cell.c_str() + cell.size() && cell.find_first_of("xXnN") == string::npos;
+}
+
+string csv_cell(const string& cell) {
+    if (cell.find_first_of(",\"\n") == string::npos)
+        return cell;
+    string quoted = "\"";
+    for (char c : cell)
+        quoted += (c == '"') ? string("\"\"") : string(1, c);
+    return quoted + "\"";
+}
+
+} // namespace
+
+
+OutputFormat parse_output_format(const string& name) {
+    if (name == "text") return OutputFormat::text;
+    if (name == "csv") return OutputFormat::csv;
+    if (name == "json") return OutputFormat::json;
+    throw invalid_argument("Unknown output format '" + name + "' (text, csv or json)");
+}
+
+void write_report(ostream& os, OutputFormat format, const vector<ResultTable>& tables) {
+    if (format == OutputFormat::json) {
+        os << "{";
+        for (size_t t = 0; t < tables.size(); t++) {
+            const ResultTable& table = tables[t];
+            os << (t ? ",\n " : "\n ") << json_quote(table.name) << ": [";
+            for (size_t r = 0; r < table.rows.size(); r++) {
+                os << (r ? ",\n  {" : "\n  {");
+                for (size_t c = 0; c < table.columns.size() && c < table.rows[r].size(); c++) {
+                    const string& cell = table.rows[r][c];
+                    os << (c ? ", " : "") << json_quote(table.columns[c]) << ": "
+                       << (is_json_number(cell) ? cell : json_quote(cell));
+                }
+                os << "}";
+            }
+            os << (table.rows.empty() ? "]" : "\n ]");
+        }
+        os << "\n}" << endl;
+        return;
+    }
+
+    for (size_t t = 0; t < tables.size(); t++) {
+        const ResultTable& table = tables[t];
+        if (t)
+            os << endl;
+        if (format == OutputFormat::csv) {
+            for (size_t c = 0; c < table.columns.size(); c++)
+                os << (c ? "," : "") << csv_cell(table.columns[c]);
+            os << "\n";
+            for (const vector<string>& row : table.rows) {
+                for (size_t c = 0; c < row.size(); c++)
+                    os << (c ? "," : "") << csv_cell(row[c]);
+                os << "\n";
+            }
+            continue;
+        }
+
+        // text
+        vector<size_t> widths(table.columns.size());
+        for (size_t c = 0; c < table.columns.size(); c++) {
+            widths[c] = table.columns[c].size();
+            for (const vector<string>& row : table.rows)
+                if (c < row.size())
+                    widths[c] = max(widths[c], row[c].size());
+        }
+        os << "-- " << table.name << " --" << endl;
+        for (size_t c = 0; c < table.columns.size(); c++)
+            os << (c ? "  " : "") << left << setw(widths[c]) << table.columns[c];
+        os << endl;
+        for (const vector<string>& row : table.rows) {
+            for (size_t c = 0; c < row.size() && c < widths.size(); c++)
+                os << (c ? "  " : "") << left << setw(widths[c]) << row[c];
+            os << endl;
+        }
+    }
+    os << right;
+}
+
+string format_number(double value) {
+    ostringstream out;
+    out << setprecision(10) << value;
+    return out.str();
+}
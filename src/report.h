@@ -0,0 +1,32 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+// --- Report output ---
+// Command results are a list of named tables, written as aligned text, CSV or JSON.
+enum class OutputFormat { text, csv, json };
+
+// "text", "csv" or "json" (throws std::invalid_argument otherwise)
+OutputFormat parse_output_format(const std::string& name);
+
+struct ResultTable {
+    std::string name;
+    std::vector<std::string> columns;
+    std::vector<std::vector<std::string>> rows; // cells that look like numbers are written unquoted in JSON
+
+    void add_row(std::vector<std::string> row) { rows.push_back(std::move(row)); }
+};
+
+// text: a "-- name --" heading per table and padded columns
+// csv:  a header line per table, tables separated by a blank line
+// json: one object, {"name": [ {column: value, ...}, ... ], ...}
+void write_report(std::ostream& os, OutputFormat format, const std::vector<ResultTable>& tables);
+
+// Number formatting shared by the commands (shortest round-trip-ish decimal)
+std::string format_number(double value);
+
+#endif // REPORT_H
@@ -0,0 +1,120 @@
+#include "score_distribution.h"
+#include <algorithm>
+#include <stdexcept>
+#include "instrumentation.h"
+using namespace std;
+
+namespace {
+
+template <class Num>
+Num number(long long num, long long denom) { return NumericTraits<Num>::ratio(num, denom); }
+
+} // namespace
+
+
+template <class Num>
+vector<Num> turn_distribution(const GameRules& rules, const function<Num(int total, int spins)>& spin_again) {
+    const int segments = rules.segments, max_spins = rules.spins_per_turn;
+    const Num zero = number<Num>(0, 1), spin_probability = number<Num>(1, segments);
+    vector<Num> final_total(segments + 1, zero);
+    // reach[total]: probability of standing on total after the current number of spins
+    vector<Num> reach(segments + 1, spin_probability), next(segments + 1, zero);
+    reach[0] = zero;
+    for (int spins = 1; spins <= max_spins; spins++) {
+        fill(next.begin(), next.end(), zero);
+        bool spinning = false;
+        for (int total = 1; total <= segments; total++) {
+            if (reach[total] == zero)
+                continue;
+            const Num again = (spins < max_spins && total < segments) ? spin_again(total, spins) : zero;
+            final_total[total] += reach[total] * (number<Num>(1, 1) - again);
+            if (again == zero)
+                continue;
+            spinning = true;
+            const Num each = reach[total] * again * spin_probability;
+            for (int value = 1; total + value <= segments; value++)
+                next[total + value] += each;
+            final_total[0] += number<Num>(total, 1) * each; // the values that bust
+        }
+        if (!spinning)
+            break;
+        swap(reach, next);
+    }
+    return final_total;
+}
+
+template <class Num>
+ScoreDistribution<Num> score_distribution(const GameRules& rules, const DpTables<Num>& tables,
+                                          const PolicySet<Num>& policies) {
+    PIR_SCOPED_TIMER("score_distribution");
+    if (!rules.uniform_wheel())
+        throw invalid_argument("Final-score distributions need the uniform wheel");
+    const int segments = rules.segments;
+    const size_t s = rules.scores();
+    const Num zero = number<Num>(0, 1);
+    ScoreDistribution<Num> result;
+    result.segments = segments;
+    result.joint.assign(s * s * s, zero);
+    for (vector<Num>& marginal : result.final_total)
+        marginal.assign(s, zero);
+    result.winning_total.assign(s, zero);
+    result.bust = result.win_probability = {zero, zero, zero};
+    result.two_way_spin_off = result.three_way_spin_off = zero;
+
+    // -- Forward pass: each player's turn given the totals before them --
+    const vector<Num> first = turn_distribution<Num>(
+        rules, [&](int total, int spins) { return policies.first_player(tables, total, spins); });
+    for (int p1 = 0; p1 <= segments; p1++) {
+        if (first[p1] == zero)
+            continue;
+        const vector<Num> second = turn_distribution<Num>(
+            rules, [&](int total, int spins) { return policies.second_player(tables, p1, total, spins); });
+        for (int p2 = 0; p2 <= segments; p2++) {
+            if (second[p2] == zero)
+                continue;
+            const Num before = first[p1] * second[p2];
+            const vector<Num> third = turn_distribution<Num>(
+                rules, [&](int total, int spins) { return policies.third_player(tables, p1, p2, total, spins); });
+            for (int p3 = 0; p3 <= segments; p3++)
+                if (third[p3] != zero)
+                    result.joint[((size_t)p1 * s + p2) * s + p3] = before * third[p3];
+        }
+    }
+
+    // -- Marginals and outcomes --
+    for (int p1 = 0; p1 <= segments; p1++)
+        for (int p2 = 0; p2 <= segments; p2++)
+            for (int p3 = 0; p3 <= segments; p3++) {
+                const Num& p = result.probability(p1, p2, p3);
+                if (p == zero)
+                    continue;
+                const int totals[3] = {p1, p2, p3}, best = max(p1, max(p2, p3));
+                int tied = 0;
+                for (int player = 0; player < 3; player++) {
+                    result.final_total[player][totals[player]] += p;
+                    tied += totals[player] == best;
+                }
+                result.winning_total[best] += p;
+                if (tied == 2)
+                    result.two_way_spin_off += p;
+                else if (tied == 3)
+                    result.three_way_spin_off += p;
+                const Num share = p * number<Num>(1, tied);
+                for (int player = 0; player < 3; player++)
+                    if (totals[player] == best)
+                        result.win_probability[player] += share;
+            }
+    for (int player = 0; player < 3; player++)
+        result.bust[player] = result.final_total[player][0];
+    return result;
+}
+
+
+// -- Instantiations --
+#define PIR_INSTANTIATE_SCORE_DISTRIBUTION(Num) \
+    template vector<Num> turn_distribution<Num>(const GameRules&, const function<Num(int, int)>&); \
+    template ScoreDistribution<Num> score_distribution<Num>(const GameRules&, const DpTables<Num>&, \
+                                                            const PolicySet<Num>&);
+
+PIR_INSTANTIATE_SCORE_DISTRIBUTION(Fraction)
+PIR_INSTANTIATE_SCORE_DISTRIBUTION(double)
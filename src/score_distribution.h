@@ -0,0 +1,41 @@
+#ifndef SCORE_DISTRIBUTION_H
+#define SCORE_DISTRIBUTION_H
+
+#include <array>
+#include <functional>
+#include <vector>
+#include "dp_solver.h"
+
+
+// --- Final-score distributions ---
+// Where the solved policies leave the players: the exact joint distribution of the three final totals and what
+// follows from it, by one forward pass over the turns (no simulation). Totals are in wheel units, 0 = bust.
+
+// Distribution of one turn's final total (index 0..segments) when the player spins again from (total, spins)
+// with probability spin_again(total, spins)
+template <class Num>
+std::vector<Num> turn_distribution(const GameRules& rules, const std::function<Num(int total, int spins)>& spin_again);
+
+template <class Num>
+struct ScoreDistribution {
+    int segments = 0;
+    std::vector<Num> joint;                     // [p1][p2][p3]: probability the game ends on these totals
+    std::array<std::vector<Num>, 3> final_total; // per player: distribution of their final total (index 0: bust)
+    std::vector<Num> winning_total;              // the highest total (0: everyone busts)
+    std::array<Num, 3> bust;                     // = final_total[player][0]
+    Num two_way_spin_off;                        // two players tie for the highest total
+    Num three_way_spin_off;                      // all three tie (everyone busting included)
+    std::array<Num, 3> win_probability;          // from the joint distribution, spin-offs even
+
+    const Num& probability(int p1, int p2, int p3) const {
+        const size_t s = segments + 1;
+        return joint[((size_t)p1 * s + p2) * s + p3];
+    }
+};
+
+// The players play by policies, deciding with the solved tables (as in the simulator)
+template <class Num>
+ScoreDistribution<Num> score_distribution(const GameRules& rules, const DpTables<Num>& tables,
+                                          const PolicySet<Num>& policies);
+
+#endif // SCORE_DISTRIBUTION_H
@@ -0,0 +1,300 @@
+#include "simulator.h"
+#include <array>
+#include <stdexcept>
+#include "episode.h"
+#include "policies.h"
+#include "thread_pool.h"
+using namespace std;
+
+
+// -- Simulate Game --
+bool random_decision(Fraction prob, mt19937_64& rng) {
+    long long rand_num = uniform_int_distribution<long long>(0, prob.getDenominator() - 1)(rng);
+    return rand_num < prob.getNumerator();
+}
+
+bool random_decision(double prob, mt19937_64& rng) {
+    return uniform_real_distribution<double>(0, 1)(rng) < prob;
+}
+
+int random_spin(int segments, mt19937_64& rng) {
+    return uniform_int_distribution<int>(1, segments)(rng);
+}
+
+namespace {
+
+// The rest of a turn after the first spin: spin again with the policy's probability while spins are left (not
+// allowed once the total is the top score), a bust ends the turn on 0. spin_probability(total, spins) asks the policy
+// (a PolicyChoice).
+template <class SpinProbability>
+int finish_turn(int total, int segments, int spins_per_turn, mt19937_64& rng, SpinProbability spin_probability) {
+    for (int spins = 1; spins < spins_per_turn && total > 0 && total < segments
+                        && random_decision(spin_probability(total, spins), rng); spins++) {
+        total += random_spin(segments, rng);
+        if (total > segments) // bust
+            total = 0;
+    }
+    return total;
+}
+
+// Play num_simulations games, calling observer(first spins, totals, winner) after each
+// (simulate_batch passes an empty observer, which compiles away)
+template <class Num, class Policies, class Observer>
+void play_games(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const Policies& policies,
+    long long num_simulations,
+    mt19937_64& rng,
+    long long wins[3],
+    Observer&& observer)
+{
+    const int segments = rules.segments, spins = rules.spins_per_turn;
+    using Choice = PolicyChoice<Num, Policies>;
+
+    // Loop many times
+    for (long long sim = 0; sim < num_simulations; sim++) {
+
+        // Player 1's turn
+        const int p1_spin = random_spin(segments, rng); // first spin
+        const int p1_total = finish_turn(p1_spin, segments, spins, rng, [&](int total, int taken) -> Choice {
+            return policies.first_player(tables, total, taken);
+        });
+
+        // Player 2's turn
+        const int p2_spin = random_spin(segments, rng); // first spin
+        const int p2_total = finish_turn(p2_spin, segments, spins, rng, [&](int total, int taken) -> Choice {
+            return policies.second_player(tables, p1_total, total, taken);
+        });
+
+        // Player 3's turn
+        const int p3_spin = random_spin(segments, rng); // first spin
+        const int p3_total = finish_turn(p3_spin, segments, spins, rng, [&](int total, int taken) -> Choice {
+            return policies.third_player(tables, p1_total, p2_total, total, taken);
+        });
+
+        // Determine winner
+        int max_score = max(p1_total, max(p2_total, p3_total));
+        int num_winners = (p1_total == max_score) + (p2_total == max_score) + (p3_total == max_score);
+        // select among winners uniformly (ASSUME SPIN OFF IS UNIFORM)
+        int selected_winner = uniform_int_distribution<int>(0, num_winners - 1)(rng);
+        int winner = 2;
+        if (p1_total == max_score && selected_winner-- == 0)
+            winner = 0;
+        else if (p2_total == max_score && selected_winner-- == 0)
+            winner = 1;
+        wins[winner]++;
+        observer(p1_spin, p1_total, p2_spin, p2_total, p3_spin, winner);
+    }
+}
+
+} // namespace
+
+template <class Num, class Policies>
+void simulate_batch(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const Policies& policies,
+    long long num_simulations,
+    mt19937_64& rng,
+    long long wins[3])
+{
+    PIR_SCOPED_TIMER("simulate_batch");
+    PIR_COUNT_N(simulated_games, num_simulations);
+    play_games(rules, tables, policies, num_simulations, rng, wins, [](int, int, int, int, int, int) {});
+}
+
+template <class Num, class Policies>
+vector<Fraction> simulate_game(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const Policies& policies,
+    long long num_simulations,
+    int num_threads,
+    unsigned long long seed)
+{
+    // Assuming DP tables have been initialized
+    PIR_SCOPED_TIMER("simulate_game");
+    if (!rules.uniform_wheel())
+        throw invalid_argument("The simulator only spins the uniform wheel");
+    num_threads = max(1, num_threads);
+
+    // initialize score variables (one set per stream, summed at the end)
+    vector<array<long long, 3>> stream_wins(num_threads, {0, 0, 0});
+    TaskGroup streams;
+    for (int t = 0; t < num_threads; t++) {
+        long long games = num_simulations / num_threads + (t < num_simulations % num_threads);
+        streams.run([&, t, games]() {
+            seed_seq seeds{seed, (unsigned long long)t};
+            mt19937_64 rng(seeds);
+            simulate_batch(rules, tables, policies, games, rng, stream_wins[t].data());
+        });
+    }
+    streams.wait();
+
+    long long p1_wins = 0;
+    long long p2_wins = 0;
+    long long p3_wins = 0;
+    for (const array<long long, 3>& wins : stream_wins) {
+        p1_wins += wins[0];
+        p2_wins += wins[1];
+        p3_wins += wins[2];
+    }
+
+    // Return win probabilities
+    return {Fraction(p1_wins, num_simulations), Fraction(p2_wins, num_simulations), Fraction(p3_wins, num_simulations)};
+}
+
+
+template <class Num>
+StateCounts simulate_state_counts(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const PolicySet<Num>& policies,
+    long long num_simulations,
+    int num_threads,
+    unsigned long long seed)
+{
+    PIR_SCOPED_TIMER("simulate_state_counts");
+    PIR_COUNT_N(simulated_games, num_simulations);
+    if (!rules.uniform_wheel())
+        throw invalid_argument("The simulator only spins the uniform wheel");
+    num_threads = max(1, num_threads);
+
+    vector<StateCounts> stream_counts(num_threads, StateCounts(rules.scores()));
+    TaskGroup streams;
+    for (int t = 0; t < num_threads; t++) {
+        long long games = num_simulations / num_threads + (t < num_simulations % num_threads);
+        streams.run([&, t, games]() {
+            seed_seq seeds{seed, (unsigned long long)t};
+            mt19937_64 rng(seeds);
+            StateCounts& counts = stream_counts[t];
+            play_games(rules, tables, policies, games, rng, counts.wins,
+                       [&counts](int p1_spin, int p1_total, int p2_spin, int p2_total, int p3_spin, int winner) {
+                           counts.first_player(p1_spin, winner)++;
+                           counts.second_player(p1_total, p2_spin, winner)++;
+                           counts.third_player(p1_total, p2_total, p3_spin, winner)++;
+                       });
+        });
+    }
+    streams.wait();
+
+    StateCounts total = std::move(stream_counts[0]);
+    for (int t = 1; t < num_threads; t++)
+        total.add(stream_counts[t]);
+    return total;
+}
+
+
+ContestantCounts::ContestantCounts(vector<long long> bounds, size_t pool_size)
+    : class_bounds(std::move(bounds)), contestants(class_bounds.size() + 1), wins(class_bounds.size() + 1),
+      expected_wins(class_bounds.size() + 1), games_by_contestant(pool_size), wins_by_contestant(pool_size),
+      expected_by_contestant(pool_size) {
+    for (vector<long long>& seat : seated)
+        seat.assign(class_bounds.size() + 1, 0);
+}
+
+void ContestantCounts::add(const ContestantCounts& other) {
+    for (size_t i = 0; i < contestants.size(); i++) {
+        contestants[i] += other.contestants[i];
+        wins[i] += other.wins[i];
+        expected_wins[i] += other.expected_wins[i];
+        for (int seat = 0; seat < 3; seat++)
+            seated[seat][i] += other.seated[seat][i];
+    }
+    for (size_t i = 0; i < games_by_contestant.size(); i++) {
+        games_by_contestant[i] += other.games_by_contestant[i];
+        wins_by_contestant[i] += other.wins_by_contestant[i];
+        expected_by_contestant[i] += other.expected_by_contestant[i];
+    }
+}
+
+template <class Num>
+ContestantCounts simulate_contestants(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const PolicySet<Num>& policies,
+    const vector<long long>& winnings_pool,
+    const vector<long long>& class_bounds,
+    long long num_simulations,
+    int num_threads,
+    unsigned long long seed)
+{
+    PIR_SCOPED_TIMER("simulate_contestants");
+    PIR_COUNT_N(simulated_games, num_simulations);
+    if (!rules.uniform_wheel())
+        throw invalid_argument("The simulator only spins the uniform wheel");
+    if (winnings_pool.empty())
+        throw invalid_argument("The contestant simulation needs a pool of pre-wheel winnings");
+    num_threads = max(1, num_threads);
+
+    // The seats' chances don't depend on who sits there: read them once
+    array<double, 3> seat_probability;
+    for (int seat = 0; seat < 3; seat++)
+        seat_probability[seat] = NumericTraits<Num>::to_double(tables.first_player_policy_probability(seat));
+    vector<int> pool_class(winnings_pool.size());
+    for (size_t i = 0; i < winnings_pool.size(); i++)
+        pool_class[i] = winnings_class(winnings_pool[i], class_bounds);
+
+    vector<ContestantCounts> stream_counts(num_threads, ContestantCounts(class_bounds, winnings_pool.size()));
+    TaskGroup streams;
+    for (int t = 0; t < num_threads; t++) {
+        long long games = num_simulations / num_threads + (t < num_simulations % num_threads);
+        streams.run([&, t, games]() {
+            seed_seq seeds{seed, (unsigned long long)t};
+            mt19937_64 rng(seeds);
+            uniform_int_distribution<size_t> draw(0, winnings_pool.size() - 1);
+            ContestantCounts& counts = stream_counts[t];
+            long long wins[3] = {0, 0, 0};
+            play_games(rules, tables, policies, games, rng, wins,
+                       [&](int, int, int, int, int, int winner) {
+                           // Play never depends on who is seated, so the contestants can be drawn after the game
+                           array<size_t, 3> drawn;
+                           array<long long, 3> winnings;
+                           for (int k = 0; k < 3; k++) {
+                               drawn[k] = draw(rng);
+                               winnings[k] = winnings_pool[drawn[k]];
+                           }
+                           const array<int, 3> order = spin_order(winnings);
+                           for (int seat = 0; seat < 3; seat++) {
+                               const size_t contestant = drawn[order[seat]];
+                               const int type = pool_class[contestant];
+                               counts.contestants[type]++;
+                               counts.seated[seat][type]++;
+                               counts.wins[type] += (seat == winner);
+                               counts.expected_wins[type] += seat_probability[seat];
+                               counts.games_by_contestant[contestant]++;
+                               counts.wins_by_contestant[contestant] += (seat == winner);
+                               counts.expected_by_contestant[contestant] += seat_probability[seat];
+                           }
+                       });
+        });
+    }
+    streams.wait();
+
+    ContestantCounts total = std::move(stream_counts[0]);
+    for (int t = 1; t < num_threads; t++)
+        total.add(stream_counts[t]);
+    return total;
+}
+
+
+// -- Instantiations --
+#define PIR_INSTANTIATE_SIMULATION(Num, Policies) \
+    template void simulate_batch<Num, Policies>(const GameRules&, const DpTables<Num>&, const Policies&, long long, \
+                                                mt19937_64&, long long[3]); \
+    template vector<Fraction> simulate_game<Num, Policies>(const GameRules&, const DpTables<Num>&, const Policies&, \
+                                                           long long, int, unsigned long long);
+
+#define PIR_INSTANTIATE_SIMULATOR(Num) \
+    PIR_INSTANTIATE_SIMULATION(Num, PolicySet<Num>) \
+    PIR_INSTANTIATE_SIMULATION(Num, OptimalPolicies<Num>) \
+    PIR_INSTANTIATE_SIMULATION(Num, ThresholdPolicies<Num>) \
+    template StateCounts simulate_state_counts<Num>(const GameRules&, const DpTables<Num>&, const PolicySet<Num>&, \
+                                                    long long, int, unsigned long long); \
+    template ContestantCounts simulate_contestants<Num>(const GameRules&, const DpTables<Num>&, \
+                                                        const PolicySet<Num>&, const vector<long long>&, \
+                                                        const vector<long long>&, long long, int, unsigned long long);
+
+PIR_INSTANTIATE_SIMULATOR(Fraction)
+PIR_INSTANTIATE_SIMULATOR(double)
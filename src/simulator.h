@@ -0,0 +1,117 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <ctime>
+#include <random>
+#include <vector>
+#include "dp_solver.h"
+
+
+// -- Simulate Game --
+// probabilistic decision: return true with probability prob
+bool random_decision(Fraction prob, std::mt19937_64& rng);
+bool random_decision(double prob, std::mt19937_64& rng);
+// ...a deterministic policy's choice (PolicyTraits in dp_solver.h): no draw
+inline bool random_decision(bool spin, std::mt19937_64&) { return spin; }
+
+// spin the wheel once: 1-segments uniformly
+int random_spin(int segments, std::mt19937_64& rng);
+
+// simulate num_simulations games with one random number stream, adding each player's wins to wins[0..2]
+// (tables are the solved tables the policies read)
+// NOTE: Policies is PolicySet or a compiled policy type (dp_solver.h, policies.h). Deterministic compiled policies
+//       don't draw for their decisions, so their games differ from the same policies' PolicySet games on one seed.
+template <class Num, class Policies>
+void simulate_batch(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const Policies& policies,
+    long long num_simulations,
+    std::mt19937_64& rng,
+    long long wins[3]);
+
+// simulation function that returns 3 fraction values Fraction[3]
+// NOTE: the games are split evenly over num_threads streams, stream i draws from its own generator seeded by (seed, i),
+//       so a (seed, num_threads) pair always reproduces the same result. The streams run as tasks on the shared
+//       thread pool (thread_pool.h), which decides how many run at once
+template <class Num, class Policies>
+std::vector<Fraction> simulate_game(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const Policies& policies,
+    long long num_simulations,
+    int num_threads = 1,
+    unsigned long long seed = time(0));
+
+// Simulated games counted by the state each player was in after their first spin, and who won from there
+// (the simulation side of the per-state checks in validation.h)
+struct StateCounts {
+    int scores = 0;
+    long long wins[3] = {0, 0, 0};
+    std::vector<long long> first_player_wins;  // [spin][winner]
+    std::vector<long long> second_player_wins; // [p1 total][spin][winner]
+    std::vector<long long> third_player_wins;  // [p1 total][p2 total][spin][winner]
+
+    StateCounts() = default;
+    explicit StateCounts(int scores)
+        : scores(scores), first_player_wins(scores * 3), second_player_wins(scores * scores * 3),
+          third_player_wins((size_t)scores * scores * scores * 3) {}
+
+    long long& first_player(int spin, int winner) { return first_player_wins[spin * 3 + winner]; }
+    long long& second_player(int p1, int spin, int winner) { return second_player_wins[(p1 * scores + spin) * 3 + winner]; }
+    long long& third_player(int p1, int p2, int spin, int winner) {
+        return third_player_wins[((size_t)(p1 * scores + p2) * scores + spin) * 3 + winner];
+    }
+
+    void add(const StateCounts& other) {
+        for (int k = 0; k < 3; k++)
+            wins[k] += other.wins[k];
+        for (size_t i = 0; i < first_player_wins.size(); i++) first_player_wins[i] += other.first_player_wins[i];
+        for (size_t i = 0; i < second_player_wins.size(); i++) second_player_wins[i] += other.second_player_wins[i];
+        for (size_t i = 0; i < third_player_wins.size(); i++) third_player_wins[i] += other.third_player_wins[i];
+    }
+};
+
+// Same games as simulate_game (same seed, same threads), counted per state
+template <class Num>
+StateCounts simulate_state_counts(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const PolicySet<Num>& policies,
+    long long num_simulations,
+    int num_threads,
+    unsigned long long seed);
+
+// Simulated games counted by contestant instead of by seat: each game draws three contestants from pool (with
+// replacement; a contestant is a pool index, i.e. one dataset contestant's pre-wheel winnings), seats them by
+// spin_order (least winnings spins first) and credits the outcome to each contestant, and to their winnings class.
+// expected_wins is the same sum from the seats' solved win probabilities, so nothing is re-solved per contestant.
+// The games draw the contestants from the same streams, so they are not the games of simulate_game with the same
+// seed.
+struct ContestantCounts {
+    std::vector<long long> class_bounds;           // winnings_class_bounds (episode.h)
+    std::vector<long long> contestants;            // [class] contestants seated
+    std::vector<long long> wins;                   // [class] ...who won
+    std::vector<double> expected_wins;             // [class] sum of their seats' win probabilities
+    std::vector<long long> seated[3];              // [seat][class] contestants of the class in that seat
+    std::vector<long long> games_by_contestant;    // [pool index] games the contestant was seated in
+    std::vector<long long> wins_by_contestant;     // [pool index] ...and won
+    std::vector<double> expected_by_contestant;    // [pool index] sum of their seats' win probabilities
+
+    ContestantCounts() = default;
+    ContestantCounts(std::vector<long long> bounds, size_t pool_size);
+    void add(const ContestantCounts& other);
+};
+
+template <class Num>
+ContestantCounts simulate_contestants(
+    const GameRules& rules,
+    const DpTables<Num>& tables,
+    const PolicySet<Num>& policies,
+    const std::vector<long long>& winnings_pool,
+    const std::vector<long long>& class_bounds,
+    long long num_simulations,
+    int num_threads,
+    unsigned long long seed);
+
+#endif // SIMULATOR_H
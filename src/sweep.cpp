@@ -0,0 +1,360 @@
+#include "sweep.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include "dp_solver.h"
+#include "instrumentation.h"
+#include "policies.h"
+#include "table_cache.h"
+#include "thread_pool.h"
+using namespace std;
+
+namespace {
+
+const char sweep_file_magic[8] = {'P', 'I', 'R', 'S', 'W', 'E', 'E', 'P'};
+const uint32_t byte_order_mark = 0x01020304;
+const uint64_t data_alignment = 64;
+
+struct SweepFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t spec_hash;     // FNV-1a of the spec text
+    uint32_t spec_size;
+    uint32_t record_size;   // sizeof(SweepRecord)
+    uint32_t variant_count;
+    uint32_t complete;      // 1: one solved record per variant, in variant order
+    uint64_t data_offset;   // multiple of data_alignment
+};
+
+uint64_t fnv1a(const string& text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+string trim(const string& text) {
+    const size_t begin = text.find_first_not_of(" \t\r");
+    return begin == string::npos ? "" : text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// "6, 10, 20..100 by 20" -> 6, 10, 20, 40, 60, 80, 100
+vector<int> parse_integers(const string& values, const string& where) {
+    auto number = [&](const string& text) {
+        size_t used = 0;
+        int value = -1;
+        try {
+            value = stoi(text, &used);
+        } catch (const exception&) {
+        }
+        if (text.empty() || used != text.size())
+            throw invalid_argument(where + "'" + text + "' isn't a whole number");
+        return value;
+    };
+    vector<int> result;
+    stringstream list(values);
+    for (string item; getline(list, item, ',');) {
+        item = trim(item);
+        const size_t range = item.find("..");
+        if (range == string::npos) {
+            result.push_back(number(item));
+            continue;
+        }
+        string last = trim(item.substr(range + 2)), step = "1";
+        if (const size_t by = last.find(" by "); by != string::npos) {
+            step = trim(last.substr(by + 4));
+            last = trim(last.substr(0, by));
+        }
+        const int from = number(trim(item.substr(0, range))), to = number(last), stride = number(step);
+        if (stride < 1 || to < from)
+            throw invalid_argument(where + "'" + item + "' is an empty range");
+        for (int value = from; value <= to; value += stride)
+            result.push_back(value);
+    }
+    return result;
+}
+
+vector<string> parse_names(const string& values, const string& where) {
+    vector<string> result;
+    stringstream list(values);
+    for (string item; getline(list, item, ',');) {
+        item = trim(item);
+        if (item.empty())
+            throw invalid_argument(where + "empty name");
+        result.push_back(item);
+    }
+    return result;
+}
+
+template <class Value>
+void check_distinct(vector<Value> values, const string& where) {
+    sort(values.begin(), values.end());
+    if (adjacent_find(values.begin(), values.end()) != values.end())
+        throw invalid_argument(where + "a value appears twice");
+}
+
+template <class Value>
+string join(const vector<Value>& values) {
+    ostringstream text;
+    for (size_t i = 0; i < values.size(); i++)
+        text << (i > 0 ? ", " : "") << values[i];
+    return text.str();
+}
+
+// -- Solving a variant --
+template <class Num>
+SweepRecord solve_variant(const GameRules& rules, const string& policy_name, const SweepOptions& options) {
+    using Traits = NumericTraits<Num>;
+    PolicySet<Num> policies = policies_by_name<Num>(policy_name, rules);
+    DpTables<Num> tables = options.cache_dir.empty() ? initialize_dp_tables(rules, policies)
+                                                     : load_or_solve(options.cache_dir, rules, policies);
+    SweepRecord record;
+    record.status = (uint8_t)SweepStatus::solved;
+    record.numeric = (uint8_t)Traits::kind;
+    for (int player = 0; player < 3; player++)
+        record.win_probability[player] = Traits::to_double(tables.first_player_policy_probability(player));
+
+    // Nobody spins again on the top score; go down while the player keeps staying
+    auto stays_from = [&](auto spin_probability) {
+        int total = rules.segments;
+        while (total > 1 && Traits::to_double(spin_probability(total - 1)) < 0.5)
+            total--;
+        return total;
+    };
+    record.stays_from[0] = stays_from([&](int total) { return policies.first_player(tables, total, 1); });
+    record.stays_from[1] = stays_from([&](int total) { return policies.second_player(tables, 0, total, 1); });
+    return record;
+}
+
+SweepRecord solve_variant(const SweepSpec& spec, size_t index, const SweepOptions& options) {
+    const SweepVariant variant = spec.variant(index);
+    GameRules rules;
+    rules.segments = variant.segments;
+    rules.spins_per_turn = variant.spins_per_turn;
+    SweepRecord record;
+    if (spec.numeric == NumericKind::floating || policy_needs_floating(variant.policy)) {
+        record = solve_variant<double>(rules, variant.policy, options);
+    } else {
+        try {
+            record = solve_variant<Fraction>(rules, variant.policy, options);
+        } catch (const overflow_error&) { // the wheel is too big for 64-bit Fractions
+            record = solve_variant<double>(rules, variant.policy, options);
+        }
+    }
+    record.variant = (uint32_t)index;
+    return record;
+}
+
+// -- Results file --
+// Header, spec text and padding up to the records
+void write_preamble(ostream& out, const SweepSpec& spec, bool complete) {
+    const string text = spec.to_text();
+    SweepFileHeader header{};
+    memcpy(header.magic, sweep_file_magic, sizeof(header.magic));
+    header.version = sweep_file_version;
+    header.byte_order = byte_order_mark;
+    header.spec_hash = fnv1a(text);
+    header.spec_size = text.size();
+    header.record_size = sizeof(SweepRecord);
+    header.variant_count = spec.variant_count();
+    header.complete = complete;
+    const uint64_t text_end = sizeof(header) + text.size();
+    header.data_offset = (text_end + data_alignment - 1) / data_alignment * data_alignment;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(text.data(), text.size());
+    const string padding(header.data_offset - text_end, '\0');
+    out.write(padding.data(), padding.size());
+}
+
+// Read path into results; data_end is where its last whole record ends
+SweepResults read_results(const string& path, uint64_t& data_end) {
+    ifstream in(path, ios::binary);
+    if (!in)
+        throw runtime_error("Can't read sweep results " + path);
+    SweepFileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || memcmp(header.magic, sweep_file_magic, sizeof(header.magic)) != 0)
+        throw runtime_error(path + " isn't a sweep results file");
+    if (header.version != sweep_file_version || header.byte_order != byte_order_mark
+        || header.record_size != sizeof(SweepRecord))
+        throw runtime_error(path + " was written by another version of the sweep");
+    string text(header.spec_size, '\0');
+    in.read(text.data(), text.size());
+    if (!in || fnv1a(text) != header.spec_hash)
+        throw runtime_error(path + " has a damaged spec");
+
+    SweepResults results;
+    results.spec = parse_sweep_spec(text);
+    if (results.spec.variant_count() != header.variant_count)
+        throw runtime_error(path + " has a damaged spec");
+    results.records.resize(header.variant_count);
+    results.complete = header.complete;
+    in.seekg(header.data_offset);
+    data_end = header.data_offset;
+    for (SweepRecord record; in.read(reinterpret_cast<char*>(&record), sizeof(record)); data_end += sizeof(record))
+        if (record.variant < results.records.size() && record.status != (uint8_t)SweepStatus::missing)
+            results.records[record.variant] = record;
+    return results;
+}
+
+} // namespace
+
+
+// -- Spec --
+SweepVariant SweepSpec::variant(size_t index) const {
+    const size_t policy = index % policies.size();
+    index /= policies.size();
+    const size_t spin = index % spins.size();
+    return {segments.at(index / spins.size()), spins[spin], policies[policy]};
+}
+
+string SweepSpec::to_text() const {
+    return "segments: " + join(segments) + "\nspins: " + join(spins) + "\npolicy: " + join(policies)
+           + "\nnumeric: " + (numeric == NumericKind::exact ? "exact" : "floating") + "\n";
+}
+
+SweepSpec parse_sweep_spec(const string& text) {
+    SweepSpec spec;
+    vector<string> seen;
+    stringstream lines(text);
+    int line_number = 0;
+    for (string line; getline(lines, line);) {
+        line_number++;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        const string where = "line " + to_string(line_number) + ": ";
+        const size_t colon = line.find(':');
+        if (colon == string::npos)
+            throw invalid_argument(where + "expected 'axis: values'");
+        const string axis = trim(line.substr(0, colon)), values = trim(line.substr(colon + 1));
+        if (find(seen.begin(), seen.end(), axis) != seen.end())
+            throw invalid_argument(where + axis + " is declared twice");
+        seen.push_back(axis);
+
+        if (axis == "segments" || axis == "spins") {
+            vector<int> numbers = parse_integers(values, where);
+            const int least = axis == "segments" ? 1 : 2;
+            for (int value : numbers)
+                if (value < least)
+                    throw invalid_argument(where + axis + " must be at least " + to_string(least));
+            check_distinct(numbers, where);
+            (axis == "segments" ? spec.segments : spec.spins) = numbers;
+        } else if (axis == "policy") {
+            spec.policies = parse_names(values, where);
+            check_distinct(spec.policies, where);
+        } else if (axis == "numeric") {
+            if (values != "exact" && values != "floating")
+                throw invalid_argument(where + "numeric is exact or floating");
+            spec.numeric = values == "exact" ? NumericKind::exact : NumericKind::floating;
+        } else {
+            throw invalid_argument(where + "the solver has no rule option '" + axis
+                                   + "' (axes: segments, spins, policy; setting: numeric)");
+        }
+    }
+    return spec;
+}
+
+SweepSpec load_sweep_spec(const string& path) {
+    ifstream file(path);
+    if (!file)
+        throw runtime_error("Can't read sweep spec " + path);
+    ostringstream text;
+    text << file.rdbuf();
+    try {
+        return parse_sweep_spec(text.str());
+    } catch (const invalid_argument& error) {
+        throw invalid_argument(path + " " + error.what());
+    }
+}
+
+
+// -- Running --
+SweepResults load_sweep_results(const string& path) {
+    uint64_t data_end;
+    return read_results(path, data_end);
+}
+
+SweepResults run_sweep(const SweepSpec& spec, const string& results_path, const SweepOptions& options) {
+    PIR_SCOPED_TIMER("run_sweep");
+    SweepResults results;
+    if (filesystem::exists(results_path)) {
+        uint64_t data_end;
+        results = read_results(results_path, data_end);
+        if (results.spec.to_text() != spec.to_text())
+            throw invalid_argument(results_path + " holds another sweep (delete it or write the results elsewhere)");
+        filesystem::resize_file(results_path, data_end); // drop a record cut off by an interruption
+    } else {
+        results.spec = spec;
+        results.records.resize(spec.variant_count());
+        ofstream out(results_path, ios::binary | ios::trunc);
+        if (!out)
+            throw runtime_error("Can't write sweep results " + results_path);
+        write_preamble(out, spec, false);
+    }
+    // A failed variant is tried again, like a missing one (its record is superseded by the new one)
+    for (const SweepRecord& record : results.records)
+        results.resumed += record.status == (uint8_t)SweepStatus::solved;
+    if (results.complete)
+        return results;
+
+    // Solve the variants that aren't solved yet, appending each record as it's done
+    {
+        ofstream out(results_path, ios::binary | ios::app);
+        if (!out)
+            throw runtime_error("Can't write sweep results " + results_path);
+        mutex lock;
+        TaskGroup variants;
+        for (size_t i = 0; i < results.records.size(); i++) {
+            if (results.records[i].status == (uint8_t)SweepStatus::solved)
+                continue;
+            variants.run([&, i]() {
+                SweepRecord record;
+                string error;
+                try {
+                    record = solve_variant(spec, i, options);
+                } catch (const exception& e) {
+                    record = SweepRecord();
+                    record.variant = (uint32_t)i;
+                    record.status = (uint8_t)SweepStatus::failed;
+                    error = e.what();
+                }
+                lock_guard<mutex> guard(lock);
+                out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+                out.flush();
+                results.records[i] = record;
+                if (error.empty())
+                    results.solved++;
+                else
+                    results.failures.push_back({(uint32_t)i, error});
+            });
+        }
+        variants.wait();
+        if (!out)
+            throw runtime_error("Failed writing sweep results " + results_path);
+    }
+    sort(results.failures.begin(), results.failures.end());
+
+    // Every variant is in: rewrite the file in variant order, complete only if none failed
+    const string temporary_path = results_path + ".tmp" + to_string(getpid());
+    {
+        ofstream out(temporary_path, ios::binary | ios::trunc);
+        if (!out)
+            throw runtime_error("Can't write sweep results " + temporary_path);
+        write_preamble(out, spec, results.failures.empty());
+        out.write(reinterpret_cast<const char*>(results.records.data()), results.records.size() * sizeof(SweepRecord));
+        if (!out)
+            throw runtime_error("Failed writing sweep results " + temporary_path);
+    }
+    filesystem::rename(temporary_path, results_path);
+    results.complete = results.failures.empty();
+    return results;
+}
@@ -0,0 +1,89 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "numeric.h"
+
+
+// --- Rule-variant sweeps ---
+// A sweep solves every combination of the rule options a spec declares, one line per axis:
+//
+//   # wheel sizes and spin limits against two policies
+//   segments: 6, 10, 20..100 by 20
+//   spins: 2, 3
+//   policy: optimal, threshold-13
+//   numeric: exact
+//
+// Axes: segments, spins (spins per turn) and policy; a missing axis takes the default (20, 2, optimal). "numeric"
+// (exact or floating) is a setting, not an axis. Exact variants whose Fractions overflow are solved floating, and
+// policies that need floating tables (qre-*) always are.
+//
+// The variants run as tasks on the shared thread pool (thread_pool.h) and each finished one is appended to the
+// results file at once, so an interrupted sweep resumes where it stopped. Once every variant is in, the file is
+// rewritten in variant order: record i then sits at data_offset + i * sizeof(SweepRecord). A variant that failed
+// (its error is only reported, not stored) leaves the sweep incomplete, and resuming it tries that variant again.
+//
+// Results file (native byte order): SweepFileHeader | spec text | padding to data_offset | SweepRecord...
+// The spec text is the canonical form of the spec (to_text), so a results file can be resumed or read on its own.
+const uint32_t sweep_file_version = 1;
+
+struct SweepVariant {
+    int segments;
+    int spins_per_turn;
+    std::string policy;
+};
+
+struct SweepSpec {
+    std::vector<int> segments = {20};
+    std::vector<int> spins = {2};
+    std::vector<std::string> policies = {"optimal"};
+    NumericKind numeric = NumericKind::exact;
+
+    size_t variant_count() const { return segments.size() * spins.size() * policies.size(); }
+    // Variant index runs over policies fastest, then spins, then segments
+    SweepVariant variant(size_t index) const;
+    std::string to_text() const;
+};
+
+// Parse a spec (throws std::invalid_argument "line N: ..." for errors)
+SweepSpec parse_sweep_spec(const std::string& text);
+SweepSpec load_sweep_spec(const std::string& path);
+
+enum class SweepStatus : uint8_t { missing = 0, solved = 1, failed = 2 };
+
+// One variant's results
+struct SweepRecord {
+    uint32_t variant = 0;
+    uint8_t status = 0;                     // SweepStatus
+    uint8_t numeric = 0;                    // NumericKind it was solved with
+    uint16_t reserved = 0;
+    int32_t stays_from[2] = {0, 0};         // lowest first-spin total from which player 1 / player 2 (player 1
+                                            // bust) stay on every higher total
+    double win_probability[3] = {0, 0, 0};
+};
+static_assert(sizeof(SweepRecord) == 40, "SweepRecord is stored as raw bytes");
+
+struct SweepResults {
+    SweepSpec spec;
+    std::vector<SweepRecord> records; // by variant (status missing if not solved yet)
+    bool complete = false;            // the file holds every variant solved, in order
+    size_t resumed = 0;               // run_sweep: variants already solved in the file
+    size_t solved = 0;                // ...solved by this run
+    std::vector<std::pair<uint32_t, std::string>> failures; // ...and the errors of the variants that failed
+};
+
+struct SweepOptions {
+    std::string cache_dir; // table cache for the solves (table_cache.h), empty: none
+};
+
+// Run the sweep into results_path, resuming from it if it exists (it must hold the same spec)
+SweepResults run_sweep(const SweepSpec& spec, const std::string& results_path, const SweepOptions& options = {});
+
+// Read a results file, finished or not (throws std::runtime_error if it isn't one)
+SweepResults load_sweep_results(const std::string& path);
+
+#endif // SWEEP_H
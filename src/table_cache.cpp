@@ -0,0 +1,183 @@
+#include "table_cache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+namespace {
+
+// The values are written and mapped as raw bytes
+static_assert(is_trivially_copyable_v<Fraction> && is_standard_layout_v<Fraction>
+              && sizeof(Fraction) == 2 * sizeof(long long), "Fraction must be a plain (numerator, denominator) pair");
+
+const char table_file_magic[8] = {'P', 'I', 'R', 'T', 'A', 'B', 'L', 'E'};
+const uint32_t byte_order_mark = 0x01020304;
+const uint64_t data_alignment = 64;
+
+struct TableFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t key_hash;
+    uint32_t value_kind; // NumericKind
+    uint32_t value_size; // bytes per value
+    uint32_t scores;
+    uint32_t options; // DpTables options (spins per turn)
+    uint32_t description_size;
+    uint32_t third_layout; // 0: 3rd player's options per class, 1: per (p1, p2) (dp_tables.h)
+    uint64_t value_count;
+    uint64_t data_offset; // multiple of data_alignment
+};
+
+uint64_t fnv1a(const string& text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// A read-only file mapped copy-on-write (writes through the tables stay private to this process)
+struct FileMapping {
+    void* address = MAP_FAILED;
+    size_t size = 0;
+    ~FileMapping() {
+        if (address != MAP_FAILED)
+            munmap(address, size);
+    }
+};
+
+} // namespace
+
+
+CacheKey table_cache_key(const GameRules& rules, const string& policy_name, NumericKind kind) {
+    string description = "pir-tables v" + to_string(table_file_version) + "; rules: " + rules.describe()
+                         + "; policies: " + policy_name
+                         + "; values: " + (kind == NumericKind::exact ? "exact" : "floating");
+    return {fnv1a(description), description};
+}
+
+string table_cache_path(const string& cache_dir, const CacheKey& key) {
+    char name[40];
+    snprintf(name, sizeof(name), "tables-%016llx.bin", (unsigned long long)key.hash);
+    return (filesystem::path(cache_dir) / name).string();
+}
+
+template <class Num>
+void save_tables(const string& path, const CacheKey& key, const DpTables<Num>& tables) {
+    PIR_SCOPED_TIMER("save_tables");
+    TableFileHeader header{};
+    memcpy(header.magic, table_file_magic, sizeof(header.magic));
+    header.version = table_file_version;
+    header.byte_order = byte_order_mark;
+    header.key_hash = key.hash;
+    header.value_kind = (uint32_t)NumericTraits<Num>::kind;
+    header.value_size = sizeof(Num);
+    header.scores = tables.scores();
+    header.options = tables.options();
+    header.description_size = key.description.size();
+    header.third_layout = tables.third_player_by_class() ? 0 : 1;
+    header.value_count = tables.size();
+    uint64_t text_end = sizeof(header) + key.description.size();
+    header.data_offset = (text_end + data_alignment - 1) / data_alignment * data_alignment;
+
+    // A fresh temporary file next to path (solves on several threads may save the same tables at once), renamed
+    // over path once complete
+    string temporary_path = path + ".tmp.XXXXXX";
+    int fd = mkstemp(temporary_path.data());
+    if (fd < 0)
+        throw runtime_error("Cannot write table cache file " + path + ": " + strerror(errno));
+    fchmod(fd, 0644);
+    close(fd);
+    try {
+        ofstream out(temporary_path, ios::binary | ios::trunc);
+        if (!out)
+            throw runtime_error("Cannot write table cache file " + temporary_path);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(key.description.data(), key.description.size());
+        string padding(header.data_offset - text_end, '\0');
+        out.write(padding.data(), padding.size());
+        out.write(reinterpret_cast<const char*>(tables.values()), tables.size() * sizeof(Num));
+        if (!out)
+            throw runtime_error("Failed writing table cache file " + temporary_path);
+        out.close();
+        filesystem::rename(temporary_path, path);
+    } catch (...) {
+        unlink(temporary_path.c_str());
+        throw;
+    }
+}
+
+template <class Num>
+DpTables<Num> load_tables(const string& path, const CacheKey& key) {
+    PIR_SCOPED_TIMER("load_tables");
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return {};
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TableFileHeader)) {
+        close(fd);
+        return {};
+    }
+    auto mapping = make_shared<FileMapping>();
+    mapping->size = info.st_size;
+    mapping->address = mmap(nullptr, mapping->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid
+    if (mapping->address == MAP_FAILED)
+        return {};
+
+    const char* base = static_cast<const char*>(mapping->address);
+    TableFileHeader header;
+    memcpy(&header, base, sizeof(header));
+    bool valid = memcmp(header.magic, table_file_magic, sizeof(header.magic)) == 0
+                 && header.version == table_file_version
+                 && header.byte_order == byte_order_mark
+                 && header.key_hash == key.hash
+                 && header.value_kind == (uint32_t)NumericTraits<Num>::kind
+                 && header.value_size == sizeof(Num)
+                 && header.third_layout <= 1
+                 && header.value_count == DpTables<Num>::value_count(header.scores, header.options, header.third_layout == 0)
+                 && header.data_offset % data_alignment == 0
+                 && sizeof(header) + header.description_size <= header.data_offset
+                 && header.data_offset + header.value_count * sizeof(Num) <= mapping->size
+                 && string(base + sizeof(header), header.description_size) == key.description;
+    if (!valid)
+        return {};
+
+    Num* values = reinterpret_cast<Num*>(static_cast<char*>(mapping->address) + header.data_offset);
+    return DpTables<Num>::view(header.scores, header.options, header.third_layout == 0, values, mapping);
+}
+
+template <class Num>
+DpTables<Num> load_or_solve(const string& cache_dir, const GameRules& rules, const PolicySet<Num>& policies) {
+    CacheKey key = table_cache_key(rules, policies.name, NumericTraits<Num>::kind);
+    string path = table_cache_path(cache_dir, key);
+    DpTables<Num> tables = load_tables<Num>(path, key);
+    if (!tables.empty())
+        return tables;
+
+    tables = initialize_dp_tables(rules, policies);
+    filesystem::create_directories(cache_dir);
+    save_tables(path, key, tables);
+    return tables;
+}
+
+
+// -- Instantiations --
+#define PIR_INSTANTIATE_TABLE_CACHE(Num) \
+    template void save_tables<Num>(const string&, const CacheKey&, const DpTables<Num>&); \
+    template DpTables<Num> load_tables<Num>(const string&, const CacheKey&); \
+    template DpTables<Num> load_or_solve<Num>(const string&, const GameRules&, const PolicySet<Num>&);
+
+PIR_INSTANTIATE_TABLE_CACHE(Fraction)
+PIR_INSTANTIATE_TABLE_CACHE(double)
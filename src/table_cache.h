@@ -0,0 +1,42 @@
+#ifndef TABLE_CACHE_H
+#define TABLE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include "dp_solver.h"
+
+
+// --- Table cache ---
+// Solved tables are saved to a versioned binary file named after a hash of everything the solve depends on
+// (rules, policies, number type). Loading memory-maps the file and the returned tables point straight into
+// the mapping, so a cache hit costs an open + mmap regardless of the table size.
+//
+// File layout (native byte order, checked on load):
+//   TableFileHeader | description text | padding to data_offset | values (DpTables layout, sizeof(Num) each)
+// Exact tables store each Fraction as its (numerator, denominator) pair of int64.
+const uint32_t table_file_version = 3;
+
+struct CacheKey {
+    uint64_t hash;           // FNV-1a of description
+    std::string description; // stored in the file too, so a hash collision is detected on load
+};
+
+CacheKey table_cache_key(const GameRules& rules, const std::string& policy_name, NumericKind kind);
+
+// File the tables for key are cached in
+std::string table_cache_path(const std::string& cache_dir, const CacheKey& key);
+
+// Write tables to path (through a temporary file + rename, so concurrent readers never see a partial file)
+template <class Num>
+void save_tables(const std::string& path, const CacheKey& key, const DpTables<Num>& tables);
+
+// Map the tables saved at path. Returns empty tables if the file is missing, was written by another version,
+// or holds a different key / number type.
+template <class Num>
+DpTables<Num> load_tables(const std::string& path, const CacheKey& key);
+
+// Load the tables for (rules, policies) from cache_dir, solving and saving them on a miss
+template <class Num>
+DpTables<Num> load_or_solve(const std::string& cache_dir, const GameRules& rules, const PolicySet<Num>& policies);
+
+#endif // TABLE_CACHE_H
@@ -0,0 +1,239 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <stdexcept>
+using namespace std;
+
+
+namespace {
+
+thread_local const ThreadPool* worker_pool = nullptr; // the pool the calling thread works for, if any
+thread_local int worker_index = -1;
+thread_local int task_depth = 0; // tasks running on this thread (> 1 while a task waits for a nested group)
+
+mutex shared_pool_lock;
+unique_ptr<ThreadPool> shared_pool;
+int shared_pool_threads = 0; // 0: $PIR_WORKERS, else hardware_concurrency
+
+long long elapsed_ns(chrono::steady_clock::time_point since) {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - since).count();
+}
+
+} // namespace
+
+
+// -- Pool --
+ThreadPool::ThreadPool(int threads) : started(chrono::steady_clock::now()) {
+    for (int i = 0; i + 1 < threads; i++)
+        workers.push_back(make_unique<Worker>());
+    // Workers start with every signal blocked, so process signals go to the callers' threads (the query daemon
+    // takes SIGINT / SIGTERM / SIGHUP through a signalfd on its own thread)
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (int i = 0; i < (int)workers.size(); i++)
+        workers[i]->thread = thread([this, i]() { worker_loop(i); });
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (unique_ptr<Worker>& worker : workers)
+        worker->thread.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    lock_guard<mutex> guard(shared_pool_lock);
+    if (!shared_pool) {
+        int threads = shared_pool_threads;
+        if (threads == 0) {
+            const char* workers = getenv("PIR_WORKERS"); // e.g. PIR_WORKERS=4
+            threads = workers ? atoi(workers) : (int)thread::hardware_concurrency();
+        }
+        shared_pool = make_unique<ThreadPool>(max(1, threads));
+    }
+    return *shared_pool;
+}
+
+void ThreadPool::set_shared_threads(int threads) {
+    lock_guard<mutex> guard(shared_pool_lock);
+    if (shared_pool)
+        throw logic_error("The shared thread pool is already running");
+    shared_pool_threads = max(1, threads);
+}
+
+int ThreadPool::current_worker() const {
+    return worker_pool == this ? worker_index : -1;
+}
+
+void ThreadPool::submit(Task task) {
+    const int self = current_worker();
+    Worker& queue = self >= 0 ? *workers[self] : injected;
+    {
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+    }
+    queued++;
+    {
+        lock_guard<mutex> guard(sleep_lock); // a sleeper checks queued under this lock: no lost wakeup
+    }
+    wake.notify_all();
+}
+
+bool ThreadPool::take(Task& task, int self) {
+    auto pop = [&](Worker& queue, bool back) {
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+            return false;
+        if (back) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    };
+    // Newest own task first (its data is warm), then the oldest injected one, then the oldest of another worker
+    if (self >= 0 && pop(*workers[self], true))
+        return true;
+    if (pop(injected, false))
+        return true;
+    const int n = (int)workers.size();
+    for (int k = 1; k <= n; k++) {
+        const int victim = (max(self, 0) + k) % n;
+        if (victim != self && pop(*workers[victim], false)) {
+            (self >= 0 ? *workers[self] : injected).steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(Task& task, Worker& slot) {
+    const auto start = chrono::steady_clock::now();
+    exception_ptr error;
+    task_depth++;
+    try {
+        task.body();
+    } catch (...) {
+        error = current_exception();
+    }
+    task_depth--;
+    slot.tasks_run++;
+    if (task_depth == 0) // an outer task already counts the time of the tasks it ran while waiting
+        slot.busy_ns += elapsed_ns(start);
+    task.body = nullptr; // release captures before the group can see it finished
+    task.group->finish_task(error);
+}
+
+void ThreadPool::worker_loop(int index) {
+    worker_pool = this;
+    worker_index = index;
+    while (true) {
+        Task task;
+        if (take(task, index)) {
+            execute(task, *workers[index]);
+            continue;
+        }
+        unique_lock<mutex> guard(sleep_lock);
+        wake.wait(guard, [&]() { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
+
+
+// -- Utilization --
+ThreadPool::Stats ThreadPool::stats() const {
+    Stats result;
+    result.seconds = elapsed_ns(started) * 1e-9;
+    auto add = [&](const string& name, const Worker& worker) {
+        const double busy = worker.busy_ns * 1e-9;
+        result.workers.push_back({name, worker.tasks_run, worker.steals, busy,
+                                  result.seconds > 0 ? busy / result.seconds : 0.0});
+    };
+    for (size_t i = 0; i < workers.size(); i++)
+        add("worker " + to_string(i + 1), *workers[i]);
+    add("callers", injected);
+    return result;
+}
+
+void ThreadPool::reset_stats() {
+    for (unique_ptr<Worker>& worker : workers) {
+        worker->tasks_run = 0;
+        worker->steals = 0;
+        worker->busy_ns = 0;
+    }
+    injected.tasks_run = 0;
+    injected.steals = 0;
+    injected.busy_ns = 0;
+    started = chrono::steady_clock::now();
+}
+
+void ThreadPool::print_stats(ostream& os) const {
+    const Stats current = stats();
+    os << "-- Thread pool (" << threads() << " threads, " << current.seconds << " s) --" << endl;
+    for (const WorkerStats& worker : current.workers)
+        os << left << setw(12) << worker.name << right << setw(10) << worker.tasks << " tasks" << setw(10)
+           << worker.steals << " stolen" << setw(12) << worker.busy_seconds * 1000 << " ms busy" << setw(8)
+           << fixed << setprecision(1) << 100 * worker.utilization << defaultfloat << setprecision(6) << " %"
+           << endl;
+}
+
+
+// -- Task group --
+TaskGroup::~TaskGroup() {
+    help_until_done();
+}
+
+void TaskGroup::run(function<void()> task) {
+    pending++;
+    pool.submit({std::move(task), this});
+}
+
+void TaskGroup::wait() {
+    help_until_done();
+    lock_guard<mutex> guard(error_lock);
+    if (error) {
+        exception_ptr thrown = error;
+        error = nullptr;
+        rethrow_exception(thrown);
+    }
+}
+
+void TaskGroup::finish_task(exception_ptr task_error) {
+    if (task_error) {
+        lock_guard<mutex> guard(error_lock);
+        if (!error)
+            error = task_error;
+    }
+    ThreadPool& owner = pool; // the group may be gone once pending reaches 0
+    if (--pending == 0) {
+        {
+            lock_guard<mutex> guard(owner.sleep_lock);
+        }
+        owner.wake.notify_all();
+    }
+}
+
+void TaskGroup::help_until_done() {
+    const int self = pool.current_worker();
+    ThreadPool::Worker& slot = self >= 0 ? *pool.workers[self] : pool.injected;
+    while (pending > 0) {
+        ThreadPool::Task task;
+        if (pool.take(task, self)) {
+            pool.execute(task, slot);
+            continue;
+        }
+        unique_lock<mutex> guard(pool.sleep_lock);
+        pool.wake.wait(guard, [&]() { return pending == 0 || pool.queued > 0; });
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// --- Thread pool ---
+// Work-stealing pool behind every parallel path (simulator streams, modular residues, solver stages, validation
+// configurations). Each worker owns a deque: it pushes and pops its own tasks at the back and idle workers steal
+// from the front. Tasks submitted from outside the pool go to a shared injection queue.
+//
+// A thread waiting for a TaskGroup runs queued tasks until its group is done instead of blocking, so nested
+// parallelism -- a sweep of solves as tasks, each solve splitting its stages into tasks -- keeps exactly threads()
+// threads busy: no thread is ever added for a nested level, and a waiting thread never idles while there is work.
+//
+// Results never depend on the pool size: callers split work into a fixed number of tasks (e.g. one simulator
+// stream per --threads, seeded by its index) and the pool only decides where they run.
+class TaskGroup;
+
+class ThreadPool {
+public:
+    // threads counts the caller: threads - 1 background workers are started (threads <= 1: run everything inline)
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // The pool the parallel paths use, started on first use: set_shared_threads, else $PIR_WORKERS, else
+    // hardware_concurrency threads
+    static ThreadPool& shared();
+    static void set_shared_threads(int threads); // throws std::logic_error once the shared pool exists
+
+    int threads() const { return (int)workers.size() + 1; }
+
+    // body(i) for every i in [begin, end), one task per index, returning when all are done (the first exception
+    // thrown by a body is rethrown)
+    template <class Body>
+    void parallel_for(int begin, int end, Body body);
+
+    // -- Utilization --
+    struct WorkerStats {
+        std::string name;     // "worker N", or "callers" for the threads outside the pool
+        long long tasks;      // tasks run
+        long long steals;     // ...of which taken from another worker's deque
+        double busy_seconds;  // time in tasks (nested tasks count once)
+        double utilization;   // busy_seconds / seconds
+    };
+    struct Stats {
+        double seconds; // since the pool started (or the last reset_stats)
+        std::vector<WorkerStats> workers;
+    };
+    Stats stats() const;
+    void reset_stats();
+    void print_stats(std::ostream& os) const;
+
+private:
+    friend class TaskGroup;
+    struct Task {
+        std::function<void()> body;
+        TaskGroup* group;
+    };
+    struct Worker {
+        std::mutex lock;
+        std::deque<Task> tasks;
+        std::atomic<long long> tasks_run{0};
+        std::atomic<long long> steals{0};
+        std::atomic<long long> busy_ns{0};
+        std::thread thread;
+    };
+
+    void submit(Task task);
+    bool take(Task& task, int self);       // own deque, then the injection queue, then steal
+    void execute(Task& task, Worker& slot);
+    void worker_loop(int index);
+    int current_worker() const;            // index of the calling worker of this pool, -1 for other threads
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    Worker injected; // tasks from outside the pool; its counters are the callers' share of the work
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<long long> queued{0};
+    bool stopping = false;
+    std::chrono::steady_clock::time_point started;
+};
+
+// Tasks that are waited for together
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::shared()) : pool(pool) {}
+    ~TaskGroup(); // waits (without rethrowing)
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    // Run queued tasks until every task of the group has finished, then rethrow the first exception one threw
+    void wait();
+
+private:
+    friend class ThreadPool;
+    void finish_task(std::exception_ptr error);
+    void help_until_done();
+
+    ThreadPool& pool;
+    std::atomic<long long> pending{0};
+    std::mutex error_lock;
+    std::exception_ptr error;
+};
+
+
+template <class Body>
+void ThreadPool::parallel_for(int begin, int end, Body body) {
+    if (threads() == 1 || end - begin <= 1) {
+        for (int i = begin; i < end; i++)
+            body(i);
+        return;
+    }
+    TaskGroup group(*this);
+    for (int i = begin; i < end; i++)
+        group.run([&body, i]() { body(i); });
+    group.wait();
+}
+
+#endif // THREAD_POOL_H
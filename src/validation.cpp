@@ -0,0 +1,184 @@
+#include "validation.h"
+#include <cmath>
+#include <limits>
+#include "instrumentation.h"
+#include "simulator.h"
+using namespace std;
+
+
+// -- Chi-square distribution --
+namespace {
+
+// lgamma writes the global signgam, and validation configurations run in parallel (thread_pool.h): the reentrant
+// lgamma_r returns the sign instead
+double log_gamma(double a) {
+    int sign;
+    return lgamma_r(a, &sign);
+}
+
+// Regularized upper incomplete gamma function Q(a, x) = 1 - P(a, x): the series for P below x < a + 1, the
+// continued fraction for Q above (Numerical Recipes 6.2)
+double upper_incomplete_gamma(double a, double x) {
+    if (x <= 0)
+        return 1;
+    const double log_prefactor = -x + a * log(x) - log_gamma(a);
+    const double epsilon = 1e-15;
+    if (x < a + 1) {
+        double term = 1 / a, sum = term;
+        for (int n = 1; n < 10000 && fabs(term) > fabs(sum) * epsilon; n++) {
+            term *= x / (a + n);
+            sum += term;
+        }
+        return max(0.0, 1 - sum * exp(log_prefactor));
+    }
+    // Lentz's method
+    const double tiny = numeric_limits<double>::min() / epsilon;
+    double b = x + 1 - a, c = 1 / tiny, d = 1 / b, h = d;
+    for (int n = 1; n < 10000; n++) {
+        double an = -n * (n - a);
+        b += 2;
+        d = an * d + b;
+        if (fabs(d) < tiny)
+            d = tiny;
+        c = b + an / c;
+        if (fabs(c) < tiny)
+            c = tiny;
+        d = 1 / d;
+        double delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1) < epsilon)
+            break;
+    }
+    return min(1.0, h * exp(log_prefactor));
+}
+
+} // namespace
+
+double chi_square_p_value(double statistic, int degrees_of_freedom) {
+    if (degrees_of_freedom < 1)
+        return 1;
+    return upper_incomplete_gamma(degrees_of_freedom / 2.0, statistic / 2);
+}
+
+GoodnessOfFit goodness_of_fit(const long long* observed, const double* expected, int categories) {
+    GoodnessOfFit fit;
+    long long total = 0;
+    for (int k = 0; k < categories; k++)
+        total += observed[k];
+    int possible = 0;
+    for (int k = 0; k < categories; k++) {
+        if (expected[k] <= 0) {
+            if (observed[k] > 0) { // impossible outcome observed
+                fit.statistic = numeric_limits<double>::infinity();
+                fit.p_value = 0;
+            }
+            continue;
+        }
+        possible++;
+        double expected_count = expected[k] * total;
+        fit.statistic += (observed[k] - expected_count) * (observed[k] - expected_count) / expected_count;
+    }
+    fit.degrees_of_freedom = max(0, possible - 1);
+    if (fit.p_value > 0)
+        fit.p_value = chi_square_p_value(fit.statistic, fit.degrees_of_freedom);
+    return fit;
+}
+
+
+// -- DP vs simulation --
+namespace {
+
+// Add one state's test to its stage (skipped when some possible outcome is expected fewer than min_expected times)
+void add_state(StageFit& stage, const long long observed[3], const double expected[3], double min_expected,
+               const string& state) {
+    long long count = observed[0] + observed[1] + observed[2];
+    if (count == 0)
+        return;
+    for (int k = 0; k < 3; k++) {
+        if (expected[k] > 0 && expected[k] * count < min_expected) {
+            stage.states_skipped++;
+            return;
+        }
+    }
+    GoodnessOfFit fit = goodness_of_fit(observed, expected, 3);
+    stage.states_tested++;
+    stage.combined.statistic += fit.statistic;
+    stage.combined.degrees_of_freedom += fit.degrees_of_freedom;
+    if (fit.degrees_of_freedom > 0 || fit.p_value == 0) {
+        if (fit.p_value < stage.min_p_value || stage.worst_state.empty()) {
+            stage.min_p_value = fit.p_value;
+            stage.worst_state = state;
+        }
+    }
+}
+
+void finish_stage(StageFit& stage) {
+    stage.combined.p_value = isinf(stage.combined.statistic)
+                                 ? 0
+                                 : chi_square_p_value(stage.combined.statistic, stage.combined.degrees_of_freedom);
+    stage.bonferroni_p_value = min(1.0, stage.min_p_value * (double)max<long long>(1, stage.states_tested));
+}
+
+} // namespace
+
+template <class Num>
+ValidationResult validate_against_simulation(const GameRules& rules, const DpTables<Num>& tables,
+                                             const PolicySet<Num>& policies, long long games, int threads,
+                                             unsigned long long seed, double min_expected)
+{
+    PIR_SCOPED_TIMER("validate_against_simulation");
+    StateCounts counts = simulate_state_counts(rules, tables, policies, games, threads, seed);
+
+    ValidationResult result;
+    result.games = games;
+    for (int k = 0; k < 3; k++) {
+        result.simulated_wins[k] = counts.wins[k];
+        result.expected_wins[k] = NumericTraits<Num>::to_double(tables.first_player_policy_probability(k));
+    }
+    result.overall = goodness_of_fit(result.simulated_wins, result.expected_wins, 3);
+
+    const int segments = rules.segments;
+    auto state_probabilities = [&](int player, int p1, int p2, int spin, double expected[3]) {
+        for (int k = 0; k < 3; k++)
+            expected[k] = NumericTraits<Num>::to_double(
+                policy_state_probability(tables, rules, policies, player, p1, p2, spin, k));
+    };
+    double expected[3];
+    for (int spin = 1; spin <= segments; spin++) {
+        state_probabilities(1, 0, 0, spin, expected);
+        add_state(result.stages[0], &counts.first_player(spin, 0), expected, min_expected,
+                  "spin=" + to_string(spin));
+    }
+    for (int p1 = 0; p1 <= segments; p1++) {
+        for (int spin = 1; spin <= segments; spin++) {
+            state_probabilities(2, p1, 0, spin, expected);
+            add_state(result.stages[1], &counts.second_player(p1, spin, 0), expected, min_expected,
+                      "p1=" + to_string(p1) + " spin=" + to_string(spin));
+        }
+    }
+    for (int p1 = 0; p1 <= segments; p1++) {
+        for (int p2 = 0; p2 <= segments; p2++) {
+            for (int spin = 1; spin <= segments; spin++) {
+                if (counts.third_player(p1, p2, spin, 0) + counts.third_player(p1, p2, spin, 1) +
+                        counts.third_player(p1, p2, spin, 2) == 0)
+                    continue; // not reached: skip the (exact) table lookups
+                state_probabilities(3, p1, p2, spin, expected);
+                add_state(result.stages[2], &counts.third_player(p1, p2, spin, 0), expected, min_expected,
+                          "p1=" + to_string(p1) + " p2=" + to_string(p2) + " spin=" + to_string(spin));
+            }
+        }
+    }
+    for (StageFit& stage : result.stages)
+        finish_stage(stage);
+    return result;
+}
+
+
+// -- Instantiations --
+#define PIR_INSTANTIATE_VALIDATION(Num) \
+    template ValidationResult validate_against_simulation<Num>(const GameRules&, const DpTables<Num>&, \
+                                                               const PolicySet<Num>&, long long, int, \
+                                                               unsigned long long, double);
+
+PIR_INSTANTIATE_VALIDATION(Fraction)
+PIR_INSTANTIATE_VALIDATION(double)
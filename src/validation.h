@@ -0,0 +1,51 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include <string>
+#include <vector>
+#include "dp_solver.h"
+
+
+// --- Validation ---
+// Statistical regression checks of the solver against the simulator: simulated games should be a sample from
+// the distribution the tables describe, both overall (who wins) and from every decision state a player reaches.
+
+// P(X >= statistic) for X chi-square distributed with degrees_of_freedom (1 when degrees_of_freedom < 1)
+double chi_square_p_value(double statistic, int degrees_of_freedom);
+
+// Pearson chi-square goodness-of-fit of observed counts against expected probabilities
+struct GoodnessOfFit {
+    double statistic = 0;
+    int degrees_of_freedom = 0;
+    double p_value = 1;
+};
+
+// Categories with expected probability 0 don't count towards the degrees of freedom; observing one gives
+// p_value 0 (the tables say it can't happen)
+GoodnessOfFit goodness_of_fit(const long long* observed, const double* expected, int categories);
+
+// One stage: the per-state tests of one player's states, combined
+struct StageFit {
+    GoodnessOfFit combined;        // summed statistics and degrees of freedom of the tested states
+    long long states_tested = 0;   // states where every possible outcome had an expected count >= min_expected
+    long long states_skipped = 0;  // reached, but too rarely to test
+    double min_p_value = 1;        // the worst state...
+    double bonferroni_p_value = 1; // ...corrected for the number of states tested
+    std::string worst_state;       // "p1=.. p2=.. spin=.."
+};
+
+struct ValidationResult {
+    long long games = 0;
+    long long simulated_wins[3] = {0, 0, 0};
+    double expected_wins[3] = {0, 0, 0}; // probabilities
+    GoodnessOfFit overall;               // the three win rates
+    StageFit stages[3];                  // states after the first, second, third player's first spin
+};
+
+// Simulate games (seeded, split over threads as in simulate_game) and test them against the tables
+template <class Num>
+ValidationResult validate_against_simulation(const GameRules& rules, const DpTables<Num>& tables,
+                                             const PolicySet<Num>& policies, long long games, int threads,
+                                             unsigned long long seed, double min_expected = 5);
+
+#endif // VALIDATION_H
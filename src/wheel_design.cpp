@@ -0,0 +1,127 @@
+#include "wheel_design.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "dp_solver.h"
+#include "dual.h"
+#include "instrumentation.h"
+#include "policies.h"
+using namespace std;
+
+vector<double> project_to_wheel(vector<double> probabilities, double min_probability) {
+    const int n = probabilities.size();
+    const double mass = 1 - n * min_probability; // to spread above the lower bounds
+    if (n == 0 || mass < 0)
+        throw invalid_argument("No wheel has every segment at least " + to_string(min_probability));
+    // Projection onto the simplex of total mass: subtract the threshold theta that leaves mass above zero
+    vector<double> sorted = probabilities;
+    sort(sorted.rbegin(), sorted.rend());
+    double sum = 0, theta = 0;
+    for (int i = 0; i < n; i++) {
+        sum += sorted[i] - min_probability;
+        const double candidate = (sum - mass) / (i + 1);
+        if (i == n - 1 || sorted[i + 1] - min_probability <= candidate) {
+            theta = candidate;
+            break;
+        }
+    }
+    for (double& probability : probabilities)
+        probability = min_probability + max(probability - min_probability - theta, 0.0);
+    return probabilities;
+}
+
+WheelDesign design_wheel(const GameRules& rules, const string& policy_name, const WheelDesignOptions& options) {
+    PIR_SCOPED_TIMER("design_wheel");
+    if (policy_needs_floating(policy_name))
+        throw invalid_argument("Wheel design works with the optimal and threshold-K policies");
+    const int segments = rules.segments;
+    if (segments > Dual::gradient_size)
+        throw invalid_argument("Wheel design needs " + to_string(Dual::gradient_size) + " segments or less");
+    const PolicySet<double> policies = policies_by_name<double>(policy_name, rules);
+    const PolicySet<Dual> dual_policies = policies_by_name<Dual>(policy_name, rules);
+
+    GameRules wheel = rules;
+    vector<double> start = !options.start.empty() ? options.start : rules.uniform_wheel()
+                               ? vector<double>(segments, 1.0 / segments) : rules.segment_probabilities;
+    if ((int)start.size() != segments)
+        throw invalid_argument("The start wheel needs one probability per segment");
+    wheel.segment_probabilities = project_to_wheel(start, options.min_probability);
+
+    WheelDesign design;
+    DpTables<double> tables = DpTables<double>::allocate(rules.scores(), rules.spins_per_turn);
+    DpTables<Dual> dual_tables = DpTables<Dual>::allocate(rules.scores(), rules.spins_per_turn);
+    auto loss_of = [&](const array<double, 3>& win, double& max_error) {
+        double loss = 0;
+        max_error = 0;
+        for (int k = 0; k < 3; k++) {
+            loss += 0.5 * (win[k] - options.target[k]) * (win[k] - options.target[k]);
+            max_error = max(max_error, abs(win[k] - options.target[k]));
+        }
+        return loss;
+    };
+
+    // The loss and its gradient at wheel (dual solve)
+    array<double, 3> win;
+    vector<double> gradient(segments);
+    double loss = 0, max_error = 0;
+    auto differentiate = [&]() {
+        solve_dp_tables(dual_tables, wheel, dual_policies);
+        design.solves++;
+        for (int k = 0; k < 3; k++)
+            win[k] = dual_tables.first_player_policy_probability(k).value;
+        loss = loss_of(win, max_error);
+        fill(gradient.begin(), gradient.end(), 0.0);
+        for (int k = 0; k < 3; k++)
+            for (int v = 0; v < segments; v++)
+                gradient[v] += (win[k] - options.target[k]) * dual_tables.first_player_policy_probability(k).gradient[v];
+    };
+    differentiate();
+
+    double step = 1;
+    GameRules candidate = wheel;
+    for (design.iterations = 0; design.iterations < options.max_iterations && max_error > options.tolerance;) {
+        // Backtracking: the projected step must decrease the loss at least as much as its quadratic model promises
+        bool accepted = false;
+        for (; step > 1e-12; step *= 0.5) {
+            vector<double> moved(segments);
+            for (int v = 0; v < segments; v++)
+                moved[v] = wheel.segment_probabilities[v] - step * gradient[v];
+            candidate.segment_probabilities = project_to_wheel(moved, options.min_probability);
+            double decrease = 0, distance = 0;
+            for (int v = 0; v < segments; v++) {
+                const double delta = candidate.segment_probabilities[v] - wheel.segment_probabilities[v];
+                decrease += gradient[v] * delta;
+                distance += delta * delta;
+            }
+            if (distance == 0) // a stationary point of the constrained problem
+                break;
+            solve_dp_tables(tables, candidate, policies);
+            design.solves++;
+            array<double, 3> candidate_win;
+            for (int k = 0; k < 3; k++)
+                candidate_win[k] = tables.first_player_policy_probability(k);
+            double candidate_error;
+            if (loss_of(candidate_win, candidate_error) <= loss + decrease + distance / (2 * step)) {
+                accepted = true;
+                break;
+            }
+        }
+        if (!accepted)
+            break;
+        swap(wheel.segment_probabilities, candidate.segment_probabilities);
+        const double previous_loss = loss;
+        differentiate();
+        design.iterations++;
+        design.history.push_back({design.iterations, loss, max_error, step});
+        if (previous_loss - loss <= 1e-12 * previous_loss) // stuck, e.g. on a kink where a decision flips
+            break;
+        step *= 2; // warm start: try a longer step next time
+    }
+
+    design.probabilities = wheel.segment_probabilities;
+    design.win_probability = win;
+    design.loss = loss;
+    design.max_error = max_error;
+    design.converged = max_error <= options.tolerance;
+    return design;
+}
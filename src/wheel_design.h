@@ -0,0 +1,50 @@
+#ifndef WHEEL_DESIGN_H
+#define WHEEL_DESIGN_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include "game_rules.h"
+
+
+// --- Wheel design ---
+// Inverse design: the segment probabilities that give the three positions target win probabilities (equal by
+// default), with the policies re-optimized for every wheel tried. Projected gradient descent on
+//   loss = 1/2 sum_k (win_k - target_k)^2
+// over the wheels with every segment at least min_probability: the gradient comes from one solve over dual numbers
+// (dual.h), a backtracking line search tries steps with floating solves, and each accepted step is projected back
+// onto the allowed wheels. The solves reuse one set of tables each (solve_dp_tables), and the step length carries
+// over from one iteration to the next.
+struct WheelDesignOptions {
+    std::array<double, 3> target = {1.0 / 3, 1.0 / 3, 1.0 / 3};
+    std::vector<double> start;      // initial wheel (empty: the rules' wheel)
+    double min_probability = 0.005; // lower bound of every segment's probability
+    int max_iterations = 200;
+    double tolerance = 1e-6;        // done once every win probability is this close to its target
+};
+
+struct WheelDesignStep {
+    int iteration = 0;
+    double loss = 0;
+    double max_error = 0; // largest |win_k - target_k|
+    double step = 0;      // accepted step length
+};
+
+struct WheelDesign {
+    std::vector<double> probabilities; // the best wheel found
+    std::array<double, 3> win_probability = {0, 0, 0};
+    double loss = 0;
+    double max_error = 0;
+    int iterations = 0;
+    int solves = 0;         // floating and dual solves together
+    bool converged = false; // max_error <= tolerance
+    std::vector<WheelDesignStep> history;
+};
+
+// Policies by name (optimal or threshold-K); wheels of up to Dual::gradient_size segments
+WheelDesign design_wheel(const GameRules& rules, const std::string& policy_name, const WheelDesignOptions& options);
+
+// Closest wheel (Euclidean) to probabilities with every entry at least min_probability
+std::vector<double> project_to_wheel(std::vector<double> probabilities, double min_probability);
+
+#endif // WHEEL_DESIGN_H
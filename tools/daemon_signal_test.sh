@@ -0,0 +1,44 @@
+#!/bin/sh
+# Query daemon signals with a multi-worker thread pool (the daemon_signals ctest test): SIGHUP reloads the table
+# set, SIGTERM shuts down cleanly -- exit 0, stats printed, socket removed.
+#
+# Usage: daemon_signal_test.sh PATH/TO/price_is_right
+program=$1
+dir=$(mktemp -d)
+socket=$dir/pir.sock
+log=$dir/daemon.log
+
+"$program" daemon --workers 4 --socket "$socket" 2>"$log" &
+pid=$!
+
+fail() {
+    echo "FAIL: $1"
+    cat "$log"
+    kill -KILL "$pid" 2>/dev/null
+    rm -rf "$dir"
+    exit 1
+}
+
+# Wait (up to 30 s) for a line in the log
+wait_for() {
+    tries=0
+    until grep -q "$1" "$log"; do
+        kill -0 "$pid" 2>/dev/null || fail "daemon exited while waiting for '$1'"
+        tries=$((tries + 1))
+        [ "$tries" -gt 300 ] && fail "timed out waiting for '$1'"
+        sleep 0.1
+    done
+}
+
+wait_for "listening on"
+kill -HUP "$pid"
+wait_for "generation 2"
+kill -0 "$pid" 2>/dev/null || fail "SIGHUP killed the daemon"
+kill -TERM "$pid"
+wait "$pid"
+status=$?
+[ "$status" -eq 0 ] || fail "daemon exited with status $status after SIGTERM"
+grep -q "requests in" "$log" || fail "no stats after SIGTERM"
+[ -e "$socket" ] && fail "socket file left behind"
+rm -rf "$dir"
+echo "passed"
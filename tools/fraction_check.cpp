@@ -0,0 +1,407 @@
+// Randomized property and differential tests for Fraction (and any future rational backend)
+//
+// Usage: pir_fraction_check [--iterations N] [--seed N] [--min-time SECONDS]
+//
+// Every result is compared with an exact reference rational built on BigInt (src/big_int.h):
+//   construction  Fraction(n, d) / set(n, d) give the reference value in lowest terms with a positive
+//                 denominator, or throw std::overflow_error exactly when that doesn't fit in long long
+//   arithmetic    + - * / give the reference result, or throw std::overflow_error exactly when it doesn't fit;
+//                 division by zero throws
+//   ordering      <=> and == agree with the reference for any two fractions (no cross-multiplication overflow),
+//                 and sorting with them gives the reference order
+//   field axioms  commutativity, associativity, distributivity, identities and inverses (an identity whose sides
+//                 overflow is skipped, the differential checks already cover that)
+// Operands are drawn from small, medium, full-range, edge (0, +-1, LLONG_MIN, LLONG_MAX, ...) and smooth
+// (many small prime factors, so large gcds) values. Afterwards the operation throughput is reported.
+// Exit code 1 if any check failed. A new backend is checked by adding it to main next to Fraction.
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "big_int.h"
+#include "fraction.h"
+using namespace std;
+
+
+// -- Reference rationals --
+struct Rational {
+    BigInt num;
+    BigInt den; // > 0, gcd(|num|, den) == 1
+
+    Rational(BigInt n, BigInt d) {
+        if (d.sign() < 0) {
+            n = -n;
+            d = -d;
+        }
+        BigInt g = BigInt::gcd(n, d);
+        num = n / g;
+        den = d / g;
+    }
+
+    bool fits() const { return num.fits_long_long() && den.fits_long_long(); }
+    string to_string() const { return num.to_string() + "/" + den.to_string(); }
+
+    friend Rational operator+(const Rational& a, const Rational& b) { return {a.num * b.den + b.num * a.den, a.den * b.den}; }
+    friend Rational operator-(const Rational& a, const Rational& b) { return {a.num * b.den - b.num * a.den, a.den * b.den}; }
+    friend Rational operator*(const Rational& a, const Rational& b) { return {a.num * b.num, a.den * b.den}; }
+    friend Rational operator/(const Rational& a, const Rational& b) { return {a.num * b.den, a.den * b.num}; }
+    friend strong_ordering operator<=>(const Rational& a, const Rational& b) { return a.num * b.den <=> b.num * a.den; }
+};
+
+template <class Frac>
+Rational reference(const Frac& value) {
+    return {BigInt(value.getNumerator()), BigInt(value.getDenominator())};
+}
+
+template <class Frac>
+string text(const Frac& value) {
+    return to_string(value.getNumerator()) + "/" + to_string(value.getDenominator());
+}
+
+template <class Frac>
+string operands_text(const Frac& a, const Frac& b) {
+    ostringstream os;
+    os << "(" << text(a) << ", " << text(b) << ")";
+    return os.str();
+}
+
+
+// -- Operand generators --
+class Operands {
+public:
+    explicit Operands(unsigned long long seed) : rng(seed) {}
+
+    long long integer() {
+        switch (uniform_int_distribution<int>(0, 4)(rng)) {
+        case 0: return uniform_int_distribution<long long>(-50, 50)(rng);
+        case 1: return uniform_int_distribution<long long>(-(1ll << 31), 1ll << 31)(rng);
+        case 2: return (long long)rng(); // full range
+        case 3: return edge_values[uniform_int_distribution<size_t>(0, edge_values.size() - 1)(rng)];
+        default: return smooth();
+        }
+    }
+    long long nonzero() {
+        long long value;
+        do value = integer(); while (value == 0);
+        return value;
+    }
+    long long small() { return uniform_int_distribution<long long>(-1000, 1000)(rng); }
+    long long small_nonzero() {
+        long long value;
+        do value = small(); while (value == 0);
+        return value;
+    }
+
+    // A fraction that could be constructed (numerator and denominator drawn separately, reduced by the constructor)
+    template <class Frac>
+    Frac fraction() {
+        while (true) {
+            try {
+                return Frac(integer(), nonzero());
+            } catch (const overflow_error&) {
+                // e.g. LLONG_MIN / -1, draw again
+            }
+        }
+    }
+    // Small operands for the field axioms (mostly no overflow in any intermediate)
+    template <class Frac>
+    Frac small_fraction() { return Frac(small(), small_nonzero()); }
+
+private:
+    mt19937_64 rng;
+    const vector<long long> edge_values = {0, 1, -1, 2, -2, LLONG_MAX, LLONG_MIN, LLONG_MAX - 1, LLONG_MIN + 1,
+                                           1ll << 62, -(1ll << 62), 3037000499ll, -3037000499ll, 4294967296ll};
+
+    // Product of small primes (big common factors between operands)
+    long long smooth() {
+        static const int primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31};
+        long long value = 1;
+        int factors = uniform_int_distribution<int>(1, 40)(rng);
+        for (int i = 0; i < factors; i++) {
+            int prime = primes[uniform_int_distribution<int>(0, 10)(rng)];
+            if (value > LLONG_MAX / prime)
+                break;
+            value *= prime;
+        }
+        return (rng() & 1) ? -value : value;
+    }
+};
+
+
+// -- Checks --
+struct CheckResults {
+    map<string, long long> checks, failures, skipped;
+    int printed = 0;
+
+    void pass(const string& property) { checks[property]++; }
+    void skip(const string& property) { skipped[property]++; }
+    void fail(const string& property, const string& detail) {
+        checks[property]++;
+        failures[property]++;
+        if (printed++ < 20)
+            cout << "FAIL " << property << ": " << detail << endl;
+    }
+    long long total_failures() const {
+        long long total = 0;
+        for (const auto& [property, count] : failures)
+            total += count;
+        return total;
+    }
+};
+
+// The value an operation produced: a fraction, or the fact that it threw overflow_error / another error
+template <class Frac>
+struct Outcome {
+    optional<Frac> value;
+    bool overflow = false;
+    bool other_error = false;
+};
+
+template <class Frac>
+Outcome<Frac> attempt(const function<Frac()>& operation) {
+    Outcome<Frac> outcome;
+    try {
+        outcome.value = operation();
+    } catch (const overflow_error&) {
+        outcome.overflow = true;
+    } catch (const exception&) {
+        outcome.other_error = true;
+    }
+    return outcome;
+}
+
+// value is the expected reference result in lowest terms with a positive denominator, or overflow if expected doesn't fit
+template <class Frac>
+void expect(CheckResults& results, const string& property, const Outcome<Frac>& outcome, const Rational& expected,
+            const string& operation) {
+    if (!expected.fits()) {
+        if (outcome.overflow)
+            results.pass(property);
+        else
+            results.fail(property, operation + " should overflow (exact " + expected.to_string() + "), got "
+                                       + (outcome.value ? text(*outcome.value) : string("another error")));
+        return;
+    }
+    if (!outcome.value) {
+        results.fail(property, operation + " threw, expected " + expected.to_string());
+        return;
+    }
+    const Frac& value = *outcome.value;
+    if (value.getDenominator() <= 0 || BigInt::gcd(value.getNumerator(), value.getDenominator()) != BigInt(1)
+        || (value.getNumerator() == 0 && value.getDenominator() != 1))
+        results.fail(property, operation + " = " + text(value) + " is not in lowest terms");
+    else if (BigInt(value.getNumerator()) != expected.num || BigInt(value.getDenominator()) != expected.den)
+        results.fail(property, operation + " = " + text(value) + ", expected " + expected.to_string());
+    else
+        results.pass(property);
+}
+
+template <class Frac>
+void check_construction(CheckResults& results, Operands& operands, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        long long n = operands.integer(), d = operands.nonzero();
+        string operation = "Fraction(" + to_string(n) + ", " + to_string(d) + ")";
+        Rational expected{BigInt(n), BigInt(d)};
+        expect<Frac>(results, "construct", attempt<Frac>([&]() { return Frac(n, d); }), expected, operation);
+        expect<Frac>(results, "set", attempt<Frac>([&]() { Frac f; f.set(n, d); return f; }), expected, operation);
+
+        Outcome<Frac> zero_denominator = attempt<Frac>([&]() { return Frac(n, 0); });
+        if (zero_denominator.value || zero_denominator.overflow)
+            results.fail("zero_denominator", "Fraction(" + to_string(n) + ", 0) didn't throw");
+        else
+            results.pass("zero_denominator");
+
+        if (Outcome<Frac> made = attempt<Frac>([&]() { return Frac(n, d); }); made.value) {
+            ostringstream os;
+            os << *made.value;
+            string wanted = (made.value->getDenominator() == 1) ? to_string(made.value->getNumerator()) : text(*made.value);
+            if (os.str() == wanted)
+                results.pass("output");
+            else
+                results.fail("output", "printed " + os.str() + " for " + text(*made.value));
+        }
+    }
+}
+
+template <class Frac>
+void check_arithmetic(CheckResults& results, Operands& operands, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        Frac a = operands.fraction<Frac>(), b = operands.fraction<Frac>();
+        Rational ra = reference(a), rb = reference(b);
+        string pair = operands_text(a, b);
+        expect<Frac>(results, "add", attempt<Frac>([&]() { return a + b; }), ra + rb, "add" + pair);
+        expect<Frac>(results, "subtract", attempt<Frac>([&]() { return a - b; }), ra - rb, "subtract" + pair);
+        expect<Frac>(results, "multiply", attempt<Frac>([&]() { return a * b; }), ra * rb, "multiply" + pair);
+        if (b.getNumerator() != 0) {
+            expect<Frac>(results, "divide", attempt<Frac>([&]() { return a / b; }), ra / rb, "divide" + pair);
+        } else {
+            Outcome<Frac> outcome = attempt<Frac>([&]() { return a / b; });
+            if (outcome.other_error)
+                results.pass("divide_by_zero");
+            else
+                results.fail("divide_by_zero", "divide" + pair + " didn't throw");
+        }
+        // compound assignment == binary operator
+        expect<Frac>(results, "compound", attempt<Frac>([&]() { Frac c = a; c += b; return c; }), ra + rb, "+=" + pair);
+        expect<Frac>(results, "compound", attempt<Frac>([&]() { Frac c = a; c *= b; return c; }), ra * rb, "*=" + pair);
+    }
+}
+
+template <class Frac>
+void check_ordering(CheckResults& results, Operands& operands, long long iterations) {
+    for (long long i = 0; i < iterations; i++) {
+        Frac a = operands.fraction<Frac>(), b = operands.fraction<Frac>();
+        if (i % 4 == 0)
+            b = a; // equal values are rare otherwise
+        string pair = operands_text(a, b);
+        strong_ordering expected = reference(a) <=> reference(b);
+        auto order = a <=> b;
+        if ((order < 0) != (expected < 0) || (order > 0) != (expected > 0))
+            results.fail("compare", "<=>" + pair + " disagrees with the exact order");
+        else
+            results.pass("compare");
+        if ((a == b) != (expected == 0) || (a < b) != (expected < 0) || (b < a) != (expected > 0))
+            results.fail("consistency", "==, < inconsistent for " + pair);
+        else
+            results.pass("consistency");
+
+        array<Frac, 3> sorted = {a, b, operands.fraction<Frac>()};
+        sort(sorted.begin(), sorted.end());
+        if (reference(sorted[0]) <= reference(sorted[1]) && reference(sorted[1]) <= reference(sorted[2]))
+            results.pass("sort");
+        else
+            results.fail("sort", "sorted " + text(sorted[0]) + ", " + text(sorted[1]) + ", " + text(sorted[2]));
+    }
+}
+
+template <class Frac>
+void check_axioms(CheckResults& results, Operands& operands, long long iterations) {
+    // lhs and rhs of an identity: equal whenever neither overflows
+    auto identity = [&](const string& property, const function<Frac()>& lhs, const function<Frac()>& rhs) {
+        Outcome<Frac> left = attempt<Frac>(lhs), right = attempt<Frac>(rhs);
+        if (left.overflow || right.overflow)
+            results.skip(property);
+        else if (!left.value || !right.value || !(*left.value == *right.value))
+            results.fail(property, (left.value ? text(*left.value) : "error") + " != "
+                                       + (right.value ? text(*right.value) : "error"));
+        else
+            results.pass(property);
+    };
+    const Frac zero(0), one(1);
+    for (long long i = 0; i < iterations; i++) {
+        bool wide = i % 2; // half with small operands, half with anything
+        Frac a = wide ? operands.fraction<Frac>() : operands.small_fraction<Frac>();
+        Frac b = wide ? operands.fraction<Frac>() : operands.small_fraction<Frac>();
+        Frac c = wide ? operands.fraction<Frac>() : operands.small_fraction<Frac>();
+        identity("add_commutative", [&]() { return a + b; }, [&]() { return b + a; });
+        identity("multiply_commutative", [&]() { return a * b; }, [&]() { return b * a; });
+        identity("add_associative", [&]() { return (a + b) + c; }, [&]() { return a + (b + c); });
+        identity("multiply_associative", [&]() { return (a * b) * c; }, [&]() { return a * (b * c); });
+        identity("distributive", [&]() { return a * (b + c); }, [&]() { return a * b + a * c; });
+        identity("add_identity", [&]() { return a + zero; }, [&]() { return a; });
+        identity("multiply_identity", [&]() { return a * one; }, [&]() { return a; });
+        identity("add_inverse", [&]() { return a - a; }, [&]() { return zero; });
+        identity("subtract_add", [&]() { return (a - b) + b; }, [&]() { return a; });
+        if (a.getNumerator() != 0)
+            identity("multiply_inverse", [&]() { return a / a; }, [&]() { return one; });
+        if (b.getNumerator() != 0)
+            identity("divide_multiply", [&]() { return (a / b) * b; }, [&]() { return a; });
+    }
+}
+
+
+// -- Throughput --
+// ns per operation over solver-like operands (probabilities with denominators built from the wheel size)
+template <class Frac>
+void report_throughput(double min_time_seconds) {
+    mt19937_64 rng(7);
+    vector<Frac> values;
+    for (int i = 0; i < 1024; i++) {
+        long long den = 1;
+        for (int k = uniform_int_distribution<int>(0, 4)(rng); k > 0; k--)
+            den *= 20;
+        den *= uniform_int_distribution<int>(1, 3)(rng);
+        values.emplace_back(uniform_int_distribution<long long>(0, den)(rng), den);
+    }
+
+    auto time = [&](const string& name, const function<long long()>& body) {
+        using clock = chrono::steady_clock;
+        long long operations = 0, sink = 0;
+        auto start = clock::now();
+        double elapsed = 0;
+        while (elapsed < min_time_seconds) {
+            sink += body();
+            operations += values.size() - 1;
+            elapsed = chrono::duration<double>(clock::now() - start).count();
+        }
+        cout << "  " << left << setw(10) << name << right << setw(10) << fixed << setprecision(1)
+             << elapsed * 1e9 / operations << " ns/op" << setw(12) << setprecision(1)
+             << operations / elapsed / 1e6 << " Mops/s" << (sink == 42 ? " " : "") << endl;
+    };
+    cout << "throughput:" << endl;
+    time("add", [&]() { long long s = 0; for (size_t i = 1; i < values.size(); i++) s += (values[i - 1] + values[i]).getNumerator(); return s; });
+    time("subtract", [&]() { long long s = 0; for (size_t i = 1; i < values.size(); i++) s += (values[i - 1] - values[i]).getNumerator(); return s; });
+    time("multiply", [&]() { long long s = 0; for (size_t i = 1; i < values.size(); i++) s += (values[i - 1] * values[i]).getNumerator(); return s; });
+    time("divide", [&]() {
+        long long s = 0;
+        for (size_t i = 1; i < values.size(); i++)
+            if (values[i].getNumerator() != 0)
+                s += (values[i - 1] / values[i]).getNumerator();
+        return s;
+    });
+    time("compare", [&]() { long long s = 0; for (size_t i = 1; i < values.size(); i++) s += values[i - 1] < values[i]; return s; });
+}
+
+
+template <class Frac>
+long long check_backend(const string& name, long long iterations, unsigned long long seed, double min_time_seconds) {
+    CheckResults results;
+    Operands operands(seed);
+    check_construction<Frac>(results, operands, iterations);
+    check_arithmetic<Frac>(results, operands, iterations);
+    check_ordering<Frac>(results, operands, iterations);
+    check_axioms<Frac>(results, operands, iterations);
+
+    cout << name << " (seed " << seed << ", " << iterations << " iterations)" << endl;
+    cout << "  " << left << setw(24) << "property" << right << setw(10) << "checks" << setw(10) << "failed"
+         << setw(10) << "skipped" << endl;
+    for (const auto& [property, count] : results.checks)
+        cout << "  " << left << setw(24) << property << right << setw(10) << count << setw(10)
+             << results.failures[property] << setw(10) << results.skipped[property] << endl;
+    report_throughput<Frac>(min_time_seconds);
+    cout << (results.total_failures() ? "FAILED" : "passed") << endl << endl;
+    return results.total_failures();
+}
+
+int main(int argc, char** argv) {
+    long long iterations = 50'000;
+    unsigned long long seed = random_device{}();
+    double min_time_seconds = 0.2;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--iterations") iterations = stoll(value);
+        else if (arg == "--seed") seed = stoull(value);
+        else if (arg == "--min-time") min_time_seconds = stod(value);
+        else {
+            cerr << "Unknown argument " << arg << endl;
+            return 2;
+        }
+    }
+
+    long long failures = check_backend<Fraction>("Fraction", iterations, seed, min_time_seconds);
+    return failures ? 1 : 0;
+}